@@ -49,6 +49,9 @@ class iks : public std::enable_shared_from_this<iks> {
 
 	connection_mgr::loc_connection_ptr connection_for_base(const std::wstring& prefix);
 
+	/** Probes in single part of streamed get_data reply, shorter ranges are asked for in one reply */
+	static const int STREAM_PART_PROBES = 4096;
+
 	template<class T> void search_data(param_info param, std::string dir, const T start, const T end, SZARP_PROBE_TYPE probe_type, std::function<void(const boost::system::error_code&, const T&)> cb);
 
 	template<class V, class T> void _get_weighted_sum(param_info param, T start, T end, SZARP_PROBE_TYPE probe_type, std::function<void(const boost::system::error_code&, const std::vector< weighted_sum<V, T> >&) > cb);
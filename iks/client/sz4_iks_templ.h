@@ -4,6 +4,7 @@
 #include "conversion.h"
 #include "sz4/defs.h"
 #include "data/probe_type.h"
+#include "data/wsum_codec.h"
 #include "locations/error_codes.h"
 
 
@@ -60,21 +61,46 @@ template<class V, class T> void iks::_get_weighted_sum(param_info param, T start
 		return;
 	}
 
+	bool binary = client->binary_data();
+	///streaming goes around results cache on server, use it only when there is more than one part
+	bool stream = client->stream_data() && T(szb_move_time(start, STREAM_PART_PROBES, probe_type)) < end;
+
 	std::ostringstream ss;
 	ss << "\"" << SC::S2U(param.name()) << "\" "
 		<< ProbeType(probe_type).to_string() << " "
 		<< boost::fusion::at_key<V>(value_type_2_name) << " "
 		<< boost::fusion::at_key<T>(time_type_2_name) << " "
 		<< start << " " << end;
-	  
-	client->send_command("get_data", ss.str(), [cb] (const bs::error_code& ec, const std::string& status, std::string& data) {
+	if (binary)
+		ss << " " << wsum_codec::delta_tag;
+	///reply comes in "r" parts ended with empty "k"
+	if (stream)
+		ss << " stream";
+
+	auto self = shared_from_this();
+	auto response = std::make_shared<result_t>();
+	client->send_command("get_data", ss.str(), [self, client, binary, stream, response, param, start, end, probe_type, cb] (const bs::error_code& ec, const std::string& status, std::string& data) {
 		if (ec) {
 			cb(ec, result_t());
 			return IksCmdStatus::cmd_done;
 		}
 
-		if (status != "k") {
-			cb(make_iks_error_code(data), result_t());
+		if (status != "k" && !(stream && status == "r")) {
+			auto error = make_iks_error_code(data);
+			if (error == make_error_code(ErrorCodes::ill_formed) && (stream || binary)) {
+				///older server, ask again without streaming, then for the text reply
+				if (stream)
+					client->set_stream_data(false);
+				else
+					client->set_binary_data(false);
+				self->_get_weighted_sum<V, T>(param, start, end, probe_type, cb);
+			} else
+				cb(error, result_t());
+			return IksCmdStatus::cmd_done;
+		}
+
+		if (stream && status == "k") {
+			cb(make_error_code(bsec::success), *response);
 			return IksCmdStatus::cmd_done;
 		}
 
@@ -87,18 +113,39 @@ template<class V, class T> void iks::_get_weighted_sum(param_info param, T start
 			bool& _fixed() { return this->m_fixed; }
 		};
 
-		std::istringstream ss(data);
 		_wsum wsum;
-		result_t response;
-
-		while (ss >> wsum._sum() >> wsum._weight() >> wsum._no_data_weight() >> wsum._fixed())
-			response.push_back(wsum);
+		bool ok;
+
+		if (binary) {
+			ok = wsum_codec::decode<V, T>(data, [&response, &wsum] (
+					const typename _wsum::parent_type::sum_type& sum,
+					const typename _wsum::parent_type::time_diff_type& weight,
+					const typename _wsum::parent_type::time_diff_type& no_data_weight,
+					bool fixed) {
+				wsum._sum() = sum;
+				wsum._weight() = weight;
+				wsum._no_data_weight() = no_data_weight;
+				wsum._fixed() = fixed;
+				response->push_back(wsum);
+			});
+		} else {
+			std::istringstream ss(data);
+
+			while (ss >> wsum._sum() >> wsum._weight() >> wsum._no_data_weight() >> wsum._fixed())
+				response->push_back(wsum);
+
+			ok = ss.eof();
+		}
 
-		if (ss.eof())
-			cb(make_error_code(bsec::success), response);
-		else
+		if (!ok) {
 			cb(make_error_code(ie::invalid_server_response), result_t());
+			return IksCmdStatus::cmd_done;
+		}
+
+		if (stream)
+			return IksCmdStatus::cmd_cont;
 
+		cb(make_error_code(bsec::success), *response);
 		return IksCmdStatus::cmd_done;
 	});
 	
@@ -146,7 +146,9 @@ location_connection::location_connection(IPKContainer* container, boost::asio::i
 					const std::string& port, const std::string& defined_param_prefix)
 					: m_container(container), m_location(location), 
 					m_connection(std::make_shared<IksConnection>(io, server, port)),
-					m_defined_param_prefix(defined_param_prefix), m_connected(false)
+					m_defined_param_prefix(defined_param_prefix), m_connected(false),
+					m_binary_data(true),
+					m_stream_data(true)
 {
 	sz_log(10, "location_connection::location_connection(%p), m_connection(%p), location: %s"
 	      , this, m_connection.get(), location.c_str() );
@@ -200,6 +202,9 @@ void location_connection::on_cmd(const std::string& tag, IksCmdId id, const std:
 
 void location_connection::on_connected()
 {
+	//server might have been upgraded meanwhile, try binary and streamed replies again
+	m_binary_data = true;
+	m_stream_data = true;
 	connect_to_location();
 }
 
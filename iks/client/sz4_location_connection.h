@@ -15,6 +15,8 @@ class location_connection : public std::enable_shared_from_this<location_connect
 	std::shared_ptr<IksConnection> m_connection;
 	std::string m_defined_param_prefix;
 	bool m_connected;
+	bool m_binary_data;
+	bool m_stream_data;
 
 	typedef boost::variant<
 			std::tuple<std::string, std::string, IksCmdCallback>,
@@ -46,6 +48,14 @@ public:
 
 	void start_connecting();
 
+	/** If server is believed to understand binary get_data replies */
+	bool binary_data() const { return m_binary_data; }
+	void set_binary_data(bool binary_data) { m_binary_data = binary_data; }
+
+	/** If server is believed to send get_data replies in parts */
+	bool stream_data() const { return m_stream_data; }
+	void set_stream_data(bool stream_data) { m_stream_data = stream_data; }
+
 	void disconnect();
 
 	boost::signals2::signal<void()>						connected_sig;
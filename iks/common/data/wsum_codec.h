@@ -0,0 +1,238 @@
+#ifndef __DATA_WSUM_CODEC_H__
+#define __DATA_WSUM_CODEC_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/archive/iterators/base64_from_binary.hpp>
+#include <boost/archive/iterators/binary_from_base64.hpp>
+#include <boost/archive/iterators/dataflow_exception.hpp>
+#include <boost/archive/iterators/transform_width.hpp>
+
+#include "sz4/defs.h"
+
+/**
+ * Binary encoding of weighted sums sent in get_data replies, used instead
+ * of the text one when client appends binary_tag or delta_tag to the request.
+ *
+ * Reply starts with flags byte and number of sums (4 bytes, little-endian).
+ * For every sum follow: sum, weight, no data weight and fixed flag byte.
+ * Integer fields are zig-zag encoded, 7 bits per byte with highest bit
+ * marking that more bytes follow, floating point sums take 8 little-endian
+ * bytes. With DELTA flag set integer fields hold difference to the previous
+ * sum. Whole reply is padded with zero bytes to a multiple of 3 and base64
+ * encoded, so it still fits in a single protocol line.
+ */
+namespace wsum_codec {
+
+const std::string binary_tag = "binary";
+const std::string delta_tag  = "binary_delta";
+
+enum flags : unsigned char {
+	DELTA = 1
+};
+
+typedef boost::archive::iterators::base64_from_binary<
+	boost::archive::iterators::transform_width<const char *, 6, 8> >
+		base64_enc;
+
+typedef boost::archive::iterators::transform_width<
+	boost::archive::iterators::binary_from_base64<const char *>, 8, 6 >
+		base64_dec;
+
+/**
+ * Zig-zag mapping of difference to previous field. For fixed size integers
+ * it is done in the unsigned type, so that the difference wraps around
+ * instead of overflowing and decoding wraps it back.
+ */
+template<class I , bool bounded = std::numeric_limits<I>::is_bounded> struct zigzag {
+	typedef I type;
+
+	static type encode( const I& value , const I& previous )
+	{
+		I delta = value - previous;
+		return delta < 0 ? I( -( delta + 1 ) ) * 2 + 1 : delta * 2;
+	}
+
+	static I decode( const type& z , const I& previous )
+	{
+		return previous + ( ( z & 1 ) ? -I( z >> 1 ) - 1 : I( z >> 1 ) );
+	}
+};
+
+template<class I> struct zigzag<I, true> {
+	typedef typename std::make_unsigned<I>::type type;
+
+	static type encode( const I& value , const I& previous )
+	{
+		type delta = type( value ) - type( previous );
+		type sign = delta >> ( std::numeric_limits<type>::digits - 1 );
+		return type( delta << 1 ) ^ type( type( 0 ) - sign );
+	}
+
+	static I decode( const type& z , const I& previous )
+	{
+		type delta = type( z >> 1 ) ^ type( type( 0 ) - type( z & 1 ) );
+		return I( type( type( previous ) + delta ) );
+	}
+};
+
+template<class I> void write_field( std::string& out , const I& value , const I& previous )
+{
+	typename zigzag<I>::type z = zigzag<I>::encode( value , previous );
+
+	while( z >= 0x80 ) {
+		out.push_back( char( 0x80 | static_cast<unsigned>( z & 0x7f ) ) );
+		z >>= 7;
+	}
+	out.push_back( char( static_cast<unsigned>( z ) ) );
+}
+
+inline void write_field( std::string& out , const double& value , const double& )
+{
+	uint64_t bits;
+	memcpy( &bits , &value , sizeof(bits) );
+	for( size_t i = 0 ; i < sizeof(bits) ; i++ )
+		out.push_back( char( bits >> ( 8 * i ) ) );
+}
+
+template<class I> bool read_field( const std::string& in , size_t& pos , I& value , const I& previous )
+{
+	typedef typename zigzag<I>::type Z;
+
+	Z z( 0 );
+	for( unsigned shift = 0 ; ; shift += 7 ) {
+		if( pos >= in.size() )
+			return false;
+		if( std::numeric_limits<Z>::is_bounded
+				&& shift >= unsigned( std::numeric_limits<Z>::digits ) )
+			return false;
+
+		unsigned char c = in[pos++];
+		z |= Z( c & 0x7f ) << shift;
+		if( !( c & 0x80 ) )
+			break;
+	}
+
+	value = zigzag<I>::decode( z , previous );
+	return true;
+}
+
+inline bool read_field( const std::string& in , size_t& pos , double& value , const double& )
+{
+	uint64_t bits = 0;
+	if( pos + sizeof(bits) > in.size() )
+		return false;
+
+	for( size_t i = 0 ; i < sizeof(bits) ; i++ )
+		bits |= uint64_t( (unsigned char) in[pos++] ) << ( 8 * i );
+	memcpy( &value , &bits , sizeof(bits) );
+	return true;
+}
+
+template<class V, class T> std::string encode(
+		const std::vector< sz4::weighted_sum<V, T> >& sums , bool delta )
+{
+	typedef sz4::weighted_sum<V, T> wsum_type;
+
+	std::string out;
+	out.push_back( delta ? DELTA : 0 );
+
+	uint32_t count = sums.size();
+	for( size_t i = 0 ; i < sizeof(count) ; i++ )
+		out.push_back( char( count >> ( 8 * i ) ) );
+
+	typename wsum_type::sum_type       prev_sum( 0 );
+	typename wsum_type::time_diff_type prev_weight( 0 ) , prev_no_data_weight( 0 );
+
+	for( auto& sum : sums ) {
+		auto s = sum._sum();
+		auto weight = sum.weight();
+		auto no_data_weight = sum.no_data_weight();
+
+		write_field( out , s , prev_sum );
+		write_field( out , weight , prev_weight );
+		write_field( out , no_data_weight , prev_no_data_weight );
+		out.push_back( sum.fixed() );
+
+		if( delta ) {
+			prev_sum = s;
+			prev_weight = weight;
+			prev_no_data_weight = no_data_weight;
+		}
+	}
+
+	out.append( ( 3 - out.size() % 3 ) % 3 , '\0' );
+
+	std::string encoded;
+	encoded.reserve( out.size() / 3 * 4 );
+	std::copy( base64_enc( out.data() ) , base64_enc( out.data() + out.size() ) ,
+			std::back_inserter( encoded ) );
+	return encoded;
+}
+
+/**
+ * Decodes reply created by encode, @param add is called with sum, weight,
+ * no data weight and fixed flag of every decoded sum.
+ *
+ * @return false if data is malformed
+ */
+template<class V, class T, class F> bool decode( const std::string& data , F add )
+{
+	typedef sz4::weighted_sum<V, T> wsum_type;
+
+	if( data.size() % 4 )
+		return false;
+
+	std::string in;
+	in.reserve( data.size() / 4 * 3 );
+	try {
+		std::copy( base64_dec( data.data() ) , base64_dec( data.data() + data.size() ) ,
+				std::back_inserter( in ) );
+	} catch( const boost::archive::iterators::dataflow_exception& ) {
+		return false;
+	}
+
+	if( in.size() < 1 + sizeof(uint32_t) )
+		return false;
+
+	bool delta = in[0] & DELTA;
+
+	uint32_t count = 0;
+	for( size_t i = 0 ; i < sizeof(count) ; i++ )
+		count |= uint32_t( (unsigned char) in[1 + i] ) << ( 8 * i );
+
+	size_t pos = 1 + sizeof(count);
+
+	typename wsum_type::sum_type       sum( 0 ) , prev_sum( 0 );
+	typename wsum_type::time_diff_type weight( 0 ) , prev_weight( 0 );
+	typename wsum_type::time_diff_type no_data_weight( 0 ) , prev_no_data_weight( 0 );
+
+	for( uint32_t i = 0 ; i < count ; i++ ) {
+		if( !read_field( in , pos , sum , prev_sum )
+				|| !read_field( in , pos , weight , prev_weight )
+				|| !read_field( in , pos , no_data_weight , prev_no_data_weight )
+				|| pos >= in.size() )
+			return false;
+
+		add( sum , weight , no_data_weight , bool( in[pos++] ) );
+
+		if( delta ) {
+			prev_sum = sum;
+			prev_weight = weight;
+			prev_no_data_weight = no_data_weight;
+		}
+	}
+
+	return true;
+}
+
+}
+
+#endif /* end of include guard: __DATA_WSUM_CODEC_H__ */
@@ -114,16 +114,43 @@ void ParamsUpdater::SubPar::update_param() {
 	using std::chrono::system_clock;
 	using namespace boost::posix_time;
 
-	if( pt ) {
+	if( pt && *pt == ProbeType::Type::LIVE && parent->data_feeder->has_live_val(pname) ) {
 		parent->params.param_value_changed(
 				pname ,
-				parent->data_feeder->get_updated_value(pname, *pt) ,
+				parent->data_feeder->get_live_val(pname) ,
 				*pt );
+	} else if( pt ) {
+		/** Values not kept in live cache are read from base in worker threads */
+		auto value = std::make_shared<double>();
+		auto feeder = parent->data_feeder;
+		auto name = pname;
+		auto ptype = *pt;
+
+		feeder->offload_update(
+			[=] () {
+				*value = feeder->get_updated_value(name, ptype);
+			} ,
+			std::bind( &ParamsUpdater::SubPar::value_updated , SubParWeakPtr(shared_from_this()) , value , std::placeholders::_1 ) );
 	} else {
 		parent->params.param_changed( pname );
 	}
 }
 
+void ParamsUpdater::SubPar::value_updated(SubParWeakPtr ptr, std::shared_ptr<double> value, std::exception_ptr error) {
+	auto p = ptr.lock();
+	if (!p)
+		return;
+
+	try {
+		if (error)
+			std::rethrow_exception(error);
+
+		p->parent->params.param_value_changed(p->pname, *value, *p->pt);
+	} catch (szbase_error& e) {
+		sz_log(1, "Szbase error while updating param %s : %s", p->pname.c_str(), e.what());
+	}
+}
+
 void ParamsUpdater::SubPar::callback(SubParWeakPtr ptr) {
 		if (auto p = ptr.lock())
 				p->update_param();
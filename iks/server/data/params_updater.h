@@ -92,6 +92,8 @@ private:
 		void update_param();
 
 		static void callback( SubParWeakPtr ptr );
+
+		static void value_updated( SubParWeakPtr ptr , std::shared_ptr<double> value , std::exception_ptr error );
 	};
 
 };
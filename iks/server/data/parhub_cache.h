@@ -10,6 +10,7 @@
 #include <zmq.hpp>
 
 #include "protobuf/paramsvalues.pb.h"
+#include "params_values_arena.h"
 
 #include <iostream>
 
@@ -130,10 +131,11 @@ public:
 	}
 
 	void poll() {
+		params_values_arena arena;
 		while (!should_exit) {
-			szarp::ParamsValues values;
-			if (socket_holder->recv(values)) {
-				process_msg(values);
+			szarp::ParamsValues* values = arena.create();
+			if (socket_holder->recv(*values)) {
+				process_msg(*values);
 			}
 		}
 	}
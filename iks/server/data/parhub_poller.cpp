@@ -24,10 +24,11 @@ bool ZmqSocketHolder::recv(szarp::ParamsValues& pv) {
 void ParhubPoller::poll() {
 	// not the best way to do this
 	// TODO: change to select()
+	params_values_arena arena;
 	while (!should_exit) {
-		szarp::ParamsValues values;
-		if (socket_holder->recv(values)) {
-			process_msg(values);
+		szarp::ParamsValues* values = arena.create();
+		if (socket_holder->recv(*values)) {
+			process_msg(*values);
 		}
 	}
 }
@@ -10,6 +10,7 @@
 #include <zmq.hpp>
 
 #include "protobuf/paramsvalues.pb.h"
+#include "params_values_arena.h"
 
 
 struct TParamValue;
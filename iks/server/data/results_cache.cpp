@@ -0,0 +1,52 @@
+#include "results_cache.h"
+
+ResultsCache::ResultsCache( size_t max_size )
+	: size( 0 ) , max_size( max_size ) , current_generation( 0 )
+{
+}
+
+ResultsCache::result_ptr ResultsCache::get( const std::string& key )
+{
+	auto i = index.find( key );
+	if( i == index.end() )
+		return result_ptr();
+
+	entries.splice( entries.begin() , entries , i->second );
+	return i->second->second;
+}
+
+unsigned long ResultsCache::generation() const
+{
+	return current_generation;
+}
+
+void ResultsCache::put( const std::string& key , result_ptr result , unsigned long generation )
+{
+	if( generation != current_generation || result->size() > max_size || index.count( key ) )
+		return;
+
+	while( size + result->size() > max_size )
+		remove_oldest();
+
+	entries.emplace_front( key , result );
+	index[ key ] = entries.begin();
+	size += result->size();
+}
+
+void ResultsCache::clear()
+{
+	entries.clear();
+	index.clear();
+	size = 0;
+	current_generation++;
+}
+
+void ResultsCache::remove_oldest()
+{
+	auto& oldest = entries.back();
+
+	size -= oldest.second->size();
+	index.erase( oldest.first );
+	entries.pop_back();
+}
+
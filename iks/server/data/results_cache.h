@@ -0,0 +1,52 @@
+#ifndef __DATA_RESULTS_CACHE_H__
+#define __DATA_RESULTS_CACHE_H__
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Least recently used replies to data requests, bounded by total size
+ * of kept replies. Only replies that cannot change should be put here.
+ */
+class ResultsCache {
+public:
+	typedef std::shared_ptr<const std::string> result_ptr;
+
+	ResultsCache( size_t max_size );
+
+	/**
+	 * Returns cached reply or null if there is none.
+	 */
+	result_ptr get( const std::string& key );
+
+	/**
+	 * Changes every time cache is cleared, reply computed from data read
+	 * before that should be put with generation taken then.
+	 */
+	unsigned long generation() const;
+
+	/**
+	 * Caches reply unless cache was cleared after generation was taken.
+	 */
+	void put( const std::string& key , result_ptr result , unsigned long generation );
+
+	void clear();
+
+protected:
+	typedef std::list< std::pair<std::string, result_ptr> > entries_list;
+
+	void remove_oldest();
+
+	entries_list entries;
+	std::unordered_map<std::string, entries_list::iterator> index;
+
+	size_t size;
+	size_t max_size;
+
+	unsigned long current_generation;
+};
+
+#endif /* end of include guard: __DATA_RESULTS_CACHE_H__ */
+
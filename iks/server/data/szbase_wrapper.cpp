@@ -3,12 +3,31 @@
 #include "sz4/exceptions.h"
 #include "sz4/live_cache.h"
 #include "sz4/util.h"
+#include "data/wsum_codec.h"
+#include "global_service.h"
 #include "liblog.h"
 
+#include <algorithm>
+
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
 
 #include <conversion.h>
 
+namespace {
+
+/**
+ * Held shared by requests running in worker threads and exclusively while
+ * user defined params are removed, so that a param is not deleted under a
+ * running request. Params are added and removed by the main thread only,
+ * so it does not take the lock to look them up. Base and IPKContainer are
+ * otherwise safe to use from many threads at once.
+ */
+boost::shared_mutex params_lock;
+
+}
+
 SzbaseObserverImpl::SzbaseObserverImpl( const std::wstring& param_name
 									  , IPKContainer* ipk
 									  , sz4::base* base
@@ -34,6 +53,8 @@ void SzbaseObserverImpl::param_data_changed( TParam* )
 
 SzbaseObserverImpl::~SzbaseObserverImpl()
 {
+	boost::shared_lock<boost::shared_mutex> lock( params_lock );
+
 	TParam* tparam = ipk->GetParam( param_name );
 	if( tparam )
 		base->deregister_observer( this , std::vector<TParam*>{ tparam } );
@@ -49,8 +70,12 @@ size_t SzbaseWrapper::base_cache_high_water_mark;
 const size_t SzbaseWrapper::BASE_CACHE_LOW_WATER_MARK_DEFAULT = 128 * 1024 * 1024;
 const size_t SzbaseWrapper::BASE_CACHE_HIGH_WATER_MARK_DEFAULT = 192 * 1024 * 1024;
 const int SzbaseWrapper::BASE_LIVE_CACHE_RETENTION = 15 * 60;
+const size_t SzbaseWrapper::AVGS_PART_PROBES = 4096;
+const size_t SzbaseWrapper::RESULTS_CACHE_SIZE = 16 * 1024 * 1024;
+ResultsCache SzbaseWrapper::results_cache( SzbaseWrapper::RESULTS_CACHE_SIZE );
+std::unordered_map<std::string, std::vector<SzbaseWrapper::data_callback>> SzbaseWrapper::pending_requests;
 
-bool SzbaseWrapper::init( const std::string& _szarp_dir , const CfgSections& locs, int live_cache_retetion, size_t base_low_water_mark, size_t base_high_water_mark)
+bool SzbaseWrapper::init( const std::string& _szarp_dir , const CfgSections& locs, int live_cache_retetion, size_t base_low_water_mark, size_t base_high_water_mark, const std::string& definable_store_dir)
 {
 	if( initialized )
 		return boost::filesystem::path(_szarp_dir) == szarp_dir;
@@ -85,6 +110,10 @@ bool SzbaseWrapper::init( const std::string& _szarp_dir , const CfgSections& loc
 
 	SzbaseWrapper::base_cache_high_water_mark = base_high_water_mark;
 	SzbaseWrapper::base_cache_low_water_mark = base_low_water_mark;
+	base->cache()->set_water_marks( base_low_water_mark , base_high_water_mark );
+
+	if( !definable_store_dir.empty() )
+		base->enable_definable_store( boost::filesystem::path(definable_store_dir).wstring() );
 
 	initialized = true;
 
@@ -93,6 +122,8 @@ bool SzbaseWrapper::init( const std::string& _szarp_dir , const CfgSections& loc
 
 SzbaseWrapper::SzbaseWrapper( const std::string& base )
 	: base_name(base)
+	, requests_strand( GlobalService::get_worker_service() )
+	, updates_strand( GlobalService::get_worker_service() )
 {
 	std::wstring wbp( base_name.begin() , base_name.end() );
 	IPKContainer::GetObject()->GetConfig( wbp );
@@ -114,6 +145,30 @@ std::wstring SzbaseWrapper::convert_string( const std::string& str ) const
 	return SC::U2S( ubp );
 }
 
+void SzbaseWrapper::post( boost::asio::io_service::strand& strand , std::function<void( void )> work , std::function<void( std::exception_ptr )> done )
+{
+	strand.post( [work, done] () {
+		std::exception_ptr error;
+		try {
+			work();
+		} catch( ... ) {
+			error = std::current_exception();
+		}
+
+		GlobalService::get_service().post( std::bind( done , error ) );
+	} );
+}
+
+void SzbaseWrapper::offload( std::function<void( void )> work , std::function<void( std::exception_ptr )> done ) const
+{
+	post( requests_strand , work , done );
+}
+
+void SzbaseWrapper::offload_update( std::function<void( void )> work , std::function<void( std::exception_ptr )> done ) const
+{
+	post( updates_strand , work , done );
+}
+
 void SzbaseWrapper::purge_cache()
 {
 	size_t size_in_bytes, blocks_count;
@@ -122,9 +177,8 @@ void SzbaseWrapper::purge_cache()
 	cache->cache_size( size_in_bytes , blocks_count );
 
 	if( size_in_bytes > base_cache_high_water_mark ) {
-		size_t to_purge = size_in_bytes - base_cache_low_water_mark;
-		sz_log(5, "Purging cache, cache size %zu, purging %zu bytes", size_in_bytes, to_purge);
-		cache->remove( to_purge );
+		sz_log(5, "Purging cache, cache size %zu, purging %zu bytes", size_in_bytes, size_in_bytes - base_cache_low_water_mark);
+		base->purge_cache();
 	}
 }
 
@@ -135,6 +189,8 @@ time_t SzbaseWrapper::get_latest(
 	if( !SzbaseWrapper::is_initialized() )
 		throw szbase_init_error("Szbase not initialized");
 
+	boost::shared_lock<boost::shared_mutex> lock( params_lock );
+
 	TParam* tparam = IPKContainer::GetObject()->GetParam( convert_string( base_name + ":" + param ) );
 	if( !tparam )
 		throw szbase_get_value_error( "Cannot get latest time of param " + param + ", param not found" );
@@ -163,6 +219,8 @@ double SzbaseWrapper::get_avg(
 	if( !SzbaseWrapper::is_initialized() )
 		throw szbase_init_error("Szbase not initialized");
 
+	boost::shared_lock<boost::shared_mutex> lock( params_lock );
+
 	TParam* tparam = IPKContainer::GetObject()->GetParam( convert_string( base_name + ":" + param ) );
 	if( !tparam )
 		throw szbase_get_value_error( "Cannot get value from param " + param + ", param not found" );
@@ -183,6 +241,60 @@ double SzbaseWrapper::get_avg(
 	return sz4::scale_value(sum.avg(), tparam);
 }
 
+void SzbaseWrapper::get_avgs(
+			const std::string& param ,
+			time_t beg ,
+			time_t end ,
+			ProbeType type ,
+			std::vector<float>& avgs ) const
+{
+	if( !SzbaseWrapper::is_initialized() )
+		throw szbase_init_error("Szbase not initialized");
+
+	boost::shared_lock<boost::shared_mutex> lock( params_lock );
+
+	TParam* tparam = IPKContainer::GetObject()->GetParam( convert_string( base_name + ":" + param ) );
+	if( !tparam )
+		throw szbase_get_value_error( "Cannot get value from param " + param + ", param not found" );
+
+	std::vector< sz4::weighted_sum<double, unsigned> > sums;
+	try {
+		if( type.get_type() != ProbeType::Type::CUSTOM ) {
+			/** Sums of long ranges are read in parts, so only one part is kept at once */
+			for( time_t t = beg ; t < end ; ) {
+				time_t part_end = std::min( end , next( t , type , int( AVGS_PART_PROBES ) ) );
+
+				sums.clear();
+				base->get_weighted_sums( tparam ,
+										 unsigned( t ) ,
+										 unsigned( part_end ) ,
+										 type.get_szarp_pt() ,
+										 sums );
+
+				for( auto& sum : sums )
+					avgs.push_back( sz4::scale_value( sum.avg() , tparam ) );
+
+				t = part_end;
+			}
+		} else {
+			/** Range API splits probes ignoring custom length */
+			for( time_t t = beg ; t < end ; t = next( t , type , 1 ) ) {
+				sz4::weighted_sum<double, unsigned> sum;
+				base->get_weighted_sum( tparam ,
+										unsigned( t ) ,
+										unsigned( next( t , type , 1 ) ) ,
+										type.get_szarp_pt() ,
+										sum );
+				avgs.push_back( sz4::scale_value( sum.avg() , tparam ) );
+			}
+		}
+	} catch( sz4::exception& e ) {
+		throw szbase_get_value_error( "Cannot get value from param " + param + ": " + e.what() );
+	}
+
+	purge_cache();
+}
+
 namespace
 {
 
@@ -227,6 +339,8 @@ std::string SzbaseWrapper::search_data( const std::string& param ,
 	if( !SzbaseWrapper::is_initialized() )
 		throw szbase_init_error("Szbase not initialized");
 
+	boost::shared_lock<boost::shared_mutex> lock( params_lock );
+
 	TParam* tparam = IPKContainer::GetObject()->GetParam( convert_string( base_name + ":" + param ) );
 	if( !tparam )
 		throw szbase_param_not_found_error( "Param " + param + ", does not exist." );
@@ -255,25 +369,29 @@ std::ostream& get_data( sz4::base*       base ,
 					  time_type        from ,
 					  time_type        to ,
 					  SZARP_PROBE_TYPE pt ,
+					  DataEncoding     encoding ,
+					  bool&            fixed ,
 					  std::ostream&    os )
 {
-	bool first = true;
+	std::vector< sz4::weighted_sum< value_time, time_type > > sums;
+	base->get_weighted_sums( param , from , to , pt , sums );
 
-	while ( from < to )
-	{
-		time_type next = szb_move_time( from , 1 , pt , 0 );
+	fixed = std::all_of( sums.begin() , sums.end() ,
+			[] ( const sz4::weighted_sum< value_time, time_type >& sum ) { return sum.fixed(); } );
 
-		sz4::weighted_sum< value_time, time_type > sum;
-		base->get_weighted_sum( param , from , next , pt , sum );
+	if ( encoding != DataEncoding::TEXT )
+		return os << wsum_codec::encode( sums , encoding == DataEncoding::BINARY_DELTA );
+
+	bool first = true;
 
+	for ( auto& sum : sums )
+	{
 		if (first)
 			first = false;
 		else
 			os << " ";
 	
 		os << sum._sum() << " " << sum.weight() << " " << sum.no_data_weight() << " " << sum.fixed();
-
-		from = next;
 	}
 
 	return os;
@@ -286,6 +404,10 @@ std::ostream& get_data( sz4::base*       base ,
 					  const std::string& to ,
 					  ValueType          vt ,
 					  SZARP_PROBE_TYPE   pt ,
+					  DataEncoding       encoding ,
+					  size_t             max_probes ,
+					  std::string*       next ,
+					  bool&              fixed ,
 					  std::ostream&      os )
 {
 
@@ -297,18 +419,32 @@ std::ostream& get_data( sz4::base*       base ,
 		throw szbase_error( "Invalid time specification from: " + from + " to: " + to );
 	}
 
+	if( next ) {
+		/** Probes are split the same way get_weighted_sums does it */
+		time_type end = _from;
+		for( size_t i = 0 ; i < max_probes && end < _to ; i++ )
+			end = szb_move_time( end , 1 , pt , 0 );
+
+		if( end < _to ) {
+			_to = end;
+			*next = boost::lexical_cast<std::string>( end );
+		} else {
+			next->clear();
+		}
+	}
+
 	switch (vt) {
 		case ValueType::DOUBLE:
-			get_data<double       , time_type>( base , param , _from , _to , pt , os );
+			get_data<double       , time_type>( base , param , _from , _to , pt , encoding , fixed , os );
 			break;
 		case ValueType::FLOAT:
-			get_data<float        , time_type>( base , param , _from , _to , pt , os );
+			get_data<float        , time_type>( base , param , _from , _to , pt , encoding , fixed , os );
 			break;
 		case ValueType::INT:
-			get_data<int          , time_type>( base , param , _from , _to , pt , os );
+			get_data<int          , time_type>( base , param , _from , _to , pt , encoding , fixed , os );
 			break;
 		case ValueType::SHORT:
-			get_data<short        , time_type>( base , param , _from , _to , pt , os );
+			get_data<short        , time_type>( base , param , _from , _to , pt , encoding , fixed , os );
 			break;
 	}
 
@@ -322,12 +458,44 @@ std::string SzbaseWrapper::get_data( const std::string& param ,
 									 const std::string& to ,
 									 ValueType value_type ,
 									 TimeType time_type ,
-									 ProbeType pt ) const
+									 ProbeType pt ,
+									 DataEncoding encoding ,
+									 bool* fixed ) const
+{
+	return get_data( param , from , to , value_type , time_type , pt , encoding , 0 , NULL , fixed );
+}
+
+std::string SzbaseWrapper::get_data_part( const std::string& param ,
+										  const std::string& from ,
+										  const std::string& to ,
+										  ValueType value_type ,
+										  TimeType time_type ,
+										  ProbeType pt ,
+										  DataEncoding encoding ,
+										  size_t max_probes ,
+										  std::string& next ) const
+{
+	return get_data( param , from , to , value_type , time_type , pt , encoding , max_probes , &next , NULL );
+}
+
+std::string SzbaseWrapper::get_data( const std::string& param ,
+									 const std::string& from ,
+									 const std::string& to ,
+									 ValueType value_type ,
+									 TimeType time_type ,
+									 ProbeType pt ,
+									 DataEncoding encoding ,
+									 size_t max_probes ,
+									 std::string* next ,
+									 bool* fixed ) const
 {
 	if( !SzbaseWrapper::is_initialized() )
 		throw szbase_init_error("Szbase not initialized");
 
+	boost::shared_lock<boost::shared_mutex> lock( params_lock );
+
 	std::ostringstream ss;
+	bool all_fixed = false;
 
 	TParam* tparam = IPKContainer::GetObject()->GetParam( convert_string( base_name + ":" + param ) );
 	if( !tparam )
@@ -339,13 +507,15 @@ std::string SzbaseWrapper::get_data( const std::string& param ,
 				::get_data<sz4::nanosecond_time_t>( base , tparam ,
 								    from , to ,
 								    value_type , pt.get_szarp_pt() ,
-								    ss );
+								    encoding , max_probes , next ,
+								    all_fixed , ss );
 				break;
 			case TimeType::SECOND:
 				::get_data<sz4::second_time_t>    ( base , tparam ,
 								    from , to ,
 								    value_type , pt.get_szarp_pt() ,
-								    ss );
+								    encoding , max_probes , next ,
+								    all_fixed , ss );
 				break;
 		}
 	} catch ( sz4::exception& e ) {
@@ -354,9 +524,68 @@ std::string SzbaseWrapper::get_data( const std::string& param ,
 
 	purge_cache();
 
+	if( fixed )
+		*fixed = all_fixed;
+
 	return ss.str();
 }
 
+void SzbaseWrapper::get_data_async( const std::string& param ,
+									const std::string& from ,
+									const std::string& to ,
+									ValueType value_type ,
+									TimeType time_type ,
+									ProbeType pt ,
+									DataEncoding encoding ,
+									data_callback done ) const
+{
+	/** Protocol is line based so fields cannot contain new line */
+	std::ostringstream key;
+	key << base_name << '\n' << param << '\n' << pt.to_string() << '\n'
+		<< from << '\n' << to << '\n' << int( value_type ) << '\n'
+		<< int( time_type ) << '\n' << int( encoding );
+
+	if( auto result = results_cache.get( key.str() ) ) {
+		done( result , std::exception_ptr() );
+		return;
+	}
+
+	/** Requests made after cache was cleared do not wait for replies
+	 * computed from data read before */
+	auto generation = results_cache.generation();
+	std::string pending_key = key.str() + '\n' + std::to_string( generation );
+
+	auto& waiting = pending_requests[ pending_key ];
+	waiting.push_back( done );
+	if( waiting.size() > 1 )
+		return;
+
+	auto result = std::make_shared<std::string>();
+	auto fixed = std::make_shared<bool>( false );
+
+	offload(
+		[=] () {
+			*result = get_data( param , from , to , value_type , time_type , pt , encoding , fixed.get() );
+		} ,
+		std::bind( &SzbaseWrapper::data_computed , this , key.str() , generation , result , fixed , std::placeholders::_1 ) );
+}
+
+void SzbaseWrapper::data_computed( const std::string& key , unsigned long generation , ResultsCache::result_ptr result , std::shared_ptr<bool> fixed , std::exception_ptr error ) const
+{
+	auto i = pending_requests.find( key + '\n' + std::to_string( generation ) );
+	if( i == pending_requests.end() )
+		return;
+
+	auto waiting = std::move( i->second );
+	pending_requests.erase( i );
+
+	if( !error && *fixed )
+		results_cache.put( key , result , generation );
+
+	for( auto& done : waiting )
+		done( result , error );
+}
+
 SzbaseObserverToken SzbaseWrapper::register_observer( const std::string& param , boost::optional<ProbeType> pt, std::function<void( void )> callback )
 {
 	if( !SzbaseWrapper::is_initialized() )
@@ -497,11 +726,16 @@ void SzbaseWrapper::remove_param(const std::string& base, const std::string& par
 	if( !SzbaseWrapper::is_initialized() )
 		throw szbase_init_error("Szbase not initialized");
 
+	boost::unique_lock<boost::shared_mutex> lock( params_lock );
+
 	auto tparam = IPKContainer::GetObject()->GetParam( convert_string( base + ":" + param ), false );
 	if( tparam )
 		this->base->remove_param( tparam );
 
 	IPKContainer::GetObject()->RemoveExtraParam( convert_string ( base ) , convert_string( param ) );
+
+	/** Param of the same name may come back with different formula */
+	results_cache.clear();
 }
 
 time_t SzbaseWrapper::next( time_t t , ProbeType pt , int num )
@@ -1,6 +1,11 @@
 #ifndef __DATA_SZBASE_WRAPPER_H__
 #define __DATA_SZBASE_WRAPPER_H__
 
+#include <exception>
+#include <functional>
+
+#include <boost/asio.hpp>
+
 #include "szarp_config.h"
 #include "szbase/szbdate.h"
 
@@ -9,6 +14,7 @@
 #include "data/probe_type.h"
 
 #include "iks_live_cache.h"
+#include "results_cache.h"
 
 using SzbaseObserverToken = std::shared_ptr<Observer>;
 
@@ -29,12 +35,18 @@ enum class ValueType {
 	DOUBLE
 };
 
+enum class DataEncoding {
+	TEXT,
+	BINARY,
+	BINARY_DELTA
+};
+
 class SzbaseWrapper {
 public:
 	static std::string get_dir()
 	{	return szarp_dir.string(); }
 
-	static bool init( const std::string& _szarp_dir , const CfgSections& locs, int live_cache_retention, size_t base_low_water_mark, size_t base_high_water_mark);
+	static bool init( const std::string& _szarp_dir , const CfgSections& locs, int live_cache_retention, size_t base_low_water_mark, size_t base_high_water_mark, const std::string& definable_store_dir = std::string());
 	static bool is_initialized() { return initialized; }
 
 	static time_t next( time_t t , ProbeType pt , int num = 1 );
@@ -55,7 +67,31 @@ public:
 	 * Gets average from exact given time with specified probe
 	 */
 	double get_avg( const std::string& param , time_t time , ProbeType type ) const;
+
+	/**
+	 * Appends to avgs averages of all probes starting in range [beg, end),
+	 * same as calling get_avg for every probe but param is looked up only
+	 * once and base is read in parts of AVGS_PART_PROBES probes.
+	 */
+	void get_avgs( const std::string& param , time_t beg , time_t end , ProbeType type , std::vector<float>& avgs ) const;
 	double get_live_val(const std::string& param) const { return live_values_holder.get_value(param); }
+	bool has_live_val(const std::string& param) const { return live_values_holder.has_param(param); }
+
+	/**
+	 * Runs work in worker threads. Works of single location are run in
+	 * order of calls, done is called in main service with exception
+	 * thrown by work or null.
+	 *
+	 * Base is shared by all locations so works reading it still wait for
+	 * each other, but do not stop main service from serving connections.
+	 */
+	void offload( std::function<void( void )> work , std::function<void( std::exception_ptr )> done ) const;
+
+	/**
+	 * Same as offload, but for refreshing values of subscribed params.
+	 * These are not queued behind long requests of the location.
+	 */
+	void offload_update( std::function<void( void )> work , std::function<void( std::exception_ptr )> done ) const;
 
 	std::string search_data( const std::string& param ,
 						     const std::string& from ,
@@ -70,9 +106,46 @@ public:
 						  const std::string& to ,
 						  ValueType value_type ,
 						  TimeType time_type ,
-						  ProbeType pt
+						  ProbeType pt ,
+						  DataEncoding encoding = DataEncoding::TEXT ,
+						  bool* fixed = NULL
 						  ) const;
 
+	/**
+	 * Reads part of get_data reply made of at most max_probes probes
+	 * starting at from. Start of the remaining part is stored in next,
+	 * it is empty when whole reply was read.
+	 */
+	std::string get_data_part( const std::string& param ,
+							   const std::string& from ,
+							   const std::string& to ,
+							   ValueType value_type ,
+							   TimeType time_type ,
+							   ProbeType pt ,
+							   DataEncoding encoding ,
+							   size_t max_probes ,
+							   std::string& next ) const;
+
+	typedef std::function<void( ResultsCache::result_ptr , std::exception_ptr )> data_callback;
+
+	/**
+	 * Calls get_data in worker threads, done is called in main service
+	 * with reply or exception. Requests identical to one being computed
+	 * wait for its reply instead of reading base again. Replies holding
+	 * only fixed values are cached, for these done may be called before
+	 * this method returns.
+	 *
+	 * Should be called from main service only.
+	 */
+	void get_data_async( const std::string& param ,
+						 const std::string& from ,
+						 const std::string& to ,
+						 ValueType value_type ,
+						 TimeType time_type ,
+						 ProbeType pt ,
+						 DataEncoding encoding ,
+						 data_callback done ) const;
+
 	std::string add_param( const std::string& param
 						 , const std::string& base
 						 , const std::string& formula
@@ -91,6 +164,21 @@ public:
 private:
 	std::wstring convert_string( const std::string& param ) const;
 
+	std::string get_data( const std::string& param ,
+						  const std::string& from ,
+						  const std::string& to ,
+						  ValueType value_type ,
+						  TimeType time_type ,
+						  ProbeType pt ,
+						  DataEncoding encoding ,
+						  size_t max_probes ,
+						  std::string* next ,
+						  bool* fixed ) const;
+
+	void data_computed( const std::string& key , unsigned long generation , ResultsCache::result_ptr result , std::shared_ptr<bool> fixed , std::exception_ptr error ) const;
+
+	static void post( boost::asio::io_service::strand& strand , std::function<void( void )> work , std::function<void( std::exception_ptr )> done );
+
 	// base -> parhub url
 	static std::unordered_map<std::string, std::string> parhub_urls;
 	std::unique_ptr<ParhubPoller> live_updater;
@@ -104,11 +192,21 @@ private:
 	static size_t base_cache_low_water_mark;
 	static size_t base_cache_high_water_mark;
 
+	/** Shared by all locations, accessed from main service only */
+	static ResultsCache results_cache;
+	static std::unordered_map<std::string, std::vector<data_callback>> pending_requests;
+
 	std::string base_name;
 
+	mutable boost::asio::io_service::strand requests_strand;
+	mutable boost::asio::io_service::strand updates_strand;
+
 public:
 	static const size_t BASE_CACHE_LOW_WATER_MARK_DEFAULT;
 	static const size_t BASE_CACHE_HIGH_WATER_MARK_DEFAULT;
+	static const size_t RESULTS_CACHE_SIZE;
+	/** Number of probes read by single get_weighted_sums call in get_avgs */
+	static const size_t AVGS_PART_PROBES;
 	static const int BASE_LIVE_CACHE_RETENTION;
 
 };
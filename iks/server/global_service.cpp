@@ -1,4 +1,29 @@
 #include "global_service.h"
 
 boost::asio::io_service GlobalService::service;
+boost::asio::io_service GlobalService::worker_service;
+std::unique_ptr<boost::asio::io_service::work> GlobalService::worker_work;
+std::vector<std::thread> GlobalService::workers;
+
+void GlobalService::start_workers( unsigned count )
+{
+	if( !count || !workers.empty() )
+		return;
+
+	worker_work.reset( new boost::asio::io_service::work( worker_service ) );
+
+	for( unsigned i = 0 ; i < count ; i++ )
+		workers.emplace_back( [] () { worker_service.run(); } );
+}
+
+void GlobalService::stop_workers()
+{
+	worker_work.reset();
+	worker_service.stop();
+
+	for( auto& worker : workers )
+		worker.join();
+
+	workers.clear();
+}
 
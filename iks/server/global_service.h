@@ -1,18 +1,54 @@
 #ifndef __GLOBAL_SERVICE_H__
 #define __GLOBAL_SERVICE_H__
 
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include <boost/asio.hpp>
 
 /**
- * TODO: Expand this class in case of multi-threaded (17/03/2014 13:00, jkotur)
+ * Main service runs in single thread and owns all connections and
+ * locations state. Blocking szbase work can be moved to worker threads
+ * that run separate service.
  */
 class GlobalService {
 public:
 	static boost::asio::io_service& get_service()
 	{	return service; }
 
+	/**
+	 * Service for blocking work. If no workers are running this is
+	 * the main service.
+	 */
+	static boost::asio::io_service& get_worker_service()
+	{	return workers.empty() ? service : worker_service; }
+
+	/**
+	 * Keeps worker threads running for its lifetime, should be
+	 * created before any user of worker service and stopped before
+	 * users of worker service are destroyed.
+	 */
+	class Workers {
+	public:
+		Workers( unsigned count )
+		{	start_workers( count ); }
+
+		~Workers()
+		{	stop(); }
+
+		void stop()
+		{	stop_workers(); }
+	};
+
 protected:
+	static void start_workers( unsigned count );
+	static void stop_workers();
+
 	static boost::asio::io_service service;
+	static boost::asio::io_service worker_service;
+	static std::unique_ptr<boost::asio::io_service::work> worker_work;
+	static std::vector<std::thread> workers;
 };
 
 #endif /* end of include guard: __GLOBAL_SERVICE_H__ */
@@ -2,6 +2,7 @@
 #define __LOCATIONS_COMMAND_H__
 
 #include <string>
+#include <memory>
 #include <functional>
 
 #include <boost/format.hpp>
@@ -20,6 +21,9 @@ public:
 	typedef boost::signals2::signal<void (ResponseType,const std::string&,Command*)> sig_response;
 	typedef std::function<void (const std::string& data)> line_handler;
 	typedef boost::optional<std::string> to_send;
+	typedef boost::signals2::signal<void (std::function<void()>)> sig_wait_writable;
+
+	Command() : alive( std::make_shared<bool>( true ) ) {}
 
 	virtual ~Command() {}
 
@@ -46,6 +50,16 @@ public:
 	slot_connection on_response( const sig_response::slot_type& slot )
 	{	return emit_response.connect( slot ); }
 
+	/**
+	 * Expires when command is deleted, lets handlers of asynchronous
+	 * work check if there is still someone waiting for the result.
+	 */
+	std::weak_ptr<bool> lifetime() const
+	{	return alive; }
+
+	slot_connection on_wait_writable( const sig_wait_writable::slot_type& slot )
+	{	return emit_wait_writable.connect( slot ); }
+
 protected:
 	void set_next( const line_handler& hnd )
 	{	next_handler = hnd; }
@@ -72,6 +86,18 @@ protected:
 	void quiet_end()
 	{	emit_response( ResponseType::QUIET_END , "" , this ); }
 
+	/**
+	 * Calls cont when more responses can be sent, used by commands
+	 * that send reply in many parts to not outrun the client.
+	 */
+	void when_writable( std::function<void()> cont )
+	{
+		if( emit_wait_writable.empty() )
+			cont();
+		else
+			emit_wait_writable( cont );
+	}
+
 	void default_handler( const std::string& data )
 	{	fail( ErrorCodes::unknown_command ); }
 
@@ -82,6 +108,9 @@ private:
 
 	line_handler next_handler;
 	sig_response emit_response;
+	sig_wait_writable emit_wait_writable;
+
+	std::shared_ptr<bool> alive;
 };
 
 typedef boost::signals2::signal<void (const Command&)> sig_cmd;
@@ -12,6 +12,8 @@ void Location::swap_connection( Location& loc )
 {
 	loc.sig_conn.disconnect();
 	sig_conn.disconnect();
+	loc.sig_writable_conn.disconnect();
+	sig_writable_conn.disconnect();
 
 	std::swap( connection , loc.connection );
 
@@ -26,6 +28,8 @@ void Location::init_connection()
 
 	sig_conn = connection->on_line_received(
 		std::bind(&Location::parse_line,this,std::placeholders::_1) );
+	sig_writable_conn = connection->on_writable(
+		std::bind(&Location::connection_writable,this) );
 }
 
 Location::~Location()
@@ -38,3 +42,23 @@ void Location::write_line( const std::string& line )
 		connection->write_line( line );
 }
 
+void Location::when_writable( std::function<void()> cont )
+{
+	if( !connection )
+		return;
+
+	if( connection->writable() )
+		cont();
+	else
+		writable_waiting.push_back( cont );
+}
+
+void Location::connection_writable()
+{
+	auto waiting = std::move( writable_waiting );
+	writable_waiting.clear();
+
+	for( auto& cont : waiting )
+		cont();
+}
+
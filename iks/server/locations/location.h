@@ -2,6 +2,7 @@
 #define __CONNECTIONS_CONNECTION_H__
 
 #include <functional>
+#include <vector>
 
 #include "net/connection.h"
 
@@ -42,6 +43,7 @@ protected:
 		if( connection )
 			connection->close();
 		sig_conn.disconnect();
+		sig_writable_conn.disconnect();
 		connection = NULL;
 	}
 
@@ -49,15 +51,26 @@ protected:
 
 	void write_line( const std::string& line );
 
+	/**
+	 * Calls cont when connection can take more data, immediately if it
+	 * already can. Not called at all if location has no connection.
+	 */
+	void when_writable( std::function<void()> cont );
+
 	mutable sig_location emit_request_location;
 
 private:
 	void init_connection();
 
+	void connection_writable();
+
 	std::string name;
 	Connection* connection;
 
+	std::vector<std::function<void()>> writable_waiting;
+
 	boost::signals2::scoped_connection sig_conn;
+	boost::signals2::scoped_connection sig_writable_conn;
 };
 
 #endif /* end of include guard: __CONNECTIONS_CONNECTION_H__ */
@@ -138,6 +138,8 @@ void ProtocolLocation::new_cmd( Command* cmd , const std::string& tag , id_t id
 			cmd->set_id( id );
 			cmd->on_response( 
 					std::bind(&ProtocolLocation::send_response,this,p::_1,p::_2,p::_3) );
+			cmd->on_wait_writable(
+					std::bind(&ProtocolLocation::when_writable,this,p::_1) );
 		} else {
 			/** This should never happen */
 			sz_log(1, "Invalid id generated");
@@ -8,13 +8,12 @@ typedef boost::archive::iterators::base64_from_binary<
 		base64_enc;
 
 std::vector<f32_t> get_probes(
-		Vars& vars,
+		const SzbaseWrapper* szbase,
 		timestamp_t beg , timestamp_t end , ProbeType pt ,
 		const std::string& param )
 {
 	std::vector<f32_t> probes;
-	for( timestamp_t t=beg ; t<end ; t=SzbaseWrapper::next(t,pt) )
-		probes.push_back( vars.get_szbase()->get_avg( param , t , pt ) );
+	szbase->get_avgs( param , beg , end , pt , probes );
 	return probes;
 }
 
@@ -2,6 +2,7 @@
 
 #include "../../../config.h"
 #include "data/szbase_wrapper.h"
+#include "data/wsum_codec.h"
 #include "utils/tokens.h"
 #include "szbase.h"
 
@@ -28,11 +29,30 @@ void GetDataRcv::parse_command( const std::string& data )
 			l ,
 			balgo::is_any_of(" "), balgo::token_compress_on );
 
-	if( tags.size() != 5 ) {
+	/** Reply is sent in parts as soon as they are read */
+	bool stream = false;
+	if( !tags.empty() && tags.back() == "stream" ) {
+		stream = true;
+		tags.pop_back();
+	}
+
+	if( tags.size() != 5 && tags.size() != 6 ) {
 		fail( ErrorCodes::ill_formed );
 		return;
 	}
 
+	DataEncoding encoding = DataEncoding::TEXT;
+	if( tags.size() == 6 ) {
+		if( tags[5] == wsum_codec::binary_tag ) {
+			encoding = DataEncoding::BINARY;
+		} else if( tags[5] == wsum_codec::delta_tag ) {
+			encoding = DataEncoding::BINARY_DELTA;
+		} else {
+			fail( ErrorCodes::ill_formed );
+			return;
+		}
+	}
+
 	ProbeType pt( tags[0] );
 
 	TimeType ttype;
@@ -59,15 +79,88 @@ void GetDataRcv::parse_command( const std::string& data )
 		return;
 	}
 		
+	if( stream ) {
+		param = prot.get_mapped_param_name( name );
+		to = tags[4];
+		value_type = vtype;
+		time_type = ttype;
+		probe_type = pt;
+		data_encoding = encoding;
+
+		read_part( tags[3] );
+		return;
+	}
+
+	vars.get_szbase()->get_data_async( prot.get_mapped_param_name( name )
+						  , tags[3] , tags[4], vtype , ttype , pt , encoding
+						  , std::bind( &GetDataRcv::on_data , this , lifetime()
+							  , std::placeholders::_1 , std::placeholders::_2 ) );
+}
+
+void GetDataRcv::on_data( std::weak_ptr<bool> alive , ResultsCache::result_ptr result , std::exception_ptr error )
+{
+	if( alive.expired() )
+		return;
+
 	try {
-		apply( vars.get_szbase()->get_data( prot.get_mapped_param_name( name )
-						  , tags[3] , tags[4], vtype , ttype , pt ) );
+		if( error )
+			std::rethrow_exception( error );
+
+		apply( *result );
 	} catch ( szbase_param_not_found_error& ) {
 		fail( ErrorCodes::unknown_param );
 	} catch ( szbase_error& e ) {
 		fail( ErrorCodes::szbase_error , e.what() );
 	}
+}
+
+void GetDataRcv::read_part( const std::string& from )
+{
+	auto szbase = vars.get_szbase();
+	auto result = std::make_shared<std::string>();
+	auto next = std::make_shared<std::string>();
+
+	auto param = this->param;
+	auto to = this->to;
+	auto vtype = value_type;
+	auto ttype = time_type;
+	auto pt = probe_type;
+	auto encoding = data_encoding;
 
+	szbase->offload(
+		[=] () {
+			*result = szbase->get_data_part( param , from , to , vtype , ttype , pt , encoding , PART_PROBES , *next );
+		} ,
+		std::bind( &GetDataRcv::on_part , this , lifetime() , result , next , std::placeholders::_1 ) );
 }
 
+void GetDataRcv::on_part( std::weak_ptr<bool> alive , std::shared_ptr<std::string> result , std::shared_ptr<std::string> next , std::exception_ptr error )
+{
+	if( alive.expired() )
+		return;
+
+	try {
+		if( error )
+			std::rethrow_exception( error );
+	} catch ( szbase_param_not_found_error& ) {
+		fail( ErrorCodes::unknown_param );
+		return;
+	} catch ( szbase_error& e ) {
+		fail( ErrorCodes::szbase_error , e.what() );
+		return;
+	}
+
+	response( *result );
+
+	if( next->empty() ) {
+		apply();
+		return;
+	}
+
+	/** Read next part only when previous ones are almost sent */
+	when_writable( [this, alive, next] () {
+		if( !alive.expired() )
+			read_part( *next );
+	} );
+}
 
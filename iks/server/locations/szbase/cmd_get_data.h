@@ -9,10 +9,27 @@ public:
 protected:
 	void parse_command( const std::string& data );
 
+	void on_data( std::weak_ptr<bool> alive , ResultsCache::result_ptr result , std::exception_ptr error );
+
+	void read_part( const std::string& from );
+
+	void on_part( std::weak_ptr<bool> alive , std::shared_ptr<std::string> result , std::shared_ptr<std::string> next , std::exception_ptr error );
+
+	/** Number of probes sent in single response of streamed reply */
+	static const size_t PART_PROBES = 4096;
+
 protected:
 	Vars& vars;
 	SzbaseProt& prot;
 
+	/** Streamed request */
+	std::string param;
+	std::string to;
+	ValueType value_type;
+	TimeType time_type;
+	ProbeType probe_type;
+	DataEncoding data_encoding;
+
 };
 
 #endif /* end of include guard: __SERVER_CMD_GET_DATA_H__ */
@@ -1,6 +1,7 @@
 #ifndef __SERVER_CMD_GET_HISTORY_H__
 #define __SERVER_CMD_GET_HISTORY_H__
 
+#include <algorithm>
 #include <ctime>
 #include <iterator>
 
@@ -41,6 +42,13 @@ protected:
 				l ,
 				balgo::is_any_of(" "), balgo::token_compress_on );
 
+		/** Reply is sent in parts as soon as they are read */
+		bool stream = false;
+		if( !tags.empty() && tags.back() == "stream" ) {
+			stream = true;
+			tags.pop_back();
+		}
+
 		if( tags.size() != 3 ) {
 			fail( ErrorCodes::ill_formed );
 			return;
@@ -74,15 +82,98 @@ protected:
 			return;
 		}
 
-		std::vector<f32_t> probes;
+		if( stream ) {
+			param_name = name;
+			probe = *pt;
+			end = tend;
+
+			read_part( tbeg );
+			return;
+		}
+
+		auto szbase = vars.get_szbase();
+		auto probes = std::make_shared< std::vector<f32_t> >();
+		ProbeType ptype = *pt;
+
+		szbase->offload(
+			[=] () {
+				*probes = get_probes( szbase , tbeg , tend , ptype , name );
+			} ,
+			std::bind( &GetHistoryRcv::on_probes , this , lifetime() ,
+					probes , tbeg , ptype , std::placeholders::_1 ) );
+	}
+
+	void on_probes( std::weak_ptr<bool> alive ,
+			std::shared_ptr< std::vector<f32_t> > probes_ptr ,
+			timestamp_t tbeg , ProbeType pt ,
+			std::exception_ptr error )
+	{
+		if( alive.expired() )
+			return;
 
 		try {
-			probes = get_data( tbeg , tend , *pt , name );
+			if( error )
+				std::rethrow_exception( error );
 		} catch ( const szbase_error& e ) {
 			fail( ErrorCodes::szbase_error , e.what() );
 			return;
 		}
 
+		apply( to_json( *probes_ptr , tbeg , pt ) );
+	}
+
+	void read_part( timestamp_t beg )
+	{
+		auto szbase = vars.get_szbase();
+		auto probes = std::make_shared< std::vector<f32_t> >();
+		auto name = param_name;
+		auto ptype = probe;
+		timestamp_t part_end = std::min( end , timestamp_t( SzbaseWrapper::next( beg , probe , PART_PROBES ) ) );
+
+		szbase->offload(
+			[=] () {
+				*probes = get_probes( szbase , beg , part_end , ptype , name );
+			} ,
+			std::bind( &GetHistoryRcv::on_part , this , lifetime() ,
+					probes , beg , part_end , std::placeholders::_1 ) );
+	}
+
+	void on_part( std::weak_ptr<bool> alive ,
+			std::shared_ptr< std::vector<f32_t> > probes ,
+			timestamp_t beg , timestamp_t part_end ,
+			std::exception_ptr error )
+	{
+		if( alive.expired() )
+			return;
+
+		try {
+			if( error )
+				std::rethrow_exception( error );
+		} catch ( const szbase_error& e ) {
+			fail( ErrorCodes::szbase_error , e.what() );
+			return;
+		}
+
+		using std::isnan;
+
+		/** Parts without any data are not sent */
+		if( std::any_of( probes->begin() , probes->end() , [] ( f32_t p ) { return !isnan( p ); } ) )
+			response( to_json( *probes , beg , probe ) );
+
+		if( part_end >= end ) {
+			apply();
+			return;
+		}
+
+		/** Read next part only when previous ones are almost sent */
+		when_writable( [this, alive, part_end] () {
+			if( !alive.expired() )
+				read_part( part_end );
+		} );
+	}
+
+	std::string to_json( const std::vector<f32_t>& probes , timestamp_t tbeg , ProbeType pt )
+	{
 		using std::isnan;
 		
 		auto beg = probes.begin();
@@ -95,26 +186,27 @@ protected:
 		auto ne = std::distance(probes.begin(),end);
 
 		std::string out;
-		std::copy( base64_enc((char*)(probes.data()+nb)) ,
-		           base64_enc((char*)(probes.data()+ne)) ,
+		std::copy( base64_enc((const char*)(probes.data()+nb)) ,
+		           base64_enc((const char*)(probes.data()+ne)) ,
 				   std::back_inserter(out) );
 
 		boost::property_tree::ptree ptree;
-		ptree.add("start", SzbaseWrapper::next(tbeg,*pt,nb));
-		ptree.add("end"  , SzbaseWrapper::next(tbeg,*pt,ne));
+		ptree.add("start", SzbaseWrapper::next(tbeg,pt,nb));
+		ptree.add("end"  , SzbaseWrapper::next(tbeg,pt,ne));
 		ptree.add("data", out);
-		apply( ptree_to_json( ptree , false ) );
+		return ptree_to_json( ptree , false );
 	}
 
-	std::vector<f32_t> get_data(
-			timestamp_t beg , timestamp_t end , ProbeType pt ,
-			const std::string& param )
-	{
-		return get_probes(vars, beg, end, pt, param);
-	}
+	/** Number of probes sent in single response of streamed reply */
+	static const int PART_PROBES = 8192;
 
 	Vars& vars;
 	SzbaseProt& prot;
+
+	/** Streamed request */
+	std::string param_name;
+	ProbeType probe;
+	timestamp_t end;
 };
 
 #endif /* end of include guard: __SERVER_CMD_GET_HISTORY_H__ */
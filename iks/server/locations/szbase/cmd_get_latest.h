@@ -51,10 +51,27 @@ protected:
 			return;
 		};
 
+		auto szbase = vars.get_szbase();
+		auto t = std::make_shared<time_t>();
+		ProbeType ptype = *pt;
+
+		szbase->offload(
+			[=] () {
+				*t = szbase->get_latest( name , ptype );
+			} ,
+			std::bind( &GetLatestRcv::on_latest , this , lifetime() , t , std::placeholders::_1 ) );
+	}
+
+	void on_latest( std::weak_ptr<bool> alive , std::shared_ptr<time_t> t , std::exception_ptr error )
+	{
+		if( alive.expired() )
+			return;
+
 		try {
-			auto t = vars.get_szbase()->get_latest( name , *pt );
+			if( error )
+				std::rethrow_exception( error );
 
-			apply( str( boost::format("%d") % t ) );
+			apply( str( boost::format("%d") % *t ) );
 		} catch( szbase_error& e ) {
 			fail( ErrorCodes::szbase_error , e.what() );
 		}
@@ -3,6 +3,7 @@
 
 #include <ctime>
 #include <iterator>
+#include <vector>
 
 #include <boost/format.hpp>
 
@@ -51,17 +52,35 @@ protected:
 			return;
 		};
 
-		try {
-			time_t t_max = 0;
-			for (auto param = set->begin(); param != set->end(); ++param) {
-				std::string param_name = *param;
-				auto t = vars.get_szbase()->get_latest( param_name , *pt );
-				if (t > t_max) {
-					t_max = t;
+		auto szbase = vars.get_szbase();
+		auto t_max = std::make_shared<time_t>( 0 );
+		std::vector<std::string> param_names;
+		for (auto param = set->begin(); param != set->end(); ++param)
+			param_names.push_back( *param );
+		ProbeType ptype = *pt;
+
+		szbase->offload(
+			[=] () {
+				for (auto& param_name : param_names) {
+					auto t = szbase->get_latest( param_name , ptype );
+					if (t > *t_max) {
+						*t_max = t;
+					}
 				}
-			}
+			} ,
+			std::bind( &GetLatestFromSetRcv::on_latest , this , lifetime() , t_max , std::placeholders::_1 ) );
+	}
+
+	void on_latest( std::weak_ptr<bool> alive , std::shared_ptr<time_t> t_max , std::exception_ptr error )
+	{
+		if( alive.expired() )
+			return;
+
+		try {
+			if( error )
+				std::rethrow_exception( error );
 
-			apply( str( boost::format("%d") % t_max ) );
+			apply( str( boost::format("%d") % *t_max ) );
 		} catch( szbase_error& e ) {
 			fail( ErrorCodes::szbase_error , e.what() );
 		}
@@ -78,15 +78,37 @@ protected:
 			return;
 		}
 
-		std::vector<f32_t> probes;
+		auto szbase = vars.get_szbase();
+		auto probes = std::make_shared< std::vector<f32_t> >();
+		ProbeType ptype = *pt;
+
+		szbase->offload(
+			[=] () {
+				*probes = get_probes( szbase , tbeg , tend , ptype , name );
+			} ,
+			std::bind( &GetSummaryRcv::on_probes , this , lifetime() ,
+					probes , probe_type , param->get_summaric_unit() ,
+					std::placeholders::_1 ) );
+	}
+
+	void on_probes( std::weak_ptr<bool> alive ,
+			std::shared_ptr< std::vector<f32_t> > probes_ptr ,
+			const std::string& probe_type , const std::string& unit ,
+			std::exception_ptr error )
+	{
+		if( alive.expired() )
+			return;
 
 		try {
-			probes = get_data( tbeg , tend , *pt , name );
+			if( error )
+				std::rethrow_exception( error );
 		} catch ( const szbase_error& e ) {
 			fail( ErrorCodes::szbase_error , e.what() );
 			return;
 		}
 
+		auto& probes = *probes_ptr;
+
 		using std::isnan;
 
 		int nanCount = 0;
@@ -102,7 +124,6 @@ protected:
 		const int divisor = probe_type == "10s" ? 360 : 6;
 		const double sum = accumulator / divisor;
 		const double notNanPercentage = 100 - ((double)nanCount / probes.size() * 100);
-		const auto unit = param->get_summaric_unit();
 
 		boost::property_tree::ptree ptree;
 		ptree.add("sum", sum);
@@ -111,13 +132,6 @@ protected:
 		apply( ptree_to_json( ptree , false ) );
 	}
 
-	std::vector<f32_t> get_data(
-			timestamp_t beg , timestamp_t end , ProbeType pt ,
-			const std::string& param )
-	{
-		return get_probes(vars, beg, end, pt, param);
-	}
-
 	Vars& vars;
 };
 
@@ -55,15 +55,34 @@ void SearchDataRcv::parse_command( const std::string& data )
 		return;
 	}
 		
+	auto szbase = vars.get_szbase();
+	auto param = prot.get_mapped_param_name( name );
+	auto from = tags[3];
+	auto to = tags[4];
+	auto result = std::make_shared<std::string>();
+
+	szbase->offload(
+		[=] () {
+			*result = szbase->search_data( param , from , to , ttype , dir , pt );
+		} ,
+		std::bind( &SearchDataRcv::on_data , this , lifetime() , result , std::placeholders::_1 ) );
+}
+
+void SearchDataRcv::on_data( std::weak_ptr<bool> alive , std::shared_ptr<std::string> result , std::exception_ptr error )
+{
+	if( alive.expired() )
+		return;
+
 	try {
-		apply( vars.get_szbase()->search_data( prot.get_mapped_param_name( name )
-						     , tags[3] , tags[4], ttype , dir , pt ) );
+		if( error )
+			std::rethrow_exception( error );
+
+		apply( *result );
 	} catch ( szbase_param_not_found_error& ) {
 		fail( ErrorCodes::unknown_param );
 	} catch ( szbase_error& e ) {
 		fail( ErrorCodes::szbase_error , e.what() );
 	}
-	
 }
 
 
@@ -9,6 +9,8 @@ public:
 protected:
 	void parse_command( const std::string& data );
 
+	void on_data( std::weak_ptr<bool> alive , std::shared_ptr<std::string> result , std::exception_ptr error );
+
 protected:
 	Vars& vars;
 	SzbaseProt& prot;
@@ -53,9 +53,11 @@ int main( int argc , char** argv )
 		("name", po::value<std::string>()->default_value(ba::ip::host_name()), "Servers name -- defaults to hostname.")
 		("prefix,P", po::value<std::string>()->default_value(PREFIX), "Szarp prefix")
 		("port,p", po::value<unsigned>()->default_value(9002), "Server port on which we will listen")
+		("worker_threads", po::value<unsigned>()->default_value(2), "Number of threads reading data from szbase, 0 reads it in the thread serving connections")
 		("base_cache_size_low_water_mark", po::value<size_t>()->default_value(SzbaseWrapper::BASE_CACHE_LOW_WATER_MARK_DEFAULT), "Szbase in-memory cache size low water mark (in bytes)")
 		("base_cache_size_high_water_mark", po::value<size_t>()->default_value(SzbaseWrapper::BASE_CACHE_HIGH_WATER_MARK_DEFAULT), "Szbase in-memory cache size high water mark (in bytes)")
-		("base_live_cache_retention", po::value<size_t>()->default_value(SzbaseWrapper::BASE_LIVE_CACHE_RETENTION), "Szbase in-memory live cache retention value (in seconds)");
+		("base_live_cache_retention", po::value<size_t>()->default_value(SzbaseWrapper::BASE_LIVE_CACHE_RETENTION), "Szbase in-memory live cache retention value (in seconds)")
+		("definable_store_dir", po::value<std::string>(), "Directory where computed values of definable params and summaries of param data files are kept between restarts. If not set they are kept in memory only.");
 
 	po::variables_map vm; 
 	CfgPairs pairs;
@@ -142,6 +144,20 @@ int main( int argc , char** argv )
 			pf << get_pid();
 		}
 
+		/**
+		 * Declared before workers, so that on any exit from this scope
+		 * workers are stopped while locations still exist
+		 */
+		LocationsMgr lm;
+
+		/**
+		 * Start worker threads after daemonizing, they would not
+		 * survive fork
+		 */
+		unsigned worker_threads = vm["worker_threads"].as<unsigned>();
+		sz_log(2, "Using %u szbase worker threads", worker_threads);
+		GlobalService::Workers workers( worker_threads );
+
 		{
 
 			size_t base_cache_size_low_water_mark = vm.count("base_cache_size_low_water_mark")
@@ -156,19 +172,24 @@ int main( int argc , char** argv )
 								? vm["base_live_cache_retention"].as<size_t>()
 								: SzbaseWrapper::BASE_LIVE_CACHE_RETENTION;
 
+			std::string definable_store_dir = vm.count("definable_store_dir")
+								? vm["definable_store_dir"].as<std::string>()
+								: std::string();
+
 			sz_log(2, "Using %zu as base cache size low water mark", base_cache_size_low_water_mark);
 			sz_log(2, "Using %zu as base cache size high water mark", base_cache_size_high_water_mark);
 			sz_log(2, "Using %zu as base live cache retention", base_live_cache_retention);
+			if( !definable_store_dir.empty() )
+				sz_log(2, "Using %s as definable params store directory", definable_store_dir.c_str());
 			SzbaseWrapper::init( vm["prefix"].as<std::string>()
 							   , locs_cfg
 							   , base_live_cache_retention
 							   , base_cache_size_low_water_mark
-							   , base_cache_size_high_water_mark);
+							   , base_cache_size_high_water_mark
+							   , definable_store_dir);
 
 		}
 
-		LocationsMgr lm;
-
 		lm.add_locations( locs_cfg );
 		lm.add_config( server_config );
 
@@ -179,6 +200,9 @@ int main( int argc , char** argv )
 
 		io_service.run();
 
+		/** Wait for szbase work before locations are gone */
+		workers.stop();
+
 	} catch( std::exception& e ) {
 		sz_log(0,"Exception occurred: %s" , e.what() );
 		ret_code = 1; /**< return error code */
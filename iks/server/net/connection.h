@@ -17,14 +17,24 @@ public:
 
 	virtual void write_line( const std::string& line ) = 0;
 
+	/**
+	 * False if too much data waits to be sent, on_writable is emitted
+	 * when this changes.
+	 */
+	virtual bool writable() const
+	{	return true; }
+
 	slot_connection on_line_received( const sig_line_slot& slot )
 	{	return emit_line_received.connect( slot ); }
 	slot_connection on_disconnect( const sig_connection_slot& slot )
 	{	return emit_disconnected.connect( slot ); }
+	slot_connection on_writable( const sig_connection_slot& slot )
+	{	return emit_writable.connect( slot ); }
 
 protected:
 	sig_line       emit_line_received;
 	sig_connection emit_disconnected;
+	sig_connection emit_writable;
 
 };
 
@@ -67,8 +67,10 @@ void TcpServer::handle_accept(
 	do_accept();
 }
 
+const size_t TcpConnection::WRITE_QUEUE_LIMIT = 1024 * 1024;
+
 TcpConnection::TcpConnection( ba::io_service& service )
-	: socket_(service)
+	: socket_(service) , queued_bytes(0)
 {
 }
 
@@ -127,6 +129,7 @@ void TcpConnection::handle_read_line(const bs::error_code& error, size_t bytes )
 void TcpConnection::do_write_line( const std::string& line )
 {
 	outbox.emplace_back( line.back() == '\n' ? line : line + '\n' );
+	queued_bytes += outbox.back().size();
 
 	/** If there is no pending line start sending this one */
 	if( sendbox.empty() )
@@ -156,11 +159,16 @@ void TcpConnection::handle_write(const bs::error_code& error)
 	if( handle_error(error) )
 		return;
 
+	for( auto& line : sendbox )
+		queued_bytes -= line.size();
 	sendbox.clear();
 
 	/** Continue sending */
 	if( !outbox.empty() )
 		schedule_next_line();
+
+	if( writable() )
+		emit_writable( this );
 }
 
 void TcpConnection::do_close()
@@ -56,6 +56,12 @@ public:
 	void write_line( const std::string& line )
 	{	do_write_line( line ); }
 
+	virtual bool writable() const
+	{	return queued_bytes < WRITE_QUEUE_LIMIT; }
+
+	/** Bytes waiting to be sent above which connection is not writable */
+	static const size_t WRITE_QUEUE_LIMIT;
+
 private:
 	void start();
 
@@ -78,6 +84,7 @@ private:
 
 	std::deque<std::string> outbox;
 	std::deque<std::string> sendbox;
+	size_t queued_bytes;
 };
 
 #endif /* __LINE_SERVER_H__ */
@@ -0,0 +1,66 @@
+#ifndef PARAMS_VALUES_ARENA_H
+#define PARAMS_VALUES_ARENA_H
+/*
+  SZARP: SCADA software
+
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+
+#include <vector>
+#include <google/protobuf/arena.h>
+
+#include "protobuf/paramsvalues.pb.h"
+
+/** Decodes ParamsValues messages on a protobuf arena that is reset
+ * before every message, so that a subscriber does not go through the
+ * heap for each ParamValue it receives. Memory of the last message
+ * stays valid only until the next call to create() or parse(), and
+ * the object must not be shared between threads. */
+class params_values_arena {
+	static const size_t initial_block_size = 64 * 1024;
+
+	std::vector<char> m_block;
+	google::protobuf::Arena m_arena;
+
+	static google::protobuf::ArenaOptions options(std::vector<char>& block) {
+		google::protobuf::ArenaOptions options;
+		options.initial_block = block.data();
+		options.initial_block_size = block.size();
+		return options;
+	}
+
+public:
+	params_values_arena() : m_block(initial_block_size), m_arena(options(m_block)) {}
+
+	params_values_arena(const params_values_arena&) = delete;
+	params_values_arena& operator=(const params_values_arena&) = delete;
+
+	/** Frees previous message and returns an empty one */
+	szarp::ParamsValues* create() {
+		m_arena.Reset();
+		return google::protobuf::Arena::CreateMessage<szarp::ParamsValues>(&m_arena);
+	}
+
+	/** @return decoded message or nullptr if data is malformed */
+	szarp::ParamsValues* parse(const void* data, size_t size) {
+		szarp::ParamsValues* values = create();
+		if (!values->ParseFromArray(data, size))
+			return nullptr;
+		return values;
+	}
+};
+
+#endif
@@ -22,11 +22,18 @@
 
 #include <vector>
 #include <set>
+#include <map>
+#include <memory>
+#include <atomic>
 
 #include <lua.hpp>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "sz4/types.h"
 #include "sz4/block.h"
@@ -36,6 +43,7 @@
 #include "sz4/defs.h"
 #include "sz4/param_observer.h"
 #include "sz4/param_observer.h"
+#include "sz4/definable_param_store.h"
 #include "szarp_base_common/lua_strings_extract.h"
 
 namespace sz4 {
@@ -48,6 +56,48 @@ typedef std::vector<
 		bool
 	> fixed_stack_type;
 
+/** State of queries evaluated by a single thread */
+template<class base> struct query_context {
+	fixed_stack_type fixed_stack;
+	boost::optional<SZARP_PROBE_TYPE> read_ahead;
+	std::unique_ptr<lua_interpreter<base>> interpreter;
+	int depth;
+	/** set when a time was taken from the heartbeat param, params
+	 * depending on it are not notified about its changes */
+	bool volatile_time;
+
+	query_context() : depth(0), volatile_time(false) {}
+};
+
+class thread_exit_observer {
+public:
+	virtual void thread_exited(const boost::thread::id& id) = 0;
+	virtual ~thread_exit_observer() {}
+};
+
+/** Calls @param observer (if it still exists) when the calling thread exits */
+void notify_on_thread_exit(std::weak_ptr<thread_exit_observer> observer);
+
+/** Query contexts of threads using a base, context of a thread
+ * is removed when the thread exits */
+template<class base> struct query_contexts : public thread_exit_observer {
+	boost::mutex lock;
+	std::map<boost::thread::id, std::unique_ptr<query_context<base>>> contexts;
+
+	void thread_exited(const boost::thread::id& id) {
+		/* destroyed after the lock is released */
+		std::unique_ptr<query_context<base>> context;
+
+		boost::lock_guard<boost::mutex> guard(lock);
+		auto i = contexts.find(id);
+		if (i == contexts.end())
+			return;
+
+		context = std::move(i->second);
+		contexts.erase(i);
+	}
+};
+
 template<class types> class base_templ {
 public:
 	typedef typename types::ipk_container_type ipk_container_type;
@@ -56,61 +106,107 @@ public:
 private:
 	const boost::filesystem::wpath m_szarp_data_dir;
 	std::vector<buffer_templ<base>*> m_buffers;
+	boost::recursive_mutex m_entries_lock;
 	SzbParamMonitor m_monitor;
 	ipk_container_type* m_ipk_container;
 
-	fixed_stack_type m_fixed_stack;
-	std::unique_ptr<lua_interpreter<base>> m_interperter;
+	std::shared_ptr<query_contexts<base>> m_contexts;
+	const unsigned long long m_id;
+	static std::atomic<unsigned long long> s_next_id;
 
 	block_cache m_cache;
+	/** held shared by running queries, exclusively when purging the cache */
+	boost::shared_mutex m_purge_lock;
 
 	std::unique_ptr<live_cache> m_live_cache;
 
-	boost::optional<SZARP_PROBE_TYPE> m_read_ahead;
+	std::unique_ptr<definable_store_writer> m_definable_store;
+
+	query_context<base>& context();
+
+	/** Marks the outermost query of a thread. Nested queries (e.g. from
+	 * LUA params) may still use cached blocks, so the cache is purged only
+	 * after the outermost query finishes */
+	class query_scope {
+		base_templ<types>* m_base;
+		query_context<base>& m_context;
+	public:
+		query_scope(base_templ<types>* base) : m_base(base), m_context(base->context()) {
+			if (m_context.depth++ == 0)
+				m_base->m_purge_lock.lock_shared();
+		}
+
+		~query_scope() {
+			if (--m_context.depth == 0) {
+				m_base->m_purge_lock.unlock_shared();
+				m_base->purge_cache();
+			}
+		}
+	};
 public:
 	base_templ(const std::wstring& szarp_data_dir,
 			ipk_container_type* ipk_container,
 			live_cache_config* live_config = nullptr);
 
 	template<class V, class T> void get_weighted_sum(TParam* param, const T& start, const T& end, SZARP_PROBE_TYPE probe_type, weighted_sum<V, T>& sum) {
+		query_scope scope(this);
 		buffer_for_param(param)->get_weighted_sum(param, start, end, probe_type, sum);
 	}
 
+	/** Fills sums with weighted sums of consecutive probes of type probe_type,
+	 * the first starting at start and the last one covering end */
+	template<class V, class T> void get_weighted_sums(TParam* param, const T& start, const T& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<V, T> >& sums) {
+		query_scope scope(this);
+		buffer_for_param(param)->get_weighted_sums(param, start, end, probe_type, sums);
+	}
+
 	template<class T> T search_data_right(TParam* param, const T& start, const T& end, SZARP_PROBE_TYPE probe_type, const search_condition& condition) {
+		query_scope scope(this);
 		return buffer_for_param(param)->search_data_right(param, start, end, probe_type, condition);
 	}
 
 	template<class T> T search_data_left(TParam* param, const T& start, const T& end, SZARP_PROBE_TYPE probe_type, const search_condition& condition) {
+		query_scope scope(this);
 		return buffer_for_param(param)->search_data_left(param, start, end, probe_type, condition);
 	}
 
 	template<class T> void get_first_time(TParam* param, T& t) {
+		query_scope scope(this);
 		buffer_for_param(param)->get_first_time(param, t);
 	}
 
 	template<class T> void get_heartbeat_first_time(TParam* param, T& t) {
+		query_scope scope(this);
+		volatile_time() = true;
 		buffer_for_param(param)->get_heartbeat_first_time(t);
 	}
 
 	template<class T> void get_last_time(TParam* param, T& t) {
+		query_scope scope(this);
 		buffer_for_param(param)->get_last_time(param, t);
 	}
 
 	template<class T> void get_heartbeat_last_time(TParam* param, T& t) {
+		query_scope scope(this);
+		volatile_time() = true;
 		buffer_for_param(param)->get_heartbeat_last_time(t);
 	}
 
 	boost::optional<SZARP_PROBE_TYPE>& read_ahead();
 
+	/** Flag of current thread telling that first/last time being
+	 * calculated must not be memoized */
+	bool& volatile_time();
+
 	buffer_templ<base>* buffer_for_param(TParam* param);
 
 	generic_param_entry* get_param_entry(TParam* param);
 
 	void remove_param(TParam* param);
 
-	void register_observer(param_observer *observer, const std::vector<TParam*>& params);
+	void register_observer(param_observer *observer, const std::vector<TParam*>& definable);
 
-	void deregister_observer(param_observer *observer, const std::vector<TParam*>& params);
+	void deregister_observer(param_observer *observer, const std::vector<TParam*>& definable);
 
 	fixed_stack_type& fixed_stack();
 
@@ -122,8 +218,23 @@ public:
 
 	block_cache* cache();
 
+	void purge_cache();
+
+	boost::recursive_mutex& entries_lock();
+
 	live_cache* get_live_cache();
 
+	/** Keeps fixed values of definable params in directory dir between runs,
+	 * should be called before the first query */
+	void enable_definable_store(const std::wstring& dir);
+
+	/** Writer of the definable params store, NULL if store is not enabled */
+	definable_store_writer* definable_store();
+
+	/** Directories of real params that values of param are computed from
+	 * and definable params they are computed through, param included */
+	void referred_data_dirs(TParam* param, std::vector<boost::filesystem::wpath>& dirs, std::vector<TParam*>& definable);
+
 	~base_templ();
 };
 
@@ -1,9 +1,10 @@
 namespace sz4 {
 
 template<class types>
-base_templ<types>::base_templ(const std::wstring& szarp_data_dir, ipk_container_type* ipk_container, live_cache_config* live_config) : m_szarp_data_dir(szarp_data_dir), m_monitor(szarp_data_dir), m_ipk_container(ipk_container) {
-	m_interperter.reset(new lua_interpreter<base>());
-	m_interperter->initialize(this, m_ipk_container);
+std::atomic<unsigned long long> base_templ<types>::s_next_id(1);
+
+template<class types>
+base_templ<types>::base_templ(const std::wstring& szarp_data_dir, ipk_container_type* ipk_container, live_cache_config* live_config) : m_szarp_data_dir(szarp_data_dir), m_monitor(szarp_data_dir), m_ipk_container(ipk_container), m_contexts(std::make_shared<query_contexts<base>>()), m_id(s_next_id++) {
 #ifndef MINGW32
 	if (live_config)
 		m_live_cache.reset(new live_cache(*live_config, new zmq::context_t(1)));
@@ -12,11 +13,35 @@ base_templ<types>::base_templ(const std::wstring& szarp_data_dir, ipk_container_
 
 }
 
+template<class types> query_context<base_templ<types>>& base_templ<types>::context() {
+	/*ids are never reused, so an entry left by a destroyed base never matches*/
+	static thread_local std::pair<unsigned long long, query_context<base>*> last_context(0, nullptr);
+	if (last_context.first == m_id)
+		return *last_context.second;
+
+	boost::lock_guard<boost::mutex> guard(m_contexts->lock);
+	std::unique_ptr<query_context<base>>& context = m_contexts->contexts[boost::this_thread::get_id()];
+	if (!context) {
+		context.reset(new query_context<base>());
+		context->interpreter.reset(new lua_interpreter<base>());
+		context->interpreter->initialize(this, m_ipk_container);
+		notify_on_thread_exit(m_contexts);
+	}
+
+	last_context = std::make_pair(m_id, context.get());
+	return *context;
+}
+
 template<class types> boost::optional<SZARP_PROBE_TYPE>& base_templ<types>::read_ahead() {
-	return m_read_ahead;
+	return context().read_ahead;
+}
+
+template<class types> bool& base_templ<types>::volatile_time() {
+	return context().volatile_time;
 }
 
 template<class types> buffer_templ<base_templ<types>>* base_templ<types>::buffer_for_param(TParam* param) {
+	boost::lock_guard<boost::recursive_mutex> lock(m_entries_lock);
 	buffer_templ<base>* buf;
 	if (param->GetConfigId() >= m_buffers.size())
 		m_buffers.resize(param->GetConfigId() + 1, NULL);
@@ -40,6 +65,7 @@ generic_param_entry* base_templ<types>::get_param_entry(TParam* param) {
 
 template<class types>
 void base_templ<types>::remove_param(TParam* param) {
+	boost::lock_guard<boost::recursive_mutex> lock(m_entries_lock);
 	if (param->GetConfigId() >= m_buffers.size())
 		return;
 
@@ -69,13 +95,13 @@ void base_templ<types>::deregister_observer(param_observer *observer, const std:
 }
 
 template<class types>
-fixed_stack_type& base_templ<types>::fixed_stack() { return m_fixed_stack; }
+fixed_stack_type& base_templ<types>::fixed_stack() { return context().fixed_stack; }
 
 template<class types>
 SzbParamMonitor& base_templ<types>::param_monitor() { return m_monitor; }
 
 template<class types>
-lua_interpreter<base_templ<types>>& base_templ<types>::get_lua_interpreter() { return *m_interperter; }
+lua_interpreter<base_templ<types>>& base_templ<types>::get_lua_interpreter() { return *context().interpreter; }
 
 template<class types>
 typename base_templ<types>::ipk_container_type* base_templ<types>::get_ipk_container() { return m_ipk_container; }
@@ -83,9 +109,56 @@ typename base_templ<types>::ipk_container_type* base_templ<types>::get_ipk_conta
 template<class types>
 block_cache* base_templ<types>::cache() { return &m_cache; }
 
+template<class types>
+void base_templ<types>::purge_cache() {
+	if (!m_cache.over_high_water_mark())
+		return;
+
+	boost::unique_lock<boost::shared_mutex> lock(m_purge_lock);
+	m_cache.purge();
+}
+
+template<class types>
+boost::recursive_mutex& base_templ<types>::entries_lock() { return m_entries_lock; }
+
 template<class types>
 live_cache* base_templ<types>::get_live_cache() { return m_live_cache.get(); }
 
+template<class types>
+void base_templ<types>::enable_definable_store(const std::wstring& dir) {
+	m_definable_store.reset(new definable_store_writer(dir));
+}
+
+template<class types>
+definable_store_writer* base_templ<types>::definable_store() { return m_definable_store.get(); }
+
+template<class types>
+void base_templ<types>::referred_data_dirs(TParam* param, std::vector<boost::filesystem::wpath>& dirs, std::vector<TParam*>& definable) {
+	boost::lock_guard<boost::recursive_mutex> lock(m_entries_lock);
+
+	std::set<TParam*> visited;
+	std::vector<TParam*> params(1, param);
+	while (params.size()) {
+		TParam* p = params.back();
+		params.pop_back();
+		if (!visited.insert(p).second)
+			continue;
+
+		if (p->GetSz4Type() == Sz4ParamType::REAL) {
+			dirs.push_back(buffer_for_param(p)->param_dir(p));
+			continue;
+		}
+
+		definable.push_back(p);
+
+		const std::list<generic_param_entry*>& referred = get_param_entry(p)->referred_params();
+		for (auto i = referred.begin(); i != referred.end(); i++)
+			params.push_back((*i)->get_param());
+	}
+
+	std::sort(dirs.begin(), dirs.end());
+}
+
 template<class types>
 base_templ<types>::~base_templ() {
 	for (auto i = m_buffers.begin(); i != m_buffers.end(); i++)
@@ -20,11 +20,14 @@
 #include <algorithm>
 #include <iterator>
 #include <list>
+#include <type_traits>
+#include <vector>
 
 #include <boost/intrusive/list.hpp>
 
 #include "sz4/defs.h"
 #include "sz4/time.h"
+#include "sz4/value_time_soa.h"
 
 namespace sz4 {
 
@@ -45,6 +48,11 @@ template<class iterator, class time_type> iterator search_entry_for_time(iterato
 	return std::upper_bound(begin, end, t, cmp_time<time_type, pair_type>);
 }
 
+template<class V, class T, class time_type> value_time_soa_iterator<V, T> search_entry_for_time(
+		value_time_soa_iterator<V, T> begin, value_time_soa_iterator<V, T> end, const time_type& t) {
+	return begin + (std::upper_bound(begin.time_ptr(), end.time_ptr(), t) - begin.time_ptr());
+}
+
 template<class iterator, class time_type, class value_type> 
 void get_weighted_sum(iterator begin, iterator end,
 		const time_type& start_time, const time_type &end_time,
@@ -73,6 +81,65 @@ void get_weighted_sum(iterator begin, iterator end,
 	}
 }
 
+template<class value_type, class time_type>
+void get_weighted_sum(const std::vector<value_time_pair<value_type, time_type> >& data,
+		const time_type& start_time, const time_type &end_time,
+		weighted_sum<value_type, time_type>& r)
+{
+	get_weighted_sum(data.begin(), data.end(), start_time, end_time, r);
+}
+
+template<class value_type, class time_type>
+void get_weighted_sum(const value_time_soa_vector<value_type, time_type>& data,
+		const time_type& start_time, const time_type &end_time,
+		weighted_sum<value_type, time_type>& r)
+{
+	const std::vector<value_type>& values = data.values();
+	const std::vector<time_type>& times = data.times();
+
+	size_t i = std::upper_bound(times.begin(), times.end(), start_time) - times.begin();
+	size_t j = std::lower_bound(times.begin() + i, times.end(), end_time) - times.begin();
+
+	time_type prev_time = start_time;
+	for (; i <= j && i < times.size(); i++) {
+		typename time_difference<time_type>::type time_diff;
+		if (i == j)
+			time_diff = end_time - prev_time;
+		else
+			time_diff = times[i] - prev_time;
+		prev_time = times[i];
+
+		if (!value_is_no_data(values[i]))
+			r.add(values[i], time_diff);
+		else
+			r.add_no_data_weight(time_diff);
+	}
+}
+
+/** Float blocks with second resolution, values are added in order
+ * without a virtual call per entry; results are identical to the
+ * generic version above */
+void get_weighted_sum(const std::vector<value_time_pair<float, second_time_t> >& data,
+		const second_time_t& start_time, const second_time_t &end_time,
+		weighted_sum<float, second_time_t>& r);
+
+void get_weighted_sum(const std::vector<value_time_pair<double, second_time_t> >& data,
+		const second_time_t& start_time, const second_time_t &end_time,
+		weighted_sum<double, second_time_t>& r);
+
+#ifdef __SIZEOF_INT128__
+/** Integer blocks with second resolution, products are accumulated in
+ * native registers and added to r in one go; results are identical to
+ * the generic version above */
+void get_weighted_sum(const std::vector<value_time_pair<short, second_time_t> >& data,
+		const second_time_t& start_time, const second_time_t &end_time,
+		weighted_sum<short, second_time_t>& r);
+
+void get_weighted_sum(const std::vector<value_time_pair<int, second_time_t> >& data,
+		const second_time_t& start_time, const second_time_t &end_time,
+		weighted_sum<int, second_time_t>& r);
+#endif
+
 template<class iterator, class time_type, class search_op>
 iterator search_data_left_t(
 		iterator begin, iterator end,
@@ -119,6 +186,27 @@ iterator search_data_right_t(
 	return end;
 }
 
+template<class V, class T, class time_type, class search_op>
+value_time_soa_iterator<V, T> search_data_right_t(
+		value_time_soa_iterator<V, T> begin, value_time_soa_iterator<V, T> end,
+		const time_type& start_time, const time_type& end_time,
+		const search_op &condition) {
+
+	auto i = search_entry_for_time(begin, end, start_time);
+	const V* values = i.value_ptr();
+	const T* times = i.time_ptr();
+	const T* last = end.time_ptr();
+
+	for (; times != last; ++values, ++times) {
+		if (condition(*values))
+			return begin + (times - begin.time_ptr());
+
+		if (*times >= end_time)
+			break;
+	}
+	return end;
+}
+
 class block_cache;
 class generic_block {
 protected:
@@ -137,6 +225,10 @@ public:
 	virtual ~generic_block();
 
 	boost::intrusive::list_member_hook<> m_list_entry;
+
+	/** block_cache bookkeeping, guarded by the lock of the block's cache shard */
+	bool m_cache_protected;
+	size_t m_cache_stamp;
 };
 
 class cache_block_size_updater {
@@ -158,6 +250,34 @@ template<class T> struct empty_merge {
 	void operator()(T& t, T& t2, T& t3) const {}
 };
 
+/** Container used by value_time_block to hold entries */
+template<class value_time_type> struct block_storage {
+	typedef std::vector<value_time_type> type;
+};
+
+/** Natural alignment of a value or time, nanosecond_time_t is packed
+ * but its fields are 32 bit */
+template<class T> struct field_alignment {
+	static const size_t value = alignof(T);
+};
+
+template<> struct field_alignment<nanosecond_time_t> {
+	static const size_t value = alignof(uint32_t);
+};
+
+/** Packed pairs with size not a multiple of alignment of their fields leave
+ * values or times of every other entry misaligned, blocks of such pairs
+ * (e.g. short values with second or nanosecond times, doubles with second
+ * times) keep times and values in separate arrays */
+template<class V, class T> struct block_storage<value_time_pair<V, T> > {
+	static const bool split = sizeof(value_time_pair<V, T>) % field_alignment<V>::value != 0
+		|| sizeof(value_time_pair<V, T>) % field_alignment<T>::value != 0;
+
+	typedef typename std::conditional<split,
+			value_time_soa_vector<V, T>,
+			std::vector<value_time_pair<V, T> > >::type type;
+};
+
 template<
 	class value_time_type,
 	class value_cmp = std::equal_to<typename value_time_type::value_type>,
@@ -167,7 +287,7 @@ public:
 	typedef typename value_time_type::value_type value_type;
 	typedef typename value_time_type::time_type time_type;
 
-	typedef std::vector<value_time_type> value_time_vector;
+	typedef typename block_storage<value_time_type>::type value_time_vector;
 
 	value_time_block(const time_type& time,
 		block_cache* cache)
@@ -177,6 +297,7 @@ public:
 	{}
 
 	const time_type& start_time() const { return m_start_time; }
+	void set_start_time(const time_type& time) { m_start_time = time; }
 	const time_type end_time() const {
 		if (m_data.size())
 			return m_data[m_data.size() - 1].time;
@@ -242,9 +363,9 @@ public:
 		if (!m_data.size())
 			m_data.push_back(make_value_time_pair<value_time_type>(value, time));
 		else {
-			value_time_type& last_value_time = *m_data.rbegin();
-			if (last_value_time.value == value) {
-				last_value_time.time = time;
+			auto last_value_time = m_data.end() - 1;
+			if (last_value_time->value == value) {
+				last_value_time->time = time;
 			} else {
 				m_data.push_back(make_value_time_pair<value_time_type>(value, time));
 			}
@@ -261,6 +382,16 @@ public:
 		m_data.insert(m_data.end(), begin + 1, end);
 	}
 
+	template<class input_iterator> void insert_entries(typename value_time_vector::iterator i, input_iterator begin, input_iterator end) {
+		cache_block_size_updater _updater(this);
+		m_data.insert(i, begin, end);
+	}
+
+	void erase_entries(typename value_time_vector::iterator begin, typename value_time_vector::iterator end) {
+		cache_block_size_updater _updater(this);
+		m_data.erase(begin, end);
+	}
+
 	typename value_time_vector::iterator insert_entry(typename value_time_vector::iterator i, const value_type& value, const time_type& time) {
 		cache_block_size_updater _updater(this);
 		return m_data.insert(i, make_value_time_pair<value_time_type>(value, time));
@@ -271,6 +402,12 @@ public:
 		m_data.swap(data);
 	}
 
+	/** Copies entries kept in a different container */
+	template<class vector_type> void set_data(const vector_type& data) {
+		cache_block_size_updater _updater(this);
+		m_data.assign(data.begin(), data.end());
+	}
+
 	void maybe_merge_3_block_entries(typename value_time_vector::iterator i) {
 		cache_block_size_updater _updater(this);
 		if (i != m_data.begin()
@@ -309,7 +446,14 @@ public:
 
 		this->m_cache->block_touched(*this);
 
-		sz4::get_weighted_sum(this->m_data.begin(), this->m_data.end(), start_time, end_time, r);
+		sz4::get_weighted_sum(this->m_data, start_time, end_time, r);
+	}
+
+	values_summary summary() const {
+		values_summary summary;
+		for (size_t i = 0; i < this->m_data.size(); i++)
+			summary.add(this->m_data[i].value);
+		return summary;
 	}
 
 	time_type search_data_right(const time_type& start, const time_type& end, const search_condition &condition) {
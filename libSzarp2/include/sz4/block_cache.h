@@ -19,21 +19,79 @@
 #ifndef __SZ4_BLOCK_CACHE_H__
 #define __SZ4_BLOCK_CACHE_H__
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include <boost/intrusive/list.hpp>
 
 namespace sz4 {
 
+struct block_cache_stats {
+	size_t size_in_bytes;
+	size_t blocks_count;
+	/** number of times a cached block was used */
+	size_t hits;
+	/** number of blocks that had to be loaded */
+	size_t misses;
+	/** number of blocks removed from cache to make room */
+	size_t evictions;
+};
+
+/**
+ * Cache of data blocks, split into independently locked shards.
+ *
+ * Each shard runs a 2Q-like policy: a new block goes to a probationary FIFO
+ * and is promoted to the protected LRU queue only if it is used again after
+ * other blocks have been loaded into the shard. Blocks read once by a long
+ * scan are therefore evicted before the working set of repeated queries.
+ *
+ * Eviction happens when the cache grows above the high water mark and
+ * removes blocks until the cache size drops to the low water mark. Since
+ * evicted blocks are deleted, purge() must only be called when no block
+ * is in use, the base does it when no query is running.
+ */
 class block_cache {
-	generic_block_list m_blocks;
-	size_t m_cache_size;
+	struct shard {
+		std::mutex m_lock;
+		generic_block_list m_probation;
+		generic_block_list m_protected;
+		size_t m_probation_size;
+		size_t m_protected_size;
+		size_t m_loads;
+
+		size_t m_hits;
+		size_t m_misses;
+		size_t m_evictions;
+
+		shard();
+		generic_block_list& queue(generic_block& block);
+		size_t& queue_size(generic_block& block);
+		generic_block* unlink_victim();
+	};
+
+	std::vector<std::unique_ptr<shard>> m_shards;
+	std::atomic<size_t> m_cache_size;
+	std::atomic<size_t> m_high_water_mark;
+	std::atomic<size_t> m_low_water_mark;
+	std::atomic<size_t> m_next_shard;
+
+	shard& shard_for_block(generic_block& block);
 public:
-	block_cache();
+	static const size_t default_shards_count = 16;
+
+	block_cache(size_t shards_count = default_shards_count);
 	void cache_size(size_t& size_in_bytes, size_t& blocks_count) const;
+	void shards_stats(std::vector<block_cache_stats>& stats) const;
+	void set_water_marks(size_t low_water_mark, size_t high_water_mark);
 	void add_new_block(generic_block& block);
 	void remove_block(generic_block& block, size_t block_size);
 	void block_size_changed(generic_block& block, size_t previous_size);
 	void block_touched(generic_block& block);
 	void remove(size_t size);
+	bool over_high_water_mark() const;
+	void purge();
 };
 
 }
@@ -62,6 +62,10 @@ public:
 		get_param_entry(param)->get_weighted_sum(start, end, probe_type, wsum);
 	}
 
+	template<class T, class V> void get_weighted_sums(TParam* param, const T& start, const T &end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<V, T> > &sums) {
+		get_param_entry(param)->get_weighted_sums(start, end, probe_type, sums);
+	}
+
 	template<class T> T search_data_right(TParam* param, const T& start, const T& end, SZARP_PROBE_TYPE probe_type, const search_condition &condition) {
 		return get_param_entry(param)->search_data_right(start, end, probe_type, condition);
 	}
@@ -72,6 +76,10 @@ public:
 
 	generic_param_entry* create_param_entry(TParam* param);
 
+	boost::filesystem::wpath param_dir(TParam* param) const {
+		return m_buffer_directory / param->GetSzbaseName();
+	}
+
 	void get_heartbeat_first_time(nanosecond_time_t& t) {
 		m_heart_beat_entry->get_first_time(t);
 	}
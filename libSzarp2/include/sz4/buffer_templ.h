@@ -38,6 +38,7 @@ template<class base> buffer_templ<base>::buffer_templ(base* _base, SzbParamMonit
 }
 
 template<class base> generic_param_entry* buffer_templ<base>::get_param_entry(TParam* param) {
+	boost::lock_guard<boost::recursive_mutex> lock(m_base->entries_lock());
 	if (m_param_ents.size() <= param->GetParamId())
 		m_param_ents.resize(param->GetParamId() + 1, NULL);
 
@@ -157,6 +158,7 @@ template<class base> void buffer_templ<base>::get_heartbeat_last_time(nanosecond
 }
 
 template<class base> void buffer_templ<base>::remove_param(TParam* param) {
+	boost::lock_guard<boost::recursive_mutex> lock(m_base->entries_lock());
 	if (m_param_ents.size() <= param->GetParamId())
 		return;
 
@@ -20,8 +20,12 @@
 */
 
 
+#include <set>
+
 #include <boost/scoped_ptr.hpp>
 
+#include "sz4/definable_param_store.h"
+
 namespace sz4 {
 
 template<class value_type, class time_type, class types, template<class calc_types> class calculation_method> class buffered_param_entry_in_buffer : public SzbParamObserver {
@@ -35,8 +39,53 @@ protected:
 	typedef definable_param_cache<value_type, time_type> cache_type;
 	typedef std::vector<cache_type> cache_vector;
 	cache_vector m_cache;
+
+	typedef definable_param_store<value_type, time_type> store_type;
+	std::vector<std::unique_ptr<store_type> > m_stores;
+	std::shared_ptr<definable_store_source> m_store_source;
+	int m_operations;
+
+	/** Data files of referred params changed since last operation */
+	boost::mutex m_changed_lock;
+	std::set<std::pair<TParam*, std::string> > m_changed_files;
+
+	/** Store files stay mapped only while an operation on the entry runs */
+	class operation_scope {
+		_type* m_entry;
+	public:
+		operation_scope(_type* entry) : m_entry(entry) {
+			if (!m_entry->m_operations++)
+				m_entry->invalidate_non_fixed_if_needed();
+		}
+
+		~operation_scope() {
+			if (--m_entry->m_operations)
+				return;
+			for (auto& s : m_entry->m_stores)
+				if (s)
+					s->release();
+		}
+	};
+
+	/** Created on first use, referred params are not known in constructor */
+	store_type* store(SZARP_PROBE_TYPE pt) {
+		definable_store_writer* writer = m_base->definable_store();
+		if (!writer)
+			return nullptr;
+
+		if (!m_store_source) {
+			std::vector<boost::filesystem::wpath> dirs;
+			std::vector<TParam*> params;
+			m_base->referred_data_dirs(m_param, dirs, params);
+			m_store_source = std::make_shared<definable_store_source>(m_param, dirs, params);
+		}
+
+		if (!m_stores[pt])
+			m_stores[pt].reset(new store_type(writer, m_store_source, pt));
+		return m_stores[pt].get();
+	}
 public:
-	buffered_param_entry_in_buffer(typename types::base*_base, TParam* param, const boost::filesystem::wpath&) : m_base(_base), m_param(param), m_invalidate_non_fixed(false)
+	buffered_param_entry_in_buffer(typename types::base*_base, TParam* param, const boost::filesystem::wpath&) : m_base(_base), m_param(param), m_invalidate_non_fixed(false), m_stores(PT_LAST), m_operations(0)
 	{
 		for (SZARP_PROBE_TYPE p = PT_FIRST; p < PT_LAST; p = SZARP_PROBE_TYPE(p + 1))
 			m_cache.push_back(definable_param_cache<value_type, time_type>(p, _base->cache()));
@@ -47,6 +96,19 @@ public:
 			return;
 
 		std::for_each(m_cache.begin(), m_cache.end(), std::mem_fun_ref(&cache_type::invalidate_non_fixed_values));
+
+		std::set<std::pair<TParam*, std::string> > changed;
+		{
+			boost::mutex::scoped_lock lock(m_changed_lock);
+			changed.swap(m_changed_files);
+		}
+		if (m_store_source)
+			for (auto& c : changed)
+				m_store_source->file_changed(m_base->buffer_for_param(c.first)->param_dir(c.first), c.second);
+
+		for (auto& s : m_stores)
+			if (s)
+				s->data_changed();
 		m_invalidate_non_fixed = false;
 	}
 
@@ -74,18 +136,82 @@ public:
 		value_type cached_value;
 		auto cached_data = m_cache[pt].get_value(time, cached_value, fixed);
 		if (!cached_data) {
+			store_type* pt_store = store(pt);
+			if (pt_store && pt_store->get_value(time, cached_value)) {
+				m_cache[pt].store_value(cached_value, time, true);
+				return cached_value;
+			}
+
 			double value;
 			bool fixed;
 			std::tr1::tie(value, fixed) = ee.calculate_value(time, pt);
-			m_cache[pt].store_value(value, time, fixed);
-			cached_value = value_is_no_data(value)? no_data<value_type>() : static_cast<value_type>(value);
+			cached_value = store_calculated_value(value, fixed, time, pt, pt_store);
 		}
 
 		return cached_value;
 	}
 
+	value_type store_calculated_value(double value, bool fixed, const time_type& time, SZARP_PROBE_TYPE pt, store_type* pt_store) {
+		m_cache[pt].store_value(value, time, fixed);
+		value_type cached_value = value_is_no_data(value)? no_data<value_type>() : static_cast<value_type>(value);
+
+		if (pt_store && fixed)
+			pt_store->add_value(cached_value, time, szb_move_time(time, 1, pt));
+
+		return cached_value;
+	}
+
+	/** Calculates all probes in [from, to) not present in cache in one go,
+	 * if calculation method can fetch referred params for whole range */
+	void calculate_range(calculation_method<types>& ee, const time_type& from, const time_type& to, SZARP_PROBE_TYPE pt) {
+		if (!ee.can_calculate_values())
+			return;
+
+		store_type* pt_store = store(pt);
+
+		std::vector<bool> missing;
+		size_t first = 0, missing_count = 0;
+		time_type first_time, end_time;
+		for (time_type current = from; current < to; ) {
+			time_type next = szb_move_time(current, 1, pt);
+
+			value_type value;
+			bool fixed;
+			bool found = m_cache[pt].get_value(current, value, fixed);
+			if (!found && pt_store && pt_store->get_value(current, value)) {
+				m_cache[pt].store_value(value, current, true);
+				found = true;
+			}
+
+			if (!found) {
+				if (!missing_count++) {
+					first = missing.size();
+					first_time = current;
+				}
+				end_time = next;
+			}
+			missing.push_back(!found);
+
+			current = next;
+		}
+
+		if (missing_count < 2)
+			return;
+
+		std::vector<std::tr1::tuple<double, bool> > values;
+		if (!ee.calculate_values(first_time, end_time, pt, values))
+			return;
+
+		time_type current = first_time;
+		for (size_t i = 0; i < values.size() && first + i < missing.size(); i++) {
+			if (missing[first + i])
+				store_calculated_value(std::tr1::get<0>(values[i]), std::tr1::get<1>(values[i]), current, pt, pt_store);
+			current = szb_move_time(current, 1, pt);
+		}
+	}
+
 	void get_weighted_sum_impl(time_type start, time_type end, SZARP_PROBE_TYPE probe_type, weighted_sum<value_type, time_type>& sum)  {
-		invalidate_non_fixed_if_needed();
+		operation_scope scope(this);
 
 		time_type range_end;
 		boost::optional<SZARP_PROBE_TYPE> read_ahead(m_base->read_ahead());
@@ -113,11 +239,22 @@ public:
 		
 		calculation_method<types> ee(m_base, m_param);
 		bool first = true;
+		bool range_calculated = false;
 		time_type& current(from);
 		while (current < to) {
 			bool fixed = true;
 			time_type next = szb_move_time(current, 1, step);
 
+			/* whole range is calculated from the first probe not in cache */
+			if (!range_calculated) {
+				value_type value;
+				bool value_fixed;
+				if (!m_cache[step].get_value(current, value, value_fixed)) {
+					calculate_range(ee, current, to, step);
+					range_calculated = true;
+				}
+			}
+
 			value_type cached_value = get_value(ee, current, step);
 
 			if (current < end) {
@@ -141,8 +278,15 @@ public:
 		m_base->read_ahead() = read_ahead;
 	}
 
+	void get_weighted_sums_impl(const std::vector<std::pair<time_type, time_type> >& ranges, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<value_type, time_type> >& sums) {
+		operation_scope scope(this);
+		sums.assign(ranges.size(), weighted_sum<value_type, time_type>());
+		for (size_t i = 0; i < ranges.size(); i++)
+			get_weighted_sum_impl(ranges[i].first, ranges[i].second, probe_type, sums[i]);
+	}
+
 	time_type search_data_right_impl(time_type start, time_type end, SZARP_PROBE_TYPE probe_type, const search_condition& condition) {
-		invalidate_non_fixed_if_needed();
+		operation_scope scope(this);
 
 		calculation_method<types> ee(m_base, m_param);
 
@@ -169,7 +313,7 @@ public:
 	}
 
 	time_type search_data_left_impl(time_type start, time_type end, SZARP_PROBE_TYPE probe_type, const search_condition& condition) {
-		invalidate_non_fixed_if_needed();
+		operation_scope scope(this);
 
 		calculation_method<types> ee(m_base, m_param);
 		
@@ -252,7 +396,11 @@ public:
 	void deregister_from_monitor(generic_param_entry* entry, SzbParamMonitor* monitor) {
 	}
 
-	void param_data_changed(TParam*, const std::string& path) {
+	void param_data_changed(TParam* param, const std::string& path) {
+		if (path.size() && m_base->definable_store()) {
+			boost::mutex::scoped_lock lock(m_changed_lock);
+			m_changed_files.insert(std::make_pair(param, path));
+		}
 		m_invalidate_non_fixed = true;
 	}
 /*
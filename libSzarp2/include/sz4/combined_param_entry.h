@@ -33,6 +33,16 @@ public:
 		this->m_weight += weight;
 	}
 
+	bool add_sum(const parent_type& other) {
+		const summary_weighted_sum<short, T>* summary = dynamic_cast<const summary_weighted_sum<short, T>*>(&other);
+		if (!summary)
+			return false;
+
+		parent_type::add_sum(other);
+		this->m_wsum += typename parent_type::sum_type(65536) * summary->negative_weight();
+		return true;
+	}
+
 };
 
 template<class types> class combined_calculate {
@@ -83,6 +93,14 @@ public:
 		return std::tr1::tuple<double, bool>(v, ws_msw.fixed() && ws_lsw.fixed());
 	}
 
+	/** Low word has to be summed as unsigned, which get_weighted_sums
+	 * cannot do, so probes are calculated one by one */
+	bool can_calculate_values() const { return false; }
+
+	template<class T> bool calculate_values(const T& start, const T& end, SZARP_PROBE_TYPE probe_type, std::vector<std::tr1::tuple<double, bool> >& values) {
+		return false;
+	}
+
 };
 
 template<class value_type, class time_type, class types> class combined_param_entry_in_buffer : public buffered_param_entry_in_buffer<value_type, time_type, types, combined_calculate> {
@@ -19,38 +19,162 @@
 #ifndef __SZ4_DECODE_FILE_H__
 #define __SZ4_DECODE_FILE_H__
 
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "sz4/value_codec.h"
+
 namespace sz4 {
 
+/**Decodes delta from buffer, returns number of bytes consumed or 0
+ * if the buffer does not hold the complete delta*/
 size_t decode_delta(long long& delta, const unsigned char* buffer, size_t size);
 
 template<class T> size_t decode_time(T& time, const unsigned char* buffer, size_t size) {
 	long long delta;
 	size_t count = decode_delta(delta, buffer, size);
-	time += delta;
+	if (count)
+		time += delta;
 	return count;
 }
 
-template<class V, class T> std::vector<value_time_pair<V, T> >
-decode_file(const unsigned char *buffer, size_t size, T time) {
-	size_t index = 0;
-	std::vector<value_time_pair<V, T> > result;
-	result.reserve(size / sizeof(V) / sizeof(T));
+/**Position of an entry in sz4 file*/
+template<class T> struct file_position {
+	file_position(const T& _time) : offset(0), entry(0), time(_time), version(0), previous(0) {}
+
+	///offset of the entry in the file
+	size_t offset;
+	///number of the entry
+	size_t entry;
+	///time the entry starts at, that is time of the previous entry
+	T time;
+	///format version of the file, 0 if header was not read yet
+	unsigned char version;
+	///value of the previous entry as kept by the value codec
+	unsigned long long previous;
+};
+
+/**Recognizes version of the file and moves @param position past its header.
+ * @return false if the buffer is too short to tell the version or
+ * the version is not known*/
+template<class T> bool decode_header(const unsigned char* buffer, size_t size, file_position<T>& position) {
+	const size_t magic_size = sizeof(file_header) - 1;
+	if (memcmp(buffer, file_header, std::min(size, magic_size))) {
+		position.version = file_version_raw;
+		return true;
+	}
 
-	while (index + sizeof(V) <= size) {
-		value_time_pair<V, T> pair;
+	if (size < sizeof(file_header) || buffer[magic_size] != file_version_compressed)
+		return false;
 
-		memcpy(&pair.value, buffer + index, sizeof(V));
-		index += sizeof(V);
+	position.version = buffer[magic_size];
+	position.offset = sizeof(file_header);
+	return true;
+}
 
-		if (index == size)
+/**Sparse index of sz4 file, holds positions of every step-th entry,
+ * so decoding can start close to required time instead of at the
+ * beginning of the file*/
+template<class T> class file_index {
+	std::vector<file_position<T> > m_positions;
+public:
+	static const size_t step = 64;
+
+	void add(const file_position<T>& position) {
+		if (position.entry % step == 0 && position.entry / step == m_positions.size())
+			m_positions.push_back(position);
+	}
+
+	/**@return last indexed position starting not later than @param time,
+	 * or @param first if there is no such position*/
+	file_position<T> find(const T& time, const file_position<T>& first) const {
+		auto i = std::upper_bound(m_positions.begin(), m_positions.end(), time,
+			[] (const T& t, const file_position<T>& p) { return t < p.time; });
+		if (i == m_positions.begin())
+			return first;
+		return *(i - 1);
+	}
+
+	size_t size() const { return m_positions.size(); }
+
+	/**Removes positions that are not within file of given size*/
+	void truncate(size_t file_size) {
+		while (m_positions.size() && m_positions.back().offset >= file_size)
+			m_positions.pop_back();
+	}
+
+	void clear() { m_positions.clear(); }
+};
+
+/**Loop of decode_entries for values encoded with codec C*/
+template<class C, class V, class T> bool
+decode_entries_with(const unsigned char *buffer, size_t size, file_position<T>& position,
+		std::vector<value_time_pair<V, T> >& result, const T& until,
+		file_index<T>* index, file_position<T>* last) {
+	while (position.offset < size) {
+		V value;
+		unsigned long long previous = position.previous;
+		size_t value_size = C::decode(value, previous, buffer + position.offset, size - position.offset);
+		if (value_size == 0 || position.offset + value_size >= size)
 			break;
 
-		index += decode_time(time, buffer + index, size - index);
-		pair.time = time;
+		T time(position.time);
+		size_t count = decode_time(time, buffer + position.offset + value_size, size - position.offset - value_size);
+		if (count == 0)
+			break;
+
+		if (index)
+			index->add(position);
+		if (last)
+			*last = position;
 
+		position.offset += value_size + count;
+		position.entry += 1;
+		position.time = time;
+		position.previous = previous;
+
+		value_time_pair<V, T> pair;
+		pair.value = value;
+		pair.time = time;
 		result.push_back(pair);
+
+		if (!(time < until))
+			return true;
 	}
 
+	return false;
+}
+
+/**Decodes entries starting at @param position and appends them
+ * to @param result. Decoding stops after first entry with time not smaller
+ * than @param until. Upon return @param position points to the first not
+ * decoded entry. Positions of decoded entries are recorded in @param index
+ * if one is given, position of the last decoded entry is stored in
+ * @param last if one is given.
+ * @return true if decoding was stopped because @param until was reached,
+ * false if there are no more complete entries in the buffer*/
+template<class V, class T> bool
+decode_entries(const unsigned char *buffer, size_t size, file_position<T>& position,
+		std::vector<value_time_pair<V, T> >& result, const T& until,
+		file_index<T>* index = nullptr, file_position<T>* last = nullptr) {
+	if (position.version == 0 && !decode_header(buffer, size, position))
+		return false;
+
+	if (position.version == file_version_compressed)
+		return decode_entries_with<value_codec<V> >(buffer, size, position, result, until, index, last);
+	else
+		return decode_entries_with<raw_value_codec<V> >(buffer, size, position, result, until, index, last);
+}
+
+template<class V, class T> std::vector<value_time_pair<V, T> >
+decode_file(const unsigned char *buffer, size_t size, T time) {
+	file_position<T> position(time);
+	std::vector<value_time_pair<V, T> > result;
+	result.reserve(size / sizeof(V) / sizeof(T));
+
+	decode_entries<V, T>(buffer, size, position, result, time_trait<T>::last_valid_time);
+
 	return result;
 }
 
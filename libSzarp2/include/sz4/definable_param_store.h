@@ -0,0 +1,358 @@
+#ifndef __SZ4_DEFINABLE_PARAM_STORE_H__
+#define __SZ4_DEFINABLE_PARAM_STORE_H__
+/*
+  SZARP: SCADA software
+
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "szarp_config.h"
+#include "sz4/defs.h"
+#include "sz4/load_file_locked.h"
+
+namespace sz4 {
+
+/** Runs jobs writing files of definable param and file summary stores
+ * in a background thread */
+class definable_store_writer {
+	const boost::filesystem::wpath m_dir;
+	std::deque<std::function<void()> > m_jobs;
+	boost::mutex m_lock;
+	boost::condition_variable m_cond;
+	bool m_stop;
+	boost::thread m_thread;
+
+	void run();
+public:
+	definable_store_writer(const boost::filesystem::wpath& dir);
+
+	const boost::filesystem::wpath& dir() const { return m_dir; }
+
+	void post(const std::function<void()>& job);
+
+	/** Writes out all posted jobs */
+	~definable_store_writer();
+};
+
+/** FNV-1a hash of data, continued from hash */
+uint64_t store_hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+/** Atomically replaces content of store file, returns false on error */
+bool write_store_file(const boost::filesystem::wpath& path, const std::string& content);
+
+/** Name, size and modification time of a data file */
+struct data_file_stamp {
+	std::wstring name;
+	uint64_t size;
+	int64_t mtime;
+};
+
+/** Fills stamp of a data file, returns false if it cannot be read */
+bool stat_data_file(const boost::filesystem::wpath& path, data_file_stamp& stamp);
+
+typedef std::vector<data_file_stamp> data_dir_listing;
+
+/** Lists data files of a param directory ordered by name (and so by time) */
+void list_data_dir(const boost::filesystem::wpath& dir, data_dir_listing& listing);
+
+/** Hash of first count files of a listing */
+uint64_t data_dir_hash(const data_dir_listing& listing, size_t count);
+
+/** What stored values were computed from: definitions of the param and
+ * of definable params it refers to, and data files of real params they
+ * refer to. The newest file of each directory is left out as it is appended
+ * to all the time, files before it are never changed unless historical data
+ * is rewritten, which invalidates the store */
+class definable_store_source {
+	uint64_t m_formula_hash;
+	std::vector<boost::filesystem::wpath> m_dirs;
+
+	/** Listings of data dirs, a listing is read again only after a file
+	 * other than the newest one in its dir changes */
+	mutable boost::mutex m_listings_lock;
+	mutable std::vector<data_dir_listing> m_listings;
+	mutable std::vector<bool> m_listings_valid;
+
+	void refresh_listings() const;
+public:
+	definable_store_source(TParam* param, const std::vector<boost::filesystem::wpath>& dirs,
+			const std::vector<TParam*>& referred = std::vector<TParam*>());
+
+	uint64_t formula_hash() const { return m_formula_hash; }
+
+	/** Data file in directory dir changed, path may be just the file name */
+	void file_changed(const boost::filesystem::wpath& dir, const std::string& path);
+
+	/** Header of store file with fingerprints of current state of data dirs */
+	std::string make_header(size_t value_size, size_t time_size) const;
+
+	/** Checks that file starts with a header made from the same formula and
+	 * that data files covered by it did not change, returns header size or 0 */
+	size_t check_header(const unsigned char* data, size_t size, size_t value_size, size_t time_size) const;
+
+	/** Store file name for given probe type and type sizes */
+	std::wstring file_name(SZARP_PROBE_TYPE probe_type, size_t value_size, size_t time_size) const;
+};
+
+/** Fixed values of a definable param for one probe type kept on disk between
+ * runs. Values are stored as runs of probes, the file is mapped when needed
+ * and unmapped by release(), it is rewritten by definable_store_writer after
+ * enough new values are added */
+template<class value_type, class time_type> class definable_param_store {
+public:
+	struct __attribute__ ((packed)) record {
+		time_type start;
+		time_type end;
+		value_type value;
+	};
+
+	static const size_t FLUSH_THRESHOLD = 4096;
+private:
+	definable_store_writer* m_writer;
+	std::shared_ptr<const definable_store_source> m_source;
+	boost::filesystem::wpath m_path;
+
+	std::unique_ptr<mapped_file_locked> m_file;
+	const record* m_records;
+	size_t m_records_count;
+	/** file was looked up since last release() */
+	bool m_opened;
+	/** file does not match the source, it is not merged when written */
+	bool m_replace;
+	/** file last found to match the source and size of its header, header
+	 * is not checked again until data of referred params changes */
+	std::pair<unsigned long long, unsigned long long> m_checked_id;
+	size_t m_checked_header_size;
+
+	std::vector<record> m_pending;
+	/** header made when first of pending values was added */
+	std::string m_pending_header;
+	std::shared_ptr<std::atomic<bool> > m_written;
+
+	static bool same_value(const value_type& v1, const value_type& v2) {
+		if (value_is_no_data(v1) || value_is_no_data(v2))
+			return value_is_no_data(v1) && value_is_no_data(v2);
+		return v1 == v2;
+	}
+
+	static bool cmp_start(const record& r1, const record& r2) {
+		return r1.start < r2.start;
+	}
+
+	void open() {
+		m_file.reset(new mapped_file_locked(m_path));
+		m_records = nullptr;
+		m_records_count = 0;
+		m_opened = true;
+
+		if (!m_file->valid() || !m_file->data()) {
+			m_file.reset();
+			return;
+		}
+
+		size_t header_size;
+		if (m_file->id() == m_checked_id && m_file->id() != std::make_pair(0ULL, 0ULL))
+			header_size = m_checked_header_size;
+		else
+			header_size = m_source->check_header(m_file->data(), m_file->size(), sizeof(value_type), sizeof(time_type));
+		if (!header_size) {
+			m_file.reset();
+			m_replace = true;
+			return;
+		}
+
+		m_checked_id = m_file->id();
+		m_checked_header_size = header_size;
+
+		m_records = reinterpret_cast<const record*>(m_file->data() + header_size);
+		m_records_count = (m_file->size() - header_size) / sizeof(record);
+	}
+
+	static void merge(std::vector<record>& records) {
+		std::stable_sort(records.begin(), records.end(), cmp_start);
+
+		size_t j = 0;
+		for (size_t i = 0; i < records.size(); i++) {
+			if (j && records[i].start < records[j - 1].end)
+				continue;
+
+			if (j && records[j - 1].end == records[i].start && same_value(records[j - 1].value, records[i].value))
+				records[j - 1].end = records[i].end;
+			else
+				records[j++] = records[i];
+		}
+		records.resize(j);
+	}
+
+	static void write(boost::filesystem::wpath path,
+			std::shared_ptr<const definable_store_source> source,
+			std::vector<record> records,
+			std::string header,
+			bool replace,
+			std::shared_ptr<std::atomic<bool> > written);
+public:
+	definable_param_store(definable_store_writer* writer, std::shared_ptr<const definable_store_source> source, SZARP_PROBE_TYPE probe_type) :
+		m_writer(writer),
+		m_source(source),
+		m_path(writer->dir() / source->file_name(probe_type, sizeof(value_type), sizeof(time_type))),
+		m_records(nullptr),
+		m_records_count(0),
+		m_opened(false),
+		m_replace(false),
+		m_checked_id(0, 0),
+		m_checked_header_size(0),
+		m_written(std::make_shared<std::atomic<bool> >(false))
+	{
+	}
+
+	bool get_value(const time_type& time, value_type& value) {
+		if (m_written->exchange(false) || !m_opened)
+			open();
+
+		if (!m_records_count)
+			return false;
+
+		record r;
+		r.start = time;
+		const record* i = std::upper_bound(m_records, m_records + m_records_count, r, cmp_start);
+		if (i == m_records)
+			return false;
+		--i;
+
+		if (!(time < i->end))
+			return false;
+
+		value = i->value;
+		return true;
+	}
+
+	void add_value(const value_type& value, const time_type& start, const time_type& end) {
+		if (m_pending.size()) {
+			record& last = m_pending.back();
+			if (last.end == start && same_value(last.value, value)) {
+				last.end = end;
+				return;
+			}
+		}
+
+		if (m_pending.empty())
+			m_pending_header = m_source->make_header(sizeof(value_type), sizeof(time_type));
+
+		record r;
+		r.start = start;
+		r.end = end;
+		r.value = value;
+		m_pending.push_back(r);
+
+		if (m_pending.size() >= FLUSH_THRESHOLD)
+			flush();
+	}
+
+	void flush() {
+		if (m_pending.empty())
+			return;
+
+		std::vector<record> records;
+		records.swap(m_pending);
+		std::string header;
+		header.swap(m_pending_header);
+
+		m_writer->post(std::bind(&definable_param_store::write, m_path, m_source, records, header, m_replace, m_written));
+		m_replace = false;
+	}
+
+	/** Unmaps the file releasing its lock, it is mapped again when needed */
+	void release() {
+		m_file.reset();
+		m_records = nullptr;
+		m_records_count = 0;
+		m_opened = false;
+	}
+
+	/** Data of referred params changed, the file has to be checked again
+	 * and pending values are dropped if they were computed from data
+	 * that is no longer there */
+	void data_changed() {
+		release();
+		m_checked_id = std::make_pair(0ULL, 0ULL);
+
+		if (m_pending.size() && !m_source->check_header(
+				reinterpret_cast<const unsigned char*>(m_pending_header.data()),
+				m_pending_header.size(), sizeof(value_type), sizeof(time_type))) {
+			m_pending.clear();
+			m_pending_header.clear();
+		}
+	}
+
+	~definable_param_store() {
+		flush();
+	}
+};
+
+template<class value_type, class time_type>
+void definable_param_store<value_type, time_type>::write(boost::filesystem::wpath path,
+		std::shared_ptr<const definable_store_source> source,
+		std::vector<record> records,
+		std::string header,
+		bool replace,
+		std::shared_ptr<std::atomic<bool> > written) {
+
+	// referred data changed since the values were computed
+	if (!source->check_header(reinterpret_cast<const unsigned char*>(header.data()),
+			header.size(), sizeof(value_type), sizeof(time_type)))
+		return;
+
+	if (!replace) {
+		mapped_file_locked file(path);
+		size_t header_size = 0;
+		if (file.valid() && file.data())
+			header_size = source->check_header(file.data(), file.size(), sizeof(value_type), sizeof(time_type));
+
+		if (header_size) {
+			const record* old = reinterpret_cast<const record*>(file.data() + header_size);
+			records.insert(records.begin(), old, old + (file.size() - header_size) / sizeof(record));
+		}
+	}
+
+	merge(records);
+
+	// files covered by header of the values are unchanged, the ones added
+	// since are only appended to, so the current state is stamped
+	std::string content = source->make_header(sizeof(value_type), sizeof(time_type));
+	content.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(record));
+
+	if (write_store_file(path, content))
+		written->store(true);
+}
+
+}
+
+#endif
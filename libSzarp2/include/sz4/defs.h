@@ -180,6 +180,16 @@ public:
 		m_weight += weight;
 	}
 
+	/** Adds sums gathered in other, returns false and leaves this sum
+	 * untouched if values have to be added one by one */
+	virtual bool add_sum(const weighted_sum<value_type, time_type>& other) {
+		m_wsum += other.m_wsum;
+		m_weight += other.m_weight;
+		m_no_data_weight += other.m_no_data_weight;
+		m_fixed &= other.m_fixed;
+		return true;
+	}
+
 	sum_type sum(time_diff_type& weight) const {
 		weight = m_weight;
 		return m_wsum;
@@ -227,6 +237,46 @@ public:
 	}
 };
 
+/** Sum of values added one by one from zero, remembers also weight of
+ * negative values, so it can be added to sums of values taken as unsigned */
+template<class V, class T> class summary_weighted_sum : public weighted_sum<V, T> {
+public:
+	typedef weighted_sum<V, T> parent_type;
+	typedef typename parent_type::sum_type sum_type;
+	typedef typename parent_type::time_diff_type time_diff_type;
+protected:
+	time_diff_type m_negative_weight;
+public:
+	summary_weighted_sum() : m_negative_weight(0) {}
+
+	summary_weighted_sum(const sum_type& wsum, const time_diff_type& weight, const time_diff_type& no_data_weight, const time_diff_type& negative_weight, bool fixed) : m_negative_weight(negative_weight) {
+		this->m_wsum = wsum;
+		this->m_weight = weight;
+		this->m_no_data_weight = no_data_weight;
+		this->m_fixed = fixed;
+	}
+
+	void add(const V& value, const time_diff_type& weight) {
+		parent_type::add(value, weight);
+		if (value < 0)
+			m_negative_weight += weight;
+	}
+
+	bool add_sum(const parent_type& other) {
+		const summary_weighted_sum* summary = dynamic_cast<const summary_weighted_sum*>(&other);
+		if (!summary)
+			return false;
+
+		parent_type::add_sum(other);
+		m_negative_weight += summary->m_negative_weight;
+		return true;
+	}
+
+	time_diff_type negative_weight() const {
+		return m_negative_weight;
+	}
+};
+
 template <class V1, class V2, class T> struct wsum_converter<V1, T, V2, T> {
 	typedef typename weighted_sum<V1, T>::sum_type from_sum_type;
 	typedef typename weighted_sum<V1, T>::time_diff_type from_time_diff_type;
@@ -286,8 +336,34 @@ template <class V1, class V2> struct wsum_converter<V1, sz4::nanosecond_time_t,
 	}
 };
 
+/** Summary of values held by a block */
+struct values_summary {
+	double min;
+	double max;
+	bool has_data;
+	bool has_no_data;
+
+	values_summary() : min(0), max(0), has_data(false), has_no_data(false) {}
+
+	template<class V> void add(const V& v) {
+		if (value_is_no_data(v)) {
+			has_no_data = true;
+			return;
+		}
+
+		if (!has_data || v < min)
+			min = v;
+		if (!has_data || v > max)
+			max = v;
+		has_data = true;
+	}
+};
+
 class search_condition {
 public:
+	/** @return false if no value of a block with given summary
+	 * satisfies the condition, so that the block can be skipped */
+	virtual bool may_match(const values_summary& summary) const { return true; }
 	virtual bool operator()(const short&) const = 0;
 	virtual bool operator()(const int&) const = 0;
 	virtual bool operator()(const float&) const = 0;
@@ -299,6 +375,7 @@ public:
 
 class no_data_search_condition : public search_condition {
 public:
+	bool may_match(const values_summary& summary) const override;
 	bool operator()(const short& v) const override;
 	bool operator()(const int& v) const override;
 	bool operator()(const float& v) const override;
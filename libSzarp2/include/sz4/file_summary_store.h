@@ -0,0 +1,183 @@
+#ifndef __SZ4_FILE_SUMMARY_STORE_H__
+#define __SZ4_FILE_SUMMARY_STORE_H__
+/*
+  SZARP: SCADA software
+
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+
+#include <boost/filesystem/fstream.hpp>
+
+#include "sz4/defs.h"
+#include "sz4/definable_param_store.h"
+
+namespace sz4 {
+
+/** Name of summary store file of a param kept in param_dir */
+std::wstring file_summary_store_name(const boost::filesystem::wpath& param_dir,
+		size_t value_size, bool value_integer, bool value_signed, size_t time_size);
+
+/** Sums and ranges of values of whole data files of a real param kept on
+ * disk between runs, so that files covered by a query are not decoded.
+ * Each summary is stamped with size and modification time of its file and
+ * is used only while they match. Summaries put since last flush() are
+ * merged into the file by definable_store_writer */
+template<class V, class T> class file_summary_store {
+public:
+	struct summary {
+		uint64_t size;
+		int64_t mtime;
+		T end;
+		summary_weighted_sum<V, T> sum;
+		values_summary values;
+	};
+
+	typedef std::map<T, summary> map_type;
+private:
+	definable_store_writer* m_writer;
+	boost::filesystem::wpath m_path;
+	map_type m_summaries;
+	map_type m_pending;
+	bool m_loaded;
+
+	static const char* magic() { return "SZ4SUMS 1"; }
+
+	static void format(std::ostream& os, const T& start, const summary& s) {
+		os << start << ' ' << s.size << ' ' << s.mtime << ' ' << s.end << ' '
+			<< s.sum._sum() << ' ' << s.sum.weight() << ' '
+			<< s.sum.no_data_weight() << ' ' << s.sum.negative_weight() << ' '
+			<< s.sum.fixed() << ' ' << s.values.has_data << ' '
+			<< s.values.has_no_data << ' ' << s.values.min << ' ' << s.values.max << '\n';
+	}
+
+	static bool parse(const std::string& line, T& start, summary& s) {
+		std::istringstream is(line);
+
+		typename summary_weighted_sum<V, T>::sum_type wsum;
+		typename summary_weighted_sum<V, T>::time_diff_type weight, no_data_weight, negative_weight;
+		bool fixed;
+
+		is >> std::ws >> start >> s.size >> s.mtime >> std::ws >> s.end
+			>> wsum >> weight >> no_data_weight >> negative_weight >> fixed
+			>> s.values.has_data >> s.values.has_no_data >> s.values.min >> s.values.max;
+		if (is.fail())
+			return false;
+
+		s.sum = summary_weighted_sum<V, T>(wsum, weight, no_data_weight, negative_weight, fixed);
+		return true;
+	}
+
+	static void read(const boost::filesystem::wpath& path, map_type& summaries) {
+		boost::filesystem::ifstream ifs(path);
+
+		std::string line;
+		if (!std::getline(ifs, line) || line != magic())
+			return;
+
+		while (std::getline(ifs, line)) {
+			T start;
+			summary s;
+			if (parse(line, start, s))
+				summaries[start] = s;
+		}
+	}
+
+	static void write(boost::filesystem::wpath path, map_type pending) {
+		map_type summaries;
+		read(path, summaries);
+
+		for (auto& kv : pending)
+			summaries[kv.first] = kv.second;
+
+		std::ostringstream os;
+		os << std::setprecision(std::numeric_limits<double>::max_digits10) << magic() << '\n';
+		for (auto& kv : summaries)
+			format(os, kv.first, kv.second);
+
+		write_store_file(path, os.str());
+	}
+public:
+	file_summary_store(definable_store_writer* writer, const boost::filesystem::wpath& param_dir) :
+		m_writer(writer),
+		m_path(writer->dir() / file_summary_store_name(param_dir, sizeof(V),
+					std::numeric_limits<V>::is_integer, std::numeric_limits<V>::is_signed, sizeof(T))),
+		m_loaded(false)
+	{
+	}
+
+	/** Gets summary of file starting at start
+	 * @return false if there is none or the file changed since */
+	bool get(const T& start, const boost::filesystem::wpath& file, T& end, summary_weighted_sum<V, T>& sum, values_summary& values) {
+		if (!m_loaded) {
+			read(m_path, m_summaries);
+			m_loaded = true;
+		}
+
+		auto i = m_summaries.find(start);
+		if (i == m_summaries.end())
+			return false;
+
+		data_file_stamp stamp;
+		if (!stat_data_file(file, stamp) || stamp.size != i->second.size || stamp.mtime != i->second.mtime) {
+			m_summaries.erase(i);
+			return false;
+		}
+
+		end = i->second.end;
+		sum = i->second.sum;
+		values = i->second.values;
+		return true;
+	}
+
+	void put(const T& start, const boost::filesystem::wpath& file, const T& end, const summary_weighted_sum<V, T>& sum, const values_summary& values) {
+		data_file_stamp stamp;
+		if (!stat_data_file(file, stamp))
+			return;
+
+		summary s;
+		s.size = stamp.size;
+		s.mtime = stamp.mtime;
+		s.end = end;
+		s.sum = sum;
+		s.values = values;
+
+		m_summaries[start] = s;
+		m_pending[start] = s;
+	}
+
+	/** Posts write of summaries put since last flush */
+	void flush() {
+		if (m_pending.empty())
+			return;
+
+		map_type pending;
+		pending.swap(m_pending);
+		m_writer->post(std::bind(&file_summary_store::write, m_path, pending));
+	}
+
+	~file_summary_store() {
+		flush();
+	}
+};
+
+}
+
+#endif
@@ -21,8 +21,8 @@
 
 #include <atomic>
 #include <thread>
-#include <mutex>
-#include <deque>
+#include <memory>
+#include <vector>
 
 #include "defs.h"
 
@@ -42,6 +42,7 @@ class ParamsValues;
 
 class TSzarpConfig;
 class TParam;
+class params_values_arena;
 
 namespace sz4
 {
@@ -65,14 +66,64 @@ enum struct cache_ret {
 	none
 };
 
+/** Recent values of a param. Values are kept in a ring buffer written only
+ * by the live cache thread, readers never lock it - they copy the values out
+ * and retry if the sequence counter changed in the meantime. Full buffer is
+ * replaced with twice as big one, up to max_capacity, after which oldest
+ * values are dropped before their retention time passes. Buffer and its
+ * capacity are published together through a single pointer, so readers
+ * always index the buffer they loaded within its bounds. Replaced buffers
+ * are kept until the block is destroyed, as readers may still be copying
+ * from them. Everything a reader may copy while the writer modifies it is
+ * accessed with relaxed atomic operations, the sequence counter orders them. */
 template<class value_type, class time_type> class live_block : public generic_live_block {
-	std::mutex m_lock;
-	std::deque<value_time_pair<value_type,time_type>> m_block;
+	typedef value_time_pair<value_type, time_type> pair_type;
+
+	/** Buffer, never modified except for slots contents once published */
+	struct ring {
+		std::unique_ptr<std::atomic<value_type>[]> values;
+		std::unique_ptr<std::atomic<time_type>[]> times;
+		size_t capacity;
+
+		ring(size_t capacity) : values(new std::atomic<value_type>[capacity]), times(new std::atomic<time_type>[capacity]), capacity(capacity) {}
+
+		pair_type load(size_t i) const;
+		time_type load_time(size_t i) const;
+		void store(size_t i, const pair_type& pair);
+		void store_time(size_t i, const time_type& time);
+	};
+
+	/** Copy of values needed to answer a query over part of the block */
+	struct snapshot {
+		std::vector<pair_type> block;
+		/** number of values in the whole block */
+		size_t size;
+		/** time of the last value in the whole block */
+		time_type last_time;
+		time_type start_time;
+	};
+
+	static const size_t initial_capacity = 16;
+	static const size_t max_capacity = 1 << 16;
+
+	std::atomic<unsigned> m_sequence;
+	std::atomic<const ring*> m_ring;
+	std::atomic<size_t> m_head;
+	std::atomic<size_t> m_size;
+	std::vector<std::unique_ptr<ring>> m_rings;
+
 	std::atomic<live_values_observer*> m_observer;
 		
 	typename time_difference<time_type>::type m_retention;
 	
-	time_type m_start_time;
+	std::atomic<time_type> m_start_time;
+
+	/** Index in current buffer of i-th value, writer side only */
+	size_t slot(size_t i);
+	void push_back(const pair_type& pair);
+	/** Copies values ending after from (and the one preceding them) up to
+	 * the first value ending after to */
+	void get_snapshot(snapshot& s, const time_type& from, const time_type& to);
 public:
 	live_block(time_difference<second_time_t>::type retention);
 
@@ -111,7 +162,7 @@ class live_cache
 #endif
 
 	void process_msg(szarp::ParamsValues* values, size_t sock_no);
-	void process_socket(size_t sock_no);
+	void process_socket(size_t sock_no, params_values_arena& arena);
 
 	void start();
 	void run(std::promise<void> promise);
@@ -33,89 +33,206 @@ live_block<value_type, time_type>::set_observer(live_values_observer* observer)
 	m_observer.store(observer, std::memory_order_release);
 }
 
+template<class value_type, class time_type>
+typename live_block<value_type, time_type>::pair_type
+live_block<value_type, time_type>::ring::load(size_t i) const
+{
+	return make_value_time_pair<pair_type>(values[i].load(std::memory_order_relaxed),
+			times[i].load(std::memory_order_relaxed));
+}
+
+template<class value_type, class time_type>
+time_type live_block<value_type, time_type>::ring::load_time(size_t i) const
+{
+	return times[i].load(std::memory_order_relaxed);
+}
+
+template<class value_type, class time_type>
+void live_block<value_type, time_type>::ring::store(size_t i, const pair_type& pair)
+{
+	values[i].store(pair.value, std::memory_order_relaxed);
+	times[i].store(pair.time, std::memory_order_relaxed);
+}
+
+template<class value_type, class time_type>
+void live_block<value_type, time_type>::ring::store_time(size_t i, const time_type& time)
+{
+	times[i].store(time, std::memory_order_relaxed);
+}
+
+template<class value_type, class time_type>
+size_t live_block<value_type, time_type>::slot(size_t i)
+{
+	return (m_head.load(std::memory_order_relaxed) + i) & (m_rings.back()->capacity - 1);
+}
+
+template<class value_type, class time_type>
+void live_block<value_type, time_type>::get_snapshot(snapshot& s, const time_type& from, const time_type& to)
+{
+	while (true) {
+		unsigned sequence = m_sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		const ring* r = m_ring.load(std::memory_order_acquire);
+		size_t mask = r->capacity - 1;
+		size_t head = m_head.load(std::memory_order_relaxed);
+		/* head and size may come from a different buffer than r if we
+		 * raced with the writer, keep indices within r anyway, the copy
+		 * is then discarded by sequence check below */
+		size_t size = std::min(m_size.load(std::memory_order_relaxed), r->capacity);
+
+		auto at = [&] (size_t i) {
+			return r->load((head + i) & mask);
+		};
+		auto time_at = [&] (size_t i) {
+			return r->load_time((head + i) & mask);
+		};
+		auto ending_after = [&] (const time_type& t) {
+			size_t l = 0, h = size;
+			while (l < h) {
+				size_t m = l + (h - l) / 2;
+				if (t < time_at(m))
+					h = m;
+				else
+					l = m + 1;
+			}
+			return l;
+		};
+
+		size_t first = ending_after(from);
+		if (first)
+			first--;
+		size_t last = std::min(ending_after(to) + 1, size);
+
+		s.block.clear();
+		for (size_t i = first; i < last; i++)
+			s.block.push_back(at(i));
+		s.size = size;
+		s.last_time = size ? time_at(size - 1) : time_trait<time_type>::invalid_value;
+		s.start_time = m_start_time.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_sequence.load(std::memory_order_relaxed) == sequence)
+			return;
+	}
+}
+
 template<class value_type, class time_type>
 cache_ret live_block<value_type, time_type>::get_weighted_sum(const time_type& start, time_type& end, weighted_sum<value_type, time_type>& sum)
 {
-	std::lock_guard<std::mutex> guard(m_lock);
+	snapshot s;
+	get_snapshot(s, start, end);
 
-	if (m_block.size() == 0 || end <= m_start_time)
+	if (s.size == 0 || end <= s.start_time)
 		return cache_ret::none;
 
-	if (start >= m_block.back().time) {
+	if (start >= s.last_time) {
 		sum.add_no_data_weight(end - start);
 		sum.set_fixed(false);
 		return cache_ret::complete;
 	}
 
-	sz4::get_weighted_sum(m_block.begin(), m_block.end(),
-				std::max(start, m_start_time),
+	sz4::get_weighted_sum(s.block.begin(), s.block.end(),
+				std::max(start, s.start_time),
 				end, sum);
 
-	if (end > m_block.back().time) {
-		sum.add_no_data_weight(end - m_block.back().time);
+	if (end > s.last_time) {
+		sum.add_no_data_weight(end - s.last_time);
 		sum.set_fixed(false);
 	}
 
-	end = m_start_time;
+	end = s.start_time;
 
-	return start >= m_start_time ? cache_ret::complete : cache_ret::partial;
+	return start >= s.start_time ? cache_ret::complete : cache_ret::partial;
 }
 
 template<class value_type, class time_type>
 std::pair<bool, time_type> live_block<value_type, time_type>::search_data_left(const time_type& start, const time_type& end, const search_condition& condition)
 {
-	std::lock_guard<std::mutex> guard(m_lock);
+	snapshot s;
+	get_snapshot(s, end, start);
 
-	if (!m_block.size() || (m_block.size() == 1 && m_start_time == m_block[0].time))
+	if (!s.size || (s.size == 1 && s.start_time == s.last_time))
 		return std::make_pair(false, start);
 
-	if (end >= m_block.back().time)
+	if (end >= s.last_time)
 		return std::make_pair(true, time_trait<time_type>::invalid_value);
 
-	if (start < m_start_time)
+	if (start < s.start_time)
 		return std::make_pair(false, start);
 
-	auto i = sz4::search_data_left_t(m_block.begin(), m_block.end(), start, end, condition);
-	if (i != m_block.end())
+	auto i = sz4::search_data_left_t(s.block.begin(), s.block.end(), start, end, condition);
+	if (i != s.block.end())
 		return std::make_pair(true, std::min(time_just_before(i->time), start));
 	else 
-		return std::make_pair(false, m_start_time);
+		return std::make_pair(false, s.start_time);
 }
 
 template<class value_type, class time_type>
 time_type live_block<value_type, time_type>::search_data_right(const time_type& start, const time_type& end, const search_condition& condition)
 {
-	std::lock_guard<std::mutex> guard(m_lock);
+	snapshot s;
+	get_snapshot(s, start, end);
 
-	if (!m_block.size() || end <= m_start_time || (m_block.size() == 1 && m_start_time == m_block[0].time))
+	if (!s.size || end <= s.start_time || (s.size == 1 && s.start_time == s.last_time))
 		return time_trait<time_type>::invalid_value;
 
-	auto i = sz4::search_data_right_t(m_block.begin(), m_block.end(), start, end, condition);
-	if (i == m_block.end())
+	auto i = sz4::search_data_right_t(s.block.begin(), s.block.end(), start, end, condition);
+	if (i == s.block.end())
 		return time_trait<time_type>::invalid_value;
 
-	if (i == m_block.begin())
-		return std::max(start, m_start_time);
+	if (i == s.block.begin())
+		return std::max(start, s.start_time);
 	else
 		return std::max(start, (i - 1)->time);
 }
 
 template<class value_type, class time_type>
 void live_block<value_type, time_type>::get_first_time(time_type &t) { 
-	std::lock_guard<std::mutex> guard(m_lock);
+	while (true) {
+		unsigned sequence = m_sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		bool empty = m_size.load(std::memory_order_relaxed) == 0;
+		time_type start_time = m_start_time.load(std::memory_order_relaxed);
 
-	if (m_block.size())
-		t = m_start_time;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_sequence.load(std::memory_order_relaxed) != sequence)
+			continue;
+
+		if (!empty)
+			t = start_time;
+		return;
+	}
 }
 
 template<class value_type, class time_type>
 void live_block<value_type, time_type>::get_last_time(time_type &t) { 
-	std::lock_guard<std::mutex> guard(m_lock);
+	while (true) {
+		unsigned sequence = m_sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			std::this_thread::yield();
+			continue;
+		}
 
-	if (m_block.size())
-		t = m_block.back().time;
-	else
-		t = time_trait<time_type>::invalid_value;
+		const ring* r = m_ring.load(std::memory_order_acquire);
+		size_t head = m_head.load(std::memory_order_relaxed);
+		size_t size = std::min(m_size.load(std::memory_order_relaxed), r->capacity);
+		time_type last_time = size ? r->load_time((head + size - 1) & (r->capacity - 1)) : time_trait<time_type>::invalid_value;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_sequence.load(std::memory_order_relaxed) != sequence)
+			continue;
+
+		t = last_time;
+		return;
+	}
 }
 
 #ifndef MINGW32
@@ -156,33 +273,61 @@ void get_value(szarp::ParamValue* value, uint32_t& v) {
 }
 #endif
 
+template<class value_type, class time_type>
+void live_block<value_type, time_type>::push_back(const pair_type& pair)
+{
+	size_t size = m_size.load(std::memory_order_relaxed);
+	size_t capacity = m_rings.back()->capacity;
+
+	if (size == capacity) {
+		if (capacity < max_capacity) {
+			std::unique_ptr<ring> r(new ring(capacity * 2));
+			for (size_t i = 0; i < size; i++)
+				r->store(i, m_rings.back()->load(slot(i)));
+
+			m_head.store(0, std::memory_order_relaxed);
+			m_ring.store(r.get(), std::memory_order_release);
+			m_rings.push_back(std::move(r));
+		} else {
+			m_start_time.store(m_rings.back()->load_time(slot(0)), std::memory_order_relaxed);
+			m_head.store((m_head.load(std::memory_order_relaxed) + 1) & (capacity - 1), std::memory_order_relaxed);
+			m_size.store(--size, std::memory_order_relaxed);
+		}
+	}
+
+	m_size.store(size + 1, std::memory_order_relaxed);
+	m_rings.back()->store(slot(size), pair);
+}
+
 template<class value_type, class time_type>
 void live_block<value_type, time_type>::process_live_value(
 		const time_type& t,
 		const value_type& v)
 {
 	typedef typename time_difference<time_type>::type diff_type;
-	std::lock_guard<std::mutex> guard(m_lock);
-
-	if (m_block.size() && m_block.back().value == v) {
-		m_block.back().time = t;
-		return;
-	}
-
-	typedef value_time_pair<value_type, time_type> pair;
-	if (!m_block.size()) {
-		m_start_time = t;
-		m_block.push_back(make_value_time_pair<pair>(v, t));
-		return;
-	}
 
+	unsigned sequence = m_sequence.load(std::memory_order_relaxed);
+	m_sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	ring& r = *m_rings.back();
+	size_t size = m_size.load(std::memory_order_relaxed);
+	if (size && r.load(slot(size - 1)).value == v) {
+		r.store_time(slot(size - 1), t);
+	} else if (!size) {
+		m_start_time.store(t, std::memory_order_relaxed);
+		push_back(make_value_time_pair<pair_type>(v, t));
+	} else {
+		while (size && diff_type(t - r.load_time(slot(0))) >= m_retention) {
+			m_start_time.store(r.load_time(slot(0)), std::memory_order_relaxed);
+			m_head.store((m_head.load(std::memory_order_relaxed) + 1) & (r.capacity - 1), std::memory_order_relaxed);
+			m_size.store(--size, std::memory_order_relaxed);
+		}
 
-	while (m_block.size() && diff_type(t - m_block[0].time) >= m_retention) {
-		m_start_time = m_block.front().time;
-		m_block.pop_front();
+		push_back(make_value_time_pair<pair_type>(v, t));
 	}
 
-	m_block.push_back(make_value_time_pair<pair>(v, t));
+	m_sequence.store(sequence + 2, std::memory_order_release);
 }
 
 template<class value_type, class time_type>
@@ -218,7 +363,11 @@ void convert_retention(const time_difference<second_time_t>::type& f, time_diffe
 }
 
 template<class value_type, class time_type>
-live_block<value_type, time_type>::live_block(time_difference<second_time_t>::type retention) : m_observer(nullptr) {
+live_block<value_type, time_type>::live_block(time_difference<second_time_t>::type retention) :
+	m_sequence(0), m_head(0), m_size(0), m_observer(nullptr) {
+	m_rings.emplace_back(new ring(initial_capacity));
+	m_ring.store(m_rings.back().get());
+
 	convert_retention(retention, m_retention);
 }
 
@@ -19,9 +19,38 @@
 #ifndef __SZ4_LOAD_FILE_LOCKED_H__
 #define __SZ4_LOAD_FILE_LOCKED_H__
 
+#include <vector>
+#include <utility>
+
 namespace sz4 {
 
 bool load_file_locked(const boost::filesystem::wpath& path, void *data, size_t size);
 
+/**Read only, shared mapping of a file. File is read-locked for the lifetime
+ * of the object, so the content cannot be modified by writer while
+ * it is accessed through the mapping.*/
+class mapped_file_locked {
+	int m_fd;
+	void* m_data;
+	size_t m_size;
+	std::pair<unsigned long long, unsigned long long> m_id;
+#ifdef MINGW32
+	std::vector<unsigned char> m_buffer;
+#endif
+public:
+	mapped_file_locked(const boost::filesystem::wpath& path);
+
+	bool valid() const { return m_fd != -1; }
+
+	const unsigned char* data() const { return static_cast<const unsigned char*>(m_data); }
+
+	size_t size() const { return m_size; }
+
+	/**Device and inode of the mapped file, (0, 0) if not known*/
+	std::pair<unsigned long long, unsigned long long> id() const { return m_id; }
+
+	~mapped_file_locked();
+};
+
 };
 #endif
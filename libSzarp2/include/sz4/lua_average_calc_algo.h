@@ -32,6 +32,14 @@ public:
 	}
 
 	virtual void do_calculate_value(second_time_t time, SZARP_PROBE_TYPE probe_type, double &result, bool& fixed) = 0;
+
+	/** Lua params refer to other params at arbitrary times, so probes are
+	 * always calculated one by one */
+	bool can_calculate_values() const { return false; }
+
+	template<class T> bool calculate_values(const T& start, const T& end, SZARP_PROBE_TYPE probe_type, std::vector<std::tr1::tuple<double, bool> >& values) {
+		return false;
+	}
 	
 };
 
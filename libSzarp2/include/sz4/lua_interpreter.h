@@ -19,6 +19,9 @@
   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
 */
 
+#include <map>
+#include <string>
+
 #include <lua.hpp>
 
 #include "sz4/defs.h"
@@ -28,6 +31,9 @@ namespace sz4 {
 
 template<class base> class lua_interpreter {
 	lua_State* m_lua;
+	/** references to functions of params compiled in this interpreter,
+	 * valid only in its own lua state, with scripts they were compiled from */
+	std::map<TParam*, std::pair<std::basic_string<unsigned char>, int> > m_functions;
 public:
 	lua_interpreter();
 
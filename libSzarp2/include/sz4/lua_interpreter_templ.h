@@ -153,7 +153,32 @@ template<class base> void lua_interpreter<base>::initialize(base* _base, typenam
 }
 
 template<class base> bool lua_interpreter<base>::prepare_param(TParam* param) {
-	return lua::prepare_param(m_lua, param);
+	const unsigned char* script = param->GetLuaScript();
+	if (script == NULL)
+		script = (const unsigned char*) "";
+
+	auto i = m_functions.find(param);
+	if (i != m_functions.end() && i->second.first.compare(script)) {
+		//param was removed and another one was created at its address
+		luaL_unref(m_lua, LUA_REGISTRYINDEX, i->second.second);
+		m_functions.erase(i);
+		i = m_functions.end();
+	}
+
+	if (i == m_functions.end()) {
+		int ref = lua::compile_lua_function(m_lua, param);
+		if (ref == LUA_REFNIL)
+			lua_pop(m_lua, 1);
+
+		i = m_functions.insert(std::make_pair(param,
+			std::make_pair(std::basic_string<unsigned char>(script), ref))).first;
+	}
+
+	if (i->second.second == LUA_REFNIL)
+		return false;
+
+	lua_rawgeti(m_lua, LUA_REGISTRYINDEX, i->second.second);
+	return true;
 }
 
 template<class base> double lua_interpreter<base>::calculate_value(nanosecond_time_t start, SZARP_PROBE_TYPE probe_type, int custom_length) {
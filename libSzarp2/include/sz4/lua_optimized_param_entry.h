@@ -39,7 +39,7 @@ template<class types> class execution_engine : public LuaExec::ExecutionEngine,
 		if (m_initialized)
 			return;
 
-		m_vars.resize(m_exec_param->m_vars.size());
+		m_exec_param->m_program.InitRegisters(m_vars);
 
 		m_vars[3] = PT_MIN10;
 		m_vars[4] = PT_HOUR;
@@ -51,11 +51,6 @@ template<class types> class execution_engine : public LuaExec::ExecutionEngine,
 		m_vars[10] = PT_SEC;
 		m_vars[11] = PT_HALFSEC;
 		m_vars[12] = PT_MSEC10;
-	
-		for (size_t i = 0; i < m_vars.size(); i++)
-			m_exec_param->m_vars[i].PushExecutionEngine(this);
-		for (size_t i = 0; i < m_exec_param->m_par_refs.size(); i++)
-			m_exec_param->m_par_refs[i].PushExecutionEngine(this);
 
 		m_initialized = true;
 	}
@@ -73,7 +68,7 @@ public:
 		m_vars[0] = nan("");
 		m_vars[1] = time;
 		m_vars[2] = probe_type;
-		m_exec_param->m_statement->Execute();
+		m_exec_param->m_program.Execute(&m_vars[0], this);
 
 		fixed &= stack_top.top();
 		result = m_vars[0];
@@ -109,15 +104,6 @@ public:
 	virtual std::vector<double>& Vars() {
 		return m_vars;
 	}
-
-	~execution_engine() {
-		if (!m_initialized)
-			return;
-		for (size_t i = 0; i < m_vars.size(); i++)
-			m_exec_param->m_vars[i].PopExecutionEngine();
-		for (size_t i = 0; i < m_exec_param->m_par_refs.size(); i++)
-			m_exec_param->m_par_refs[i].PopExecutionEngine();
-	}
 };
 
 
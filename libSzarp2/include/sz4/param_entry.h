@@ -21,6 +21,8 @@
 
 #include "config.h"
 
+#include <atomic>
+
 #include "live_observer.h"
 
 namespace szarp {
@@ -34,6 +36,8 @@ class generic_live_block;
 class generic_param_entry : public SzbParamObserver, public live_values_observer {
 protected:
 	boost::recursive_mutex m_lock;
+	/** serializes queries, recursive as evaluation of a param asks for its own first and last time */
+	boost::recursive_mutex m_query_lock;
 	TParam* m_param;
 
 	std::list<generic_param_entry*> m_referring_params;
@@ -66,6 +70,30 @@ public:
 
 	virtual void get_weighted_sum(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, weighted_sum<double, nanosecond_time_t>& wsum) = 0;
 
+	virtual void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<short, second_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<unsigned short, second_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<int, second_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<unsigned, second_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<float, second_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<double, second_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<short, nanosecond_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<unsigned short, nanosecond_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<int, nanosecond_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<unsigned, nanosecond_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<float, nanosecond_time_t> >& sums) = 0;
+
+	virtual void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<double, nanosecond_time_t> >& sums) = 0;
+
 	virtual second_time_t search_data_right(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, const search_condition& condition) = 0;
 
 	virtual second_time_t search_data_left(const second_time_t& start, const second_time_t& end,  SZARP_PROBE_TYPE probe_type,const search_condition& condition) = 0;
@@ -125,19 +153,84 @@ public:
 	void convert() { }
 };
 
+template<class IV, class IT, class OV, class OT> class vector_helper {
+	std::vector<weighted_sum<IV, IT> > m_temp;
+	std::vector<weighted_sum<OV, OT> >& m_sums;
+public:
+	vector_helper(std::vector<weighted_sum<OV, OT> >& sums) : m_sums(sums) {}
+	std::vector<weighted_sum<IV, IT> >& sums() { return m_temp; }
+	void convert() {
+		m_sums.resize(m_temp.size());
+		for (size_t i = 0; i < m_temp.size(); i++)
+			m_sums[i].take_from(m_temp[i]);
+	}
+};
+
+template<class V, class T> class vector_helper<V, T, V, T> {
+	std::vector<weighted_sum<V, T> >& m_sums;
+public:
+	vector_helper(std::vector<weighted_sum<V, T> >& sums) : m_sums(sums) {}
+	std::vector<weighted_sum<V, T> >& sums() { return m_sums; }
+	void convert() { }
+};
+
 }
 
+/** First or last time of a param kept between queries. Invalidated
+ * whenever data of the param or of any param it refers to changes, which
+ * may happen concurrently with the calculation, hence the generation */
+template<class T> class memoized_time {
+	std::atomic<unsigned> m_generation;
+	unsigned m_time_generation;
+	bool m_valid;
+	T m_time;
+public:
+	memoized_time() : m_generation(0), m_time_generation(0), m_valid(false) {}
+
+	void invalidate() {
+		m_generation.fetch_add(1, std::memory_order_release);
+	}
+
+	/** calculate is not memoized if it marks volatile_time, which is
+	 * passed on to the caller like for any nested calculation */
+	template<class F> void get(T& t, bool& volatile_time, F calculate) {
+		unsigned generation = m_generation.load(std::memory_order_acquire);
+		if (m_valid && m_time_generation == generation) {
+			t = m_time;
+			return;
+		}
+
+		bool outer_volatile_time = volatile_time;
+		volatile_time = false;
+
+		calculate(t);
+
+		if (!volatile_time) {
+			m_time = t;
+			m_time_generation = generation;
+			m_valid = true;
+		}
+		volatile_time = volatile_time || outer_volatile_time;
+	}
+};
+
 template<template <typename DT, typename TT, typename BT> class PT, class V, class T, class BT> class param_entry_in_buffer : public generic_param_entry {
 	PT<V, T, BT> m_entry;
+	BT* m_base;
+
+	/** guarded by m_query_lock */
+	memoized_time<T> m_first_time;
+	memoized_time<T> m_last_time;
 	
 	template<class RV, class RT> void get_weighted_sum_templ(const T& start, const T& end, SZARP_PROBE_TYPE probe_type, weighted_sum<RV, RT>& sum)  {
+		boost::lock_guard<boost::recursive_mutex> lock(m_query_lock);
 		param_buffer_type_converion_helper::helper<V, T, RV, RT> helper(sum);
 		m_entry.get_weighted_sum_impl(start, end, probe_type, helper.sum());
 		helper.convert();
 	}
 public:
 	param_entry_in_buffer(BT* _base, TParam* param, const boost::filesystem::wpath& base_dir) :
-		generic_param_entry(param), m_entry(_base, param, base_dir / param->GetSzbaseName())
+		generic_param_entry(param), m_entry(_base, param, base_dir / param->GetSzbaseName()), m_base(_base)
 	{ }
 
 	void get_weighted_sum(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, weighted_sum<short, second_time_t>& wsum) {
@@ -200,6 +293,70 @@ public:
 		get_weighted_sum_templ(T(start), round_up<nanosecond_time_t, T>()(end), probe_type, wsum);
 	}
 
+	void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<short, second_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<unsigned short, second_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<int, second_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<unsigned, second_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<float, second_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<double, second_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<short, nanosecond_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<unsigned short, nanosecond_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<int, nanosecond_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<unsigned, nanosecond_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<float, nanosecond_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	void get_weighted_sums(const nanosecond_time_t& start, const nanosecond_time_t& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<double, nanosecond_time_t> >& sums) {
+		get_weighted_sums_templ(start, end, probe_type, sums);
+	}
+
+	template<class RV, class RT> void get_weighted_sums_templ(const RT& start, const RT& end, SZARP_PROBE_TYPE probe_type, std::vector<weighted_sum<RV, RT> >& sums) {
+		std::vector<std::pair<T, T> > ranges;
+		for (RT current = start; current < end; ) {
+			RT next = szb_move_time(current, 1, probe_type, 0);
+			ranges.push_back(std::make_pair(T(current), round_up<RT, T>()(next)));
+			current = next;
+		}
+
+		probe_adapter<RT, T>()(probe_type);
+
+		boost::lock_guard<boost::recursive_mutex> lock(m_query_lock);
+		param_buffer_type_converion_helper::vector_helper<V, T, RV, RT> helper(sums);
+		m_entry.get_weighted_sums_impl(ranges, probe_type, helper.sums());
+		helper.convert();
+	}
+
 	second_time_t search_data_right(const second_time_t& start, const second_time_t& end, SZARP_PROBE_TYPE probe_type, const search_condition& condition) {
 		return search_data_right_templ(start, end, probe_type, condition);
 	}
@@ -218,17 +375,21 @@ public:
 
 	template<class RT> RT search_data_right_templ(const RT& start, const RT &end, SZARP_PROBE_TYPE probe_type, const search_condition& condition) {
 		probe_adapter<RT, T>()(probe_type);
+		boost::lock_guard<boost::recursive_mutex> lock(m_query_lock);
 		return RT(m_entry.search_data_right_impl(T(start), round_up<RT, T>()(end), probe_type, condition));
 	}
 
 	template<class RT> RT search_data_left_templ(const RT& start, const RT &end, SZARP_PROBE_TYPE probe_type, const search_condition& condition) {
 		probe_adapter<RT, T>()(probe_type);
+		boost::lock_guard<boost::recursive_mutex> lock(m_query_lock);
 		return RT(m_entry.search_data_left_impl(T(start), round_up<RT, T>()(end), probe_type, condition));
 	}
 
 	template<class RT> void get_first_time_templ(RT& t) {
+		boost::lock_guard<boost::recursive_mutex> lock(m_query_lock);
 		T tt;
-		m_entry.get_first_time(m_referred_params, tt);
+		m_first_time.get(tt, m_base->volatile_time(),
+			[this] (T& t) { m_entry.get_first_time(m_referred_params, t); });
 		t = RT(tt);
 	}
 
@@ -241,8 +402,10 @@ public:
 	}
 
 	template<class RT> void get_last_time_templ(RT& t) {
+		boost::lock_guard<boost::recursive_mutex> lock(m_query_lock);
 		T tt;
-		m_entry.get_last_time(m_referred_params, tt);
+		m_last_time.get(tt, m_base->volatile_time(),
+			[this] (T& t) { m_entry.get_last_time(m_referred_params, t); });
 		t = RT(tt);
 	}
 
@@ -264,6 +427,14 @@ public:
 
 	void handle_param_data_changed(TParam* param, const std::string& path) {
 		m_entry.param_data_changed(param, path);
+		m_first_time.invalidate();
+		m_last_time.invalidate();
+	}
+
+	void refferred_param_removed(generic_param_entry* param_entry) {
+		generic_param_entry::refferred_param_removed(param_entry);
+		m_first_time.invalidate();
+		m_last_time.invalidate();
 	}
 			
 	PT<V, T, BT>& get_contained_entry() {
@@ -19,6 +19,9 @@
 #ifndef __SZ4_REAL_PARAM_ENTRY_H__
 #define __SZ4_REAL_PARAM_ENTRY_H__
 
+#include "sz4/decode_file.h"
+#include "sz4/file_summary_store.h"
+
 namespace sz4 {
 
 template<class V, class T> class live_block;
@@ -49,6 +52,24 @@ protected:
 
 	bool m_needs_refresh;
 	const boost::filesystem::wpath m_block_path;
+
+	///sum and range of all values in the file, outlive the block
+	summary_weighted_sum<V, T> m_summary;
+	values_summary m_values_summary;
+	T m_summary_end;
+	bool m_summary_valid;
+
+	file_summary_store<V, T>* m_summary_store;
+	bool m_summary_looked_up;
+
+	/**@return true if block holds all values from the file*/
+	virtual bool holds_whole_file();
+
+	void update_summary();
+
+	/**Takes summary from the store if it is not known yet
+	 * @return true if summary is valid*/
+	bool load_summary();
 public:
 	file_block_entry(const T& start_time,
 			const std::wstring& block_path,
@@ -56,11 +77,16 @@ public:
 
 	virtual void refresh_if_needed() = 0;
 
+	/**Makes sure block holds data for range [from, to]*/
+	virtual void refresh_range(const T& from, const T& to);
+
 	T start_time();
 
 	T end_time();
 
-	void get_weighted_sum(const T& start, const T& end, weighted_sum<V, T>& wsum);
+	/**Adds values from range [start, min(end, end_time())) to the sum
+	 * @return end of the summed range*/
+	T get_weighted_sum(const T& start, const T& end, weighted_sum<V, T>& wsum);
 
 	T search_data_right(const T& start, const T& end, const search_condition& condition);
 
@@ -68,12 +94,33 @@ public:
 
 	void set_needs_refresh();
 
+	/**Summaries of the file are kept in store, file must not be
+	 * appended to anymore*/
+	void set_summary_store(file_summary_store<V, T>* store);
+
 	void block_deleted();
 
 	virtual ~file_block_entry();
 };
 
 template<class V, class T, class base> class sz4_file_block_entry : public file_block_entry<V, T, base> {
+	file_index<T> m_index;
+	///position of the first entry held in block
+	file_position<T> m_window;
+	///position of the first entry not yet decoded
+	file_position<T> m_position;
+	///position of the last entry held in block
+	file_position<T> m_last;
+	bool m_decoded_all;
+	///last entry held in block is the last complete entry of the file
+	bool m_holds_last;
+	bool m_file_changed;
+
+	void prepare_block();
+
+	void reset_block();
+
+	bool holds_whole_file();
 public:
 	typedef file_block_entry<V, T, base> parent;
 	sz4_file_block_entry(const T& start_time,
@@ -81,6 +128,8 @@ public:
 			block_cache* cache);
 
 	void refresh_if_needed();
+
+	void refresh_range(const T& from, const T& to);
 };
 
 template<class V, class T, class base> class szbase_file_block_entry : public file_block_entry<V, T, base> {
@@ -115,11 +164,20 @@ protected:
 	T m_first_sz4_date;
 
 	live_block<V, T>* m_live_block;
+
+	std::unique_ptr<file_summary_store<V, T> > m_summary_store;
+
+	/**Created on first use, store may be enabled after the entry*/
+	file_summary_store<V, T>* summary_store();
+
+	void get_weighted_sum_from_blocks(typename map_type::iterator i, const T& start, const T& end, bool live_data, weighted_sum<V, T>& sum);
 public:
 	real_param_entry_in_buffer(base *_base, TParam* param, const boost::filesystem::wpath& param_dir);
 
 	void get_weighted_sum_impl(const T& start, const T& end, SZARP_PROBE_TYPE, weighted_sum<V, T>& sum);
 
+	void get_weighted_sums_impl(const std::vector<std::pair<T, T> >& ranges, SZARP_PROBE_TYPE, std::vector<weighted_sum<V, T> >& sums);
+
 	T search_data_right_impl(const T& start, const T& end, SZARP_PROBE_TYPE, const search_condition& condition);
 
 	T search_data_left_impl(const T& start, const T& end, SZARP_PROBE_TYPE, const search_condition& condition);
@@ -56,6 +56,10 @@ template<class V, class T, class base> file_block_entry<V, T, base>::file_block_
 	, m_cache(cache)
 	, m_needs_refresh(true)
 	, m_block_path(block_path)
+	, m_summary_end(start_time)
+	, m_summary_valid(false)
+	, m_summary_store(nullptr)
+	, m_summary_looked_up(false)
 {
 }
 
@@ -64,31 +68,107 @@ template<class V, class T, class base> T file_block_entry<V, T, base>::start_tim
 }
 
 template<class V, class T, class base> T file_block_entry<V, T, base>::end_time() {
+	if (load_summary())
+		return m_summary_end;
+
 	refresh_if_needed();
 	return m_block->end_time();
 }
 
 template<class V, class T, class base>
-void file_block_entry<V, T, base>::get_weighted_sum(const T& start, const T& end, weighted_sum<V, T>& wsum) {
+void file_block_entry<V, T, base>::refresh_range(const T&, const T&) {
 	refresh_if_needed();
-	m_block->get_weighted_sum(start, end, wsum);
+}
+
+template<class V, class T, class base>
+bool file_block_entry<V, T, base>::holds_whole_file() {
+	return !m_needs_refresh;
+}
+
+template<class V, class T, class base>
+T file_block_entry<V, T, base>::get_weighted_sum(const T& start, const T& end, weighted_sum<V, T>& wsum) {
+	bool whole_file = start == m_start_time;
+	if (whole_file && load_summary() && !(end < m_summary_end)
+			&& wsum.add_sum(m_summary))
+		return m_summary_end;
+
+	refresh_range(start, end);
+
+	T end_for_block = std::min(end, m_block->end_time());
+	if (!(start < end_for_block))
+		return start;
+
+	//whole file is always summed through its summary, so the result
+	//does not depend on whether the summary was already there
+	if (whole_file && end_for_block == m_block->end_time() && holds_whole_file()) {
+		if (!m_summary_valid)
+			update_summary();
+
+		if (wsum.add_sum(m_summary))
+			return end_for_block;
+	}
+
+	m_block->get_weighted_sum(start, end_for_block, wsum);
+	return end_for_block;
+}
+
+template<class V, class T, class base>
+void file_block_entry<V, T, base>::update_summary() {
+	m_summary = summary_weighted_sum<V, T>();
+	m_summary_end = m_block->end_time();
+	m_block->get_weighted_sum(m_start_time, m_summary_end, m_summary);
+	m_values_summary = m_block->summary();
+	m_summary_valid = true;
+
+	if (m_summary_store)
+		m_summary_store->put(m_start_time, m_block_path, m_summary_end, m_summary, m_values_summary);
+}
+
+template<class V, class T, class base>
+bool file_block_entry<V, T, base>::load_summary() {
+	if (m_summary_valid || m_summary_looked_up || !m_summary_store)
+		return m_summary_valid;
+
+	m_summary_looked_up = true;
+	m_summary_valid = m_summary_store->get(m_start_time, m_block_path, m_summary_end, m_summary, m_values_summary);
+	return m_summary_valid;
 }
 
 template<class V, class T, class base>
 T file_block_entry<V, T, base>::search_data_right(const T& start, const T& end, const search_condition& condition) {
-	refresh_if_needed();
+	if (load_summary() && !condition.may_match(m_values_summary))
+		return time_trait<T>::invalid_value;
+
+	refresh_range(start, std::max(end, time_just_after(start)));
+	if (!m_summary_valid && holds_whole_file())
+		update_summary();
+
 	return m_block->search_data_right(start, end, condition);
 }
 
 template<class V, class T, class base>
 T file_block_entry<V, T, base>::search_data_left(const T& start, const T& end, const search_condition& condition) {
-	refresh_if_needed();
+	if (load_summary() && !condition.may_match(m_values_summary))
+		return time_trait<T>::invalid_value;
+
+	refresh_range(end, time_just_after(start));
+	if (!m_summary_valid && holds_whole_file())
+		update_summary();
+
 	return m_block->search_data_left(start, end, condition);
 }
 
 template<class V, class T, class base>
 void file_block_entry<V, T, base>::set_needs_refresh() {
 	m_needs_refresh = true;
+	m_summary_valid = false;
+	m_summary_looked_up = false;
+}
+
+template<class V, class T, class base>
+void file_block_entry<V, T, base>::set_summary_store(file_summary_store<V, T>* store) {
+	m_summary_store = store;
+	m_summary_looked_up = false;
 }
 
 template<class V, class T, class base>
@@ -107,31 +187,111 @@ sz4_file_block_entry<V, T, base>::sz4_file_block_entry(const T& start_time
 	, const std::wstring& block_path
 	, block_cache* cache)
 	: parent(start_time, block_path, cache)
+	, m_window(start_time)
+	, m_position(start_time)
+	, m_last(start_time)
+	, m_decoded_all(false)
+	, m_holds_last(false)
+	, m_file_changed(false)
 {}
 
 template<class V, class T, class base>
-void sz4_file_block_entry<V, T, base>::refresh_if_needed() {
+void sz4_file_block_entry<V, T, base>::prepare_block() {
 	if (!this->m_block) {
 		this->m_block = new typename parent::block_type(this->m_start_time, this, this->m_cache);
-		this->m_needs_refresh = true;
+
+		m_window = m_position = file_position<T>(this->m_start_time);
+		m_decoded_all = m_holds_last = false;
+		this->m_needs_refresh = false;
+		return;
 	}
 
 	if (!this->m_needs_refresh)
 		return;
 
-	boost::system::error_code ec;
-	size_t size = boost::filesystem::file_size(this->m_block_path, ec);
-	if (ec)
+	//writer only appends to the file and updates time of its last entry,
+	//so only the last entry has to be decoded again, decoding could also
+	//stop at the last entry because of requested time
+	auto& data = this->m_block->data();
+	if (m_holds_last && data.size()) {
+		this->m_block->erase_entries(data.end() - 1, data.end());
+		m_position = m_last;
+	}
+
+	m_decoded_all = m_holds_last = false;
+	m_file_changed = true;
+	this->m_needs_refresh = false;
+}
+
+template<class V, class T, class base>
+void sz4_file_block_entry<V, T, base>::reset_block() {
+	typename parent::block_type::value_time_vector empty;
+	this->m_block->set_data(empty);
+
+	m_index.clear();
+	m_window = m_position = file_position<T>(this->m_start_time);
+	m_decoded_all = m_holds_last = false;
+}
+
+template<class V, class T, class base>
+bool sz4_file_block_entry<V, T, base>::holds_whole_file() {
+	return m_holds_last && m_window.entry == 0 && !m_file_changed && !this->m_needs_refresh;
+}
+
+template<class V, class T, class base>
+void sz4_file_block_entry<V, T, base>::refresh_if_needed() {
+	refresh_range(time_trait<T>::last_valid_time, time_trait<T>::last_valid_time);
+}
+
+template<class V, class T, class base>
+void sz4_file_block_entry<V, T, base>::refresh_range(const T& from, const T& to) {
+	prepare_block();
+
+	auto& data = this->m_block->data();
+	bool empty = data.empty() && !m_decoded_all;
+	bool decode_front = empty || (m_window.entry && from < m_window.time);
+	bool decode_back = empty || (!m_decoded_all && this->m_block->end_time() < to);
+	if (!decode_front && !decode_back && !m_file_changed)
 		return;
 
-	std::vector<unsigned char> buffer(size);
+	mapped_file_locked file(this->m_block_path);
+	if (!file.valid())
+		return;
 
-	if (load_file_locked(this->m_block_path, &buffer[0], buffer.size())) {
-		std::vector<value_time_pair<V, T> > values = decode_file<V, T>(&buffer[0], buffer.size(), this->start_time());
-		this->m_block->set_data(values);
+	m_file_changed = false;
+	if (file.size() < m_position.offset) {
+		//file was truncated, start from scratch
+		reset_block();
+		empty = decode_front = decode_back = true;
 	}
 
-	this->m_needs_refresh = false;
+	file_position<T> first(this->m_start_time);
+	if (empty) {
+		m_index.truncate(file.size());
+		m_window = m_position = m_index.find(from, first);
+		this->m_block->set_start_time(m_window.time);
+	} else if (decode_front) {
+		file_position<T> position = m_index.find(from, first);
+		file_position<T> window = position;
+
+		std::vector<value_time_pair<V, T> > values;
+		decode_entries<V, T>(file.data(), m_window.offset, position, values,
+				time_trait<T>::last_valid_time, &m_index);
+
+		this->m_block->insert_entries(data.begin(), values.begin(), values.end());
+		this->m_block->set_start_time(window.time);
+		m_window = window;
+	}
+
+	if (decode_back) {
+		std::vector<value_time_pair<V, T> > values;
+		m_decoded_all = !decode_entries<V, T>(file.data(), file.size(),
+					m_position, values, to, &m_index, &m_last);
+		m_holds_last = values.size() ? m_decoded_all || m_position.offset == file.size()
+				: m_holds_last;
+
+		this->m_block->insert_entries(data.end(), values.begin(), values.end());
+	}
 }
 
 template<class V, class T, class base>
@@ -227,11 +387,20 @@ void real_param_entry_in_buffer<V, T, base>::get_weighted_sum_impl(const T& star
 		return;
 	}
 
-	T current(start);
 	typename map_type::iterator i = m_blocks.upper_bound(start);
 	//if not first - back one off
 	if (i != m_blocks.begin())
 		std::advance(i, -1);
+
+	get_weighted_sum_from_blocks(i, start, end, from_live != cache_ret::none, sum);
+
+	if (m_summary_store)
+		m_summary_store->flush();
+}
+
+template<class V, class T, class base>
+void real_param_entry_in_buffer<V, T, base>::get_weighted_sum_from_blocks(typename map_type::iterator i, const T& start, const T& end, bool live_data, weighted_sum<V, T>& sum) {
+	T current(start);
 	do {
 		file_block_entry_type* entry = i->second;
 
@@ -245,23 +414,69 @@ void real_param_entry_in_buffer<V, T, base>::get_weighted_sum_impl(const T& star
 			current = i->first;
 		}
 
-		if (current < entry->end_time()) {
-			T end_for_block = std::min(end, entry->end_time());
-			entry->get_weighted_sum(current, end_for_block, sum);
-
-			current = end_for_block;
-		}
+		current = entry->get_weighted_sum(current, end, sum);
+		if (!(current < end))
+			return;
 
 		std::advance(i, 1);
 	} while (i != m_blocks.end());
 
 	if (current < end) {
 		sum.add_no_data_weight(end - current);
-		if (from_live == cache_ret::none)
+		if (!live_data)
 			sum.set_fixed(false);
 	}
 }
 
+template<class V, class T, class base>
+void real_param_entry_in_buffer<V, T, base>::get_weighted_sums_impl(const std::vector<std::pair<T, T> >& ranges, SZARP_PROBE_TYPE, std::vector<weighted_sum<V, T> >& sums) {
+	sums.assign(ranges.size(), weighted_sum<V, T>());
+
+	std::vector<T> ends;
+	ends.reserve(ranges.size());
+	for (auto& range : ranges)
+		ends.push_back(range.second);
+
+	std::vector<cache_ret> from_live(ranges.size(), cache_ret::none);
+	if (m_live_block) {
+		//live block holds only the most recent data, so go back
+		//from the last range until one is not covered by it
+		for (size_t k = ranges.size(); k-- > 0; ) {
+			from_live[k] = m_live_block->get_weighted_sum(ranges[k].first, ends[k], sums[k]);
+			if (from_live[k] == cache_ret::none)
+				break;
+		}
+	}
+
+	refresh_if_needed();
+
+	typename map_type::iterator i = m_blocks.begin();
+	for (size_t k = 0; k < ranges.size(); k++) {
+		if (from_live[k] == cache_ret::complete)
+			continue;
+
+		const T& start = ranges[k].first;
+		weighted_sum<V, T>& sum = sums[k];
+
+		if (m_blocks.size() == 0) {
+			sum.add_no_data_weight(ends[k] - start);
+			if (from_live[k] == cache_ret::none)
+				sum.set_fixed(false);
+			continue;
+		}
+
+		//ranges are sorted, so instead of upper_bound just move
+		//forward to the last block starting not after start
+		while (std::next(i) != m_blocks.end() && !(start < std::next(i)->first))
+			std::advance(i, 1);
+
+		get_weighted_sum_from_blocks(i, start, ends[k], from_live[k] != cache_ret::none, sum);
+	}
+
+	if (m_summary_store)
+		m_summary_store->flush();
+}
+
 template<class V, class T, class base>
 T real_param_entry_in_buffer<V, T, base>::search_data_right_impl(const T& start, const T& end, SZARP_PROBE_TYPE, const search_condition& condition) {
 	refresh_if_needed();
@@ -421,6 +636,24 @@ void real_param_entry_in_buffer<V, T, base>::refresh_file_list() {
 			m_blocks.insert(std::make_pair(file_time, entry));
 
 	}
+
+	//only the newest file is appended to
+	if (new_files.size() && m_blocks.size()) {
+		file_summary_store<V, T>* store = summary_store();
+		for (auto& kv : m_blocks)
+			kv.second->set_summary_store(store);
+		m_blocks.rbegin()->second->set_summary_store(nullptr);
+	}
+}
+
+template<class V, class T, class base>
+file_summary_store<V, T>* real_param_entry_in_buffer<V, T, base>::summary_store() {
+	if (!m_summary_store) {
+		definable_store_writer* writer = m_base->definable_store();
+		if (writer)
+			m_summary_store.reset(new file_summary_store<V, T>(writer, m_param_dir));
+	}
+	return m_summary_store.get();
 }
 
 template<class V, class T, class base>
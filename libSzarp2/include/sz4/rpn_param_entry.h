@@ -37,52 +37,103 @@ public:
 template<class types> class rpn_calculate {
 	typename types::base* m_base;
 	TParam* m_param;
+	const definable_program* m_program;
+	std::vector<double> m_values;
+	std::vector<const double*> m_values_ptrs;
+	double m_pw;
 
 public:
 	typedef typename types::base base;
 
-	rpn_calculate(typename types::base* base, TParam* param) : m_base(base), m_param(param) {
+	rpn_calculate(typename types::base* base, TParam* param) :
+		m_base(base),
+		m_param(param),
+		m_program(nullptr),
+		m_values(param->GetNumParsInFormula()),
+		m_values_ptrs(m_values.size()),
+		m_pw(pow(10, param->GetPrec()))
+	{
+		if (!param->GetDefinableProgram())
+			param->SetDefinableProgram(new definable_program(param));
+		m_program = param->GetDefinableProgram();
+
+		for (size_t i = 0; i < m_values.size(); i++)
+			m_values_ptrs[i] = &m_values[i];
 	}
 
 	template<class T> std::tr1::tuple<double, bool> calculate_value(T time, SZARP_PROBE_TYPE probe_type) {
-
-		int num_of_params = m_param->GetNumParsInFormula();
-		double varray[num_of_params];
-		const double *varrarr[num_of_params];
-		for (int i = 0; i < num_of_params; i++)
-			varrarr[i] = &varray[i];
-
-		const std::wstring& formula = m_param->GetDrawFormula();
 		TParam **f_cache = m_param->GetFormulaCache();
-		double pw = pow(10, m_param->GetPrec());
 		bool fixed = true;
 
 		T end_time = szb_move_time(time, 1, probe_type);
 		double stack[200];
 
-		for (int i = 0; i < num_of_params; i++) {
+		for (size_t i = 0; i < m_values.size(); i++) {
 			weighted_sum<double, T> wsum;
 			m_base->get_weighted_sum(f_cache[i], time, end_time, probe_type, wsum);
-			varray[i] = scale_value(wsum.avg(), f_cache[i]);
+			m_values[i] = scale_value(wsum.avg(), f_cache[i]);
 			fixed &= wsum.fixed();
 		}
 
 		default_is_summer_functor is_summer(second_time_t(time), m_param);
 		empty_fetch_functor empty_fetch;
 
-		double v = szb_definable_calculate(stack,
+		double v = m_program->execute(stack,
 				int(sizeof(stack) / sizeof(stack[0])),
-				varrarr,
-				f_cache,
-				formula,
-				num_of_params,
+				m_values_ptrs.data(),
 				empty_fetch,
-				is_summer,
-				m_param) / pw;
+				is_summer) / m_pw;
 
 		return std::tr1::tuple<double, bool>(v, fixed);
 	}
 
+	bool can_calculate_values() const { return true; }
+
+	/** Calculates consecutive probes in [start, end), fetching each referred
+	 * param for the whole range at once */
+	template<class T> bool calculate_values(const T& start, const T& end, SZARP_PROBE_TYPE probe_type, std::vector<std::tr1::tuple<double, bool> >& values) {
+		TParam **f_cache = m_param->GetFormulaCache();
+
+		std::vector<T> times;
+		for (T time = start; time < end; time = szb_move_time(time, 1, probe_type))
+			times.push_back(time);
+
+		std::vector<std::vector<weighted_sum<double, T> > > columns(m_values.size());
+		for (size_t i = 0; i < m_values.size(); i++) {
+			m_base->get_weighted_sums(f_cache[i], start, end, probe_type, columns[i]);
+			if (columns[i].size() != times.size())
+				return false;
+		}
+
+		double stack[200];
+		empty_fetch_functor empty_fetch;
+
+		values.clear();
+		values.reserve(times.size());
+		for (size_t j = 0; j < times.size(); j++) {
+			const T& time = times[j];
+			bool fixed = true;
+
+			for (size_t i = 0; i < m_values.size(); i++) {
+				const weighted_sum<double, T>& wsum = columns[i][j];
+				m_values[i] = scale_value(wsum.avg(), f_cache[i]);
+				fixed &= wsum.fixed();
+			}
+
+			default_is_summer_functor is_summer(second_time_t(time), m_param);
+
+			double v = m_program->execute(stack,
+					int(sizeof(stack) / sizeof(stack[0])),
+					m_values_ptrs.data(),
+					empty_fetch,
+					is_summer) / m_pw;
+
+			values.push_back(std::tr1::tuple<double, bool>(v, fixed));
+		}
+
+		return true;
+	}
+
 };
 
 template<class value_type, class time_type, class types> class rpn_param_entry_in_buffer : public buffered_param_entry_in_buffer<value_type, time_type, types, rpn_calculate> {
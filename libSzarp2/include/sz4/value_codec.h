@@ -0,0 +1,142 @@
+/*
+  SZARP: SCADA software
+
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#ifndef __SZ4_VALUE_CODEC_H__
+#define __SZ4_VALUE_CODEC_H__
+
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+namespace sz4 {
+
+///files without header, values are stored raw
+const unsigned char file_version_raw = 1;
+///values are stored relative to the previous value of the file
+const unsigned char file_version_compressed = 2;
+
+/**Files in versions other than raw start with this header, last byte
+ * of the header holds the version*/
+const unsigned char file_header[] = { 0x89, 'S', 'Z', '4', '\r', '\n', 0x1a, file_version_compressed };
+
+/**Values of raw files, copied as they are*/
+template<class V> struct raw_value_codec {
+	static const size_t max_size = sizeof(V);
+
+	static size_t decode(V& value, unsigned long long& previous, const unsigned char* buffer, size_t size) {
+		if (size < sizeof(V))
+			return 0;
+		memcpy(&value, buffer, sizeof(V));
+		return sizeof(V);
+	}
+
+	static size_t encode(const V& value, unsigned long long& previous, unsigned char* output) {
+		memcpy(output, &value, sizeof(V));
+		return sizeof(V);
+	}
+};
+
+/**Values of compressed files. Integer value is stored as zig-zag encoded
+ * difference to the previous value, written 7 bits per byte with the highest
+ * bit marking that more bytes follow*/
+template<class V, bool floating = std::is_floating_point<V>::value> struct value_codec {
+	static const size_t max_size = (sizeof(V) * 8 + 1 + 6) / 7;
+
+	static size_t decode(V& value, unsigned long long& previous, const unsigned char* buffer, size_t size) {
+		unsigned long long zigzag = 0;
+		for (size_t i = 0; i < size && i < max_size; i++) {
+			zigzag |= static_cast<unsigned long long>(buffer[i] & 0x7f) << (7 * i);
+			if (buffer[i] & 0x80)
+				continue;
+
+			long long delta = static_cast<long long>(zigzag >> 1) ^ -static_cast<long long>(zigzag & 1);
+			previous += delta;
+			value = static_cast<V>(previous);
+			return i + 1;
+		}
+		return 0;
+	}
+
+	static size_t encode(const V& value, unsigned long long& previous, unsigned char* output) {
+		long long delta = static_cast<long long>(value) - static_cast<long long>(previous);
+		unsigned long long zigzag = (static_cast<unsigned long long>(delta) << 1) ^ (delta >> 63);
+		previous = static_cast<long long>(value);
+
+		size_t i = 0;
+		for (; zigzag >= 0x80; zigzag >>= 7)
+			output[i++] = 0x80 | (zigzag & 0x7f);
+		output[i++] = zigzag;
+		return i;
+	}
+};
+
+/**Floating point value is XORed with the previous one. Zero bytes are stripped
+ * from both ends of the result, first byte holds number of stripped low
+ * bytes in its upper half and number of remaining bytes in the lower one.
+ * Repeated value takes single zero byte.*/
+template<class V> struct value_codec<V, true> {
+	typedef typename std::conditional<sizeof(V) == 4, uint32_t, uint64_t>::type bits_type;
+
+	static const size_t max_size = sizeof(V) + 1;
+
+	static size_t decode(V& value, unsigned long long& previous, const unsigned char* buffer, size_t size) {
+		if (size == 0)
+			return 0;
+
+		size_t trailing = buffer[0] >> 4;
+		size_t count = buffer[0] & 0xf;
+		if (count + 1 > size || trailing + count > sizeof(V))
+			return 0;
+
+		bits_type xored = 0;
+		for (size_t i = 0; i < count; i++)
+			xored |= static_cast<bits_type>(buffer[i + 1]) << (8 * (trailing + i));
+
+		bits_type bits = static_cast<bits_type>(previous) ^ xored;
+		memcpy(&value, &bits, sizeof(V));
+		previous = bits;
+		return count + 1;
+	}
+
+	static size_t encode(const V& value, unsigned long long& previous, unsigned char* output) {
+		bits_type bits;
+		memcpy(&bits, &value, sizeof(V));
+		bits_type xored = bits ^ static_cast<bits_type>(previous);
+		previous = bits;
+
+		if (xored == 0) {
+			output[0] = 0;
+			return 1;
+		}
+
+		size_t trailing = 0;
+		for (; !(xored & 0xff); xored >>= 8)
+			trailing += 1;
+
+		size_t count = 0;
+		for (; xored; xored >>= 8)
+			output[++count] = xored & 0xff;
+
+		output[0] = (trailing << 4) | count;
+		return count + 1;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,160 @@
+/*
+  SZARP: SCADA software
+
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#ifndef __SZ4_VALUE_TIME_SOA_H__
+#define __SZ4_VALUE_TIME_SOA_H__
+
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include "sz4/defs.h"
+
+namespace sz4 {
+
+/** Reference to an entry of value_time_soa_vector, V and T
+ * are const qualified for constant entries */
+template<class V, class T> struct value_time_ref {
+	typedef typename std::remove_const<V>::type value_type;
+	typedef typename std::remove_const<T>::type time_type;
+
+	V& value;
+	T& time;
+
+	value_time_ref(V& _value, T& _time) : value(_value), time(_time) {}
+
+	operator value_time_pair<value_type, time_type>() const {
+		value_time_pair<value_type, time_type> pair;
+		pair.value = value;
+		pair.time = time;
+		return pair;
+	}
+};
+
+template<class V, class T> class value_time_soa_iterator : public boost::iterator_facade<
+		value_time_soa_iterator<V, T>,
+		value_time_pair<typename std::remove_const<V>::type, typename std::remove_const<T>::type>,
+		std::random_access_iterator_tag,
+		value_time_ref<V, T> > {
+	V* m_value;
+	T* m_time;
+
+	template<class V2, class T2> friend class value_time_soa_iterator;
+	friend class boost::iterator_core_access;
+
+	value_time_ref<V, T> dereference() const { return value_time_ref<V, T>(*m_value, *m_time); }
+
+	template<class V2, class T2> bool equal(const value_time_soa_iterator<V2, T2>& other) const {
+		return m_time == other.m_time;
+	}
+
+	void increment() { ++m_value; ++m_time; }
+	void decrement() { --m_value; --m_time; }
+	void advance(std::ptrdiff_t n) { m_value += n; m_time += n; }
+
+	template<class V2, class T2> std::ptrdiff_t distance_to(const value_time_soa_iterator<V2, T2>& other) const {
+		return other.m_time - m_time;
+	}
+public:
+	value_time_soa_iterator() : m_value(nullptr), m_time(nullptr) {}
+	value_time_soa_iterator(V* value, T* time) : m_value(value), m_time(time) {}
+
+	template<class V2, class T2> value_time_soa_iterator(const value_time_soa_iterator<V2, T2>& other,
+			typename std::enable_if<std::is_convertible<V2*, V*>::value>::type* = 0)
+		: m_value(other.m_value), m_time(other.m_time) {}
+
+	V* value_ptr() const { return m_value; }
+	T* time_ptr() const { return m_time; }
+};
+
+/** Block entries kept as two arrays, one of times and one of values.
+ * Provides the subset of std::vector interface used by value_time_block */
+template<class V, class T> class value_time_soa_vector {
+	std::vector<V> m_values;
+	std::vector<T> m_times;
+public:
+	typedef value_time_pair<V, T> value_type;
+	typedef value_time_soa_iterator<V, T> iterator;
+	typedef value_time_soa_iterator<const V, const T> const_iterator;
+	typedef value_time_ref<V, T> reference;
+	typedef value_time_ref<const V, const T> const_reference;
+
+	size_t size() const { return m_times.size(); }
+	bool empty() const { return m_times.empty(); }
+
+	iterator begin() { return iterator(m_values.data(), m_times.data()); }
+	iterator end() { return begin() + size(); }
+	const_iterator begin() const { return const_iterator(m_values.data(), m_times.data()); }
+	const_iterator end() const { return begin() + size(); }
+
+	reference operator[](size_t i) { return reference(m_values[i], m_times[i]); }
+	const_reference operator[](size_t i) const { return const_reference(m_values[i], m_times[i]); }
+
+	const std::vector<V>& values() const { return m_values; }
+	const std::vector<T>& times() const { return m_times; }
+
+	void push_back(const value_type& pair) {
+		m_values.push_back(pair.value);
+		m_times.push_back(pair.time);
+	}
+
+	iterator insert(const_iterator i, const value_type& pair) {
+		size_t k = i - begin();
+		m_values.insert(m_values.begin() + k, pair.value);
+		m_times.insert(m_times.begin() + k, pair.time);
+		return begin() + k;
+	}
+
+	template<class input_iterator> void insert(const_iterator i, input_iterator first, input_iterator last) {
+		size_t k = i - begin();
+		size_t n = std::distance(first, last);
+
+		m_values.insert(m_values.begin() + k, n, V());
+		m_times.insert(m_times.begin() + k, n, T());
+		for (; first != last; ++first, ++k) {
+			m_values[k] = first->value;
+			m_times[k] = first->time;
+		}
+	}
+
+	iterator erase(const_iterator first, const_iterator last) {
+		size_t k = first - begin();
+		size_t n = last - first;
+
+		m_values.erase(m_values.begin() + k, m_values.begin() + k + n);
+		m_times.erase(m_times.begin() + k, m_times.begin() + k + n);
+		return begin() + k;
+	}
+
+	template<class input_iterator> void assign(input_iterator first, input_iterator last) {
+		m_values.clear();
+		m_times.clear();
+		insert(end(), first, last);
+	}
+
+	void swap(value_time_soa_vector& other) {
+		m_values.swap(other.m_values);
+		m_times.swap(other.m_times);
+	}
+};
+
+}
+
+#endif
@@ -5,6 +5,8 @@
 #include "config.h"
 #endif
 
+#include <vector>
+
 #include "szarp_config.h"
 
 class value_fetch_functor {
@@ -32,4 +34,50 @@ double
 szb_definable_calculate(double * stack, int stack_size, const double** cache, TParam** params,
 	const std::wstring& formula, int param_cnt, value_fetch_functor& value_fetch, is_summer_functor& is_summer, TParam* param);
 
+/** Draw formula of a definable param parsed once into a list of
+ * instructions. Evaluation gives the same results as szb_definable_calculate
+ * called with the param's draw formula and formula cache */
+class definable_program {
+public:
+	enum opcode {
+		PUSH_PARAM,	/**< value of param index, multiplied by value */
+		PUSH_CONST,	/**< constant value */
+		PUSH_NODATA,
+		SWAP,
+		DUP,
+		CALL,
+		IF,
+		ADD,
+		SUB,
+		MUL,
+		DIV,
+		GREATER,
+		LESS,
+		EQUAL,
+		WORD,
+		POWER,
+		NODATA_OR,
+		SUMMER,
+		FAIL		/**< formula refers to more params than in formula cache */
+	};
+
+	struct instruction {
+		opcode op;
+		int index;
+		double value;
+	};
+private:
+	TParam* m_param;
+	std::vector<instruction> m_code;
+
+	void emit(opcode op, int index = 0, double value = 0);
+public:
+	definable_program(TParam* param);
+
+	double execute(double* stack, int stack_size, const double** cache,
+		value_fetch_functor& value_fetch, is_summer_functor& is_summer) const;
+
+	const std::vector<instruction>& code() const { return m_code; }
+};
+
 #endif
@@ -66,15 +66,111 @@ public:
 	void PopExecutionEngine();
 };
 
+/** Register based bytecode a converted param is lowered to. Registers
+ * [0, vars count) hold param variables, they are followed by constants
+ * and expression temporaries. */
+class Program {
+public:
+	typedef uint32_t Reg;
+
+	enum Opcode {
+		MOVE,		/* dst = a */
+		BOOL,		/* dst = bool(a) */
+		NOT,
+		NEG,
+		ISNAN,
+		ADD,
+		SUB,
+		MUL,
+		DIV,
+		MOD,
+		POW,
+		LT,
+		LE,
+		EQ,
+		GE,
+		GT,
+		NE,
+		IN_SEASON,	/* dst = configs[x].IsSummerSeason(a) */
+		PARAM,		/* dst = value of param x at time a for probe type b */
+		MOVE_TIME,	/* dst = szb_move_time(a, b, c) */
+		ROUND_TIME,	/* dst = szb_round_time(a, b) */
+		JMP,		/* goto x */
+		JMP_IF,		/* if (a) goto x */
+		JMP_IF_NOT,	/* if (!a) goto x */
+		FOR_TEST,	/* goto x unless a is within limit b for step c */
+		END
+	};
+
+	struct Instruction {
+		Opcode op;
+		Reg dst, a, b, c;
+		uint32_t x;
+	};
+
+	Program() : m_vars_count(0), m_registers_count(0) {}
+
+	/** Sizes @p regs to hold all registers and fills constants in */
+	void InitRegisters(std::vector<Val>& regs) const;
+
+	void Execute(Val* regs, ExecutionEngine* ee) const;
+
+	std::vector<Instruction> m_code;
+	std::vector<Val> m_constants;
+	std::vector<TSzarpConfig*> m_configs;
+	size_t m_vars_count;
+	size_t m_registers_count;
+};
+
+/** Lowers statements into a Program. While compiling temporaries and
+ * constants are numbered separately, Finish() assigns them their final
+ * registers and removes stores nobody reads. */
+class ProgramCompiler {
+	Program* m_program;
+	size_t m_temps;
+	size_t m_max_temps;
+
+	static const Program::Reg TEMP_REG = 0x40000000;
+	static const Program::Reg CONST_REG = 0x80000000;
+
+	void EliminateDeadStores();
+public:
+	typedef Program::Reg Reg;
+
+	ProgramCompiler(Program* program, size_t vars_count);
+
+	Reg Constant(Val val);
+	bool IsConstant(Reg reg) const { return reg & CONST_REG; }
+	Val ConstantValue(Reg reg) const { return m_program->m_constants[reg & ~CONST_REG]; }
+	bool IsVar(Reg reg) const { return reg < m_program->m_vars_count; }
+
+	Reg Temp();
+	size_t Temps() const { return m_temps; }
+	void ReleaseTemps(size_t mark) { m_temps = mark; }
+
+	uint32_t Config(TSzarpConfig* sc);
+
+	size_t Emit(Program::Opcode op, Reg dst, Reg a = 0, Reg b = 0, Reg c = 0, uint32_t x = 0);
+	size_t Here() const { return m_program->m_code.size(); }
+	void SetTarget(size_t instruction, size_t target) { m_program->m_code[instruction].x = target; }
+
+	void Finish();
+};
+
 class Expression {
 public:
 	virtual Val Value() = 0;
+	/** Emits code computing the expression, @p dst is the register to use
+	 * if a result has to be stored; returns register holding the result.
+	 * Only the last instruction emitted for the expression writes @p dst. */
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) = 0;
 };
 typedef boost::shared_ptr<Expression> PExpression;
 
 class Statement {
 public:
 	virtual void Execute() = 0;
+	virtual void Compile(ProgramCompiler& c) = 0;
 };
 typedef boost::shared_ptr<Statement> PStatement;
 
@@ -83,23 +179,53 @@ struct Param {
         std::vector<Var> m_vars;
         std::vector<ParamRef> m_par_refs;
         PStatement m_statement;
+        Program m_program;
 	virtual ~Param() {}
 };
 
+/** Compiles @p e into a fresh temporary unless it is a constant or
+ * temporary already */
+Program::Reg CompileToTemp(ProgramCompiler& c, PExpression e);
+
+struct pow_functor : public std::binary_function<const Val&, const Val&, Val> {
+	Val operator() (const Val& s1, const Val& s2) const {
+		return pow(s1, s2);
+	}
+};
+
+template<class op> struct OpcodeOf;
+template<> struct OpcodeOf<std::negate<Val> > { static const Program::Opcode value = Program::NEG; };
+template<> struct OpcodeOf<std::logical_not<Val> > { static const Program::Opcode value = Program::NOT; };
+template<> struct OpcodeOf<std::plus<Val> > { static const Program::Opcode value = Program::ADD; };
+template<> struct OpcodeOf<std::minus<Val> > { static const Program::Opcode value = Program::SUB; };
+template<> struct OpcodeOf<std::multiplies<Val> > { static const Program::Opcode value = Program::MUL; };
+template<> struct OpcodeOf<std::divides<Val> > { static const Program::Opcode value = Program::DIV; };
+template<> struct OpcodeOf<std::modulus<Val> > { static const Program::Opcode value = Program::MOD; };
+template<> struct OpcodeOf<pow_functor> { static const Program::Opcode value = Program::POW; };
+template<> struct OpcodeOf<std::less<Val> > { static const Program::Opcode value = Program::LT; };
+template<> struct OpcodeOf<std::less_equal<Val> > { static const Program::Opcode value = Program::LE; };
+template<> struct OpcodeOf<std::equal_to<Val> > { static const Program::Opcode value = Program::EQ; };
+template<> struct OpcodeOf<std::greater_equal<Val> > { static const Program::Opcode value = Program::GE; };
+template<> struct OpcodeOf<std::greater<Val> > { static const Program::Opcode value = Program::GT; };
+template<> struct OpcodeOf<std::not_equal_to<Val> > { static const Program::Opcode value = Program::NE; };
+
 struct StatementList : public Statement {
 	std::vector<PStatement> m_statements;
 	void AddStatement(PStatement statement);
 	virtual void Execute();
+	virtual void Compile(ProgramCompiler& c);
 };
 
 class EmptyStatement : public Statement {
 public:
 	virtual void Execute() {}
+	virtual void Compile(ProgramCompiler& c) {}
 };
 
 class NilExpression : public Expression {
 public:
 	virtual Val Value() { return nan(""); }
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) { return c.Constant(Value()); }
 };
 
 class NumberExpression : public Expression {
@@ -110,6 +236,10 @@ public:
 	virtual Val Value() {
 		return m_val;
 	}
+
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) {
+		return c.Constant(m_val);
+	}
 };
 
 class VarRef {
@@ -119,6 +249,7 @@ public:
 	VarRef() : m_vec(NULL) {}
 	VarRef(std::vector<Var>* vec, size_t var_no) : m_vec(vec), m_var_no(var_no) {}
 	Var& var() { return (*m_vec)[m_var_no]; }
+	size_t var_no() const { return m_var_no; }
 };
 
 class ParRefRef {
@@ -138,6 +269,10 @@ public:
 	virtual Val Value() {
 		return m_var.var()();
 	}
+
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) {
+		return m_var.var_no();
+	}
 };
 
 template<class unop> class UnExpression : public Expression {
@@ -149,6 +284,16 @@ public:
 	virtual Val Value() {
 		return m_op(m_e->Value());
 	}
+
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) {
+		size_t mark = c.Temps();
+		Program::Reg r = m_e->Compile(c, c.Temp());
+		c.ReleaseTemps(mark);
+		if (c.IsConstant(r))
+			return c.Constant(Value());
+		c.Emit(OpcodeOf<unop>::value, dst, r);
+		return dst;
+	}
 };
 
 template<class op> class BinExpression : public Expression {
@@ -160,6 +305,17 @@ public:
 	virtual Val Value() {
 		return m_op(m_e1->Value(), m_e2->Value());
 	}
+
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) {
+		size_t mark = c.Temps();
+		Program::Reg r1 = m_e1->Compile(c, c.Temp());
+		Program::Reg r2 = m_e2->Compile(c, c.Temp());
+		c.ReleaseTemps(mark);
+		if (c.IsConstant(r1) && c.IsConstant(r2))
+			return c.Constant(Value());
+		c.Emit(OpcodeOf<op>::value, dst, r1, r2);
+		return dst;
+	}
 };
 
 template<> Val BinExpression<std::logical_or<Val> >::Value();
@@ -168,6 +324,12 @@ template<> Val BinExpression<std::logical_and<Val> >::Value();
 
 template<> Val BinExpression<std::modulus<Val> >::Value();
 
+template<> Program::Reg BinExpression<std::logical_or<Val> >::Compile(ProgramCompiler& c, Program::Reg dst);
+
+template<> Program::Reg BinExpression<std::logical_and<Val> >::Compile(ProgramCompiler& c, Program::Reg dst);
+
+template<> Program::Reg BinExpression<std::modulus<Val> >::Compile(ProgramCompiler& c, Program::Reg dst);
+
 class AssignmentStatement : public Statement {
 	VarRef m_var;
 	PExpression m_exp;
@@ -177,6 +339,12 @@ public:
 	virtual void Execute() {
 		m_var.var() = m_exp->Value();
 	}
+
+	virtual void Compile(ProgramCompiler& c) {
+		Program::Reg r = m_exp->Compile(c, m_var.var_no());
+		if (r != m_var.var_no())
+			c.Emit(Program::MOVE, m_var.var_no(), r);
+	}
 };
 
 class IsNanExpression : public Expression {
@@ -187,6 +355,16 @@ public:
 	virtual Val Value() {
 		return std::isnan(m_exp->Value());
 	}
+
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) {
+		size_t mark = c.Temps();
+		Program::Reg r = m_exp->Compile(c, c.Temp());
+		c.ReleaseTemps(mark);
+		if (c.IsConstant(r))
+			return c.Constant(Value());
+		c.Emit(Program::ISNAN, dst, r);
+		return dst;
+	}
 };
 
 class InSeasonExpression : public Expression {
@@ -199,6 +377,14 @@ public:
 		time_t t = m_t->Value();
 		return m_sc->GetSeasons()->IsSummerSeason(t);
 	}
+
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) {
+		size_t mark = c.Temps();
+		Program::Reg r = m_t->Compile(c, c.Temp());
+		c.ReleaseTemps(mark);
+		c.Emit(Program::IN_SEASON, dst, r, 0, 0, c.Config(m_sc));
+		return dst;
+	}
 };
 
 class ParamValue : public Expression {
@@ -212,6 +398,15 @@ public:
 	virtual Val Value() {
 		return m_param_ref.par_ref().Value(m_time->Value(), m_avg_type->Value());
 	}
+
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) {
+		size_t mark = c.Temps();
+		Program::Reg t = m_time->Compile(c, c.Temp());
+		Program::Reg pt = m_avg_type->Compile(c, c.Temp());
+		c.ReleaseTemps(mark);
+		c.Emit(Program::PARAM, dst, t, pt, 0, m_param_ref.par_ref().m_param_index);
+		return dst;
+	}
 };
 
 class SzbMoveTimeExpression : public Expression {
@@ -226,6 +421,16 @@ public:
 		return szb_move_time(m_start_time->Value(), m_displacement->Value(), SZARP_PROBE_TYPE(m_period_type->Value()), 0);
 	}
 
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) {
+		size_t mark = c.Temps();
+		Program::Reg st = m_start_time->Compile(c, c.Temp());
+		Program::Reg d = m_displacement->Compile(c, c.Temp());
+		Program::Reg pt = m_period_type->Compile(c, c.Temp());
+		c.ReleaseTemps(mark);
+		c.Emit(Program::MOVE_TIME, dst, st, d, pt);
+		return dst;
+	}
+
 };
 
 class SzbRoundTimeExpression : public Expression {
@@ -238,6 +443,15 @@ public:
 	virtual Val Value() {
 		return szb_round_time(m_time->Value(),  SZARP_PROBE_TYPE(m_period_type->Value()));
 	}
+
+	virtual Program::Reg Compile(ProgramCompiler& c, Program::Reg dst) {
+		size_t mark = c.Temps();
+		Program::Reg t = m_time->Compile(c, c.Temp());
+		Program::Reg pt = m_period_type->Compile(c, c.Temp());
+		c.ReleaseTemps(mark);
+		c.Emit(Program::ROUND_TIME, dst, t, pt);
+		return dst;
+	}
 };
 
 
@@ -268,6 +482,8 @@ public:
 		}
 	}
 
+	virtual void Compile(ProgramCompiler& c);
+
 };
 
 class ForLoopStatement : public Statement { 
@@ -292,6 +508,8 @@ public:
 		}
 	}
 
+	virtual void Compile(ProgramCompiler& c);
+
 };
 
 class WhileStatement : public Statement {
@@ -305,6 +523,8 @@ public:
 			m_stat->Execute();
 	}
 
+	virtual void Compile(ProgramCompiler& c);
+
 };
 
 class RepeatStatement : public Statement {
@@ -317,6 +537,8 @@ public:
 			m_stat->Execute();
 		while (m_cond->Value());
 	}
+
+	virtual void Compile(ProgramCompiler& c);
 };
 
 template<class T> class FunctionConverter;
@@ -176,12 +176,6 @@ template<class container_type> PExpression ExpressionConverter<container_type>::
 	return m_param_converter->ConvertTerm(term_);
 }
 
-struct pow_functor : public std::binary_function<const Val&, const Val&, Val> {
-	Val operator() (const Val& s1, const Val& s2) const {
-		return pow(s1, s2);
-	}
-};
-
 template<class container_type> PExpression ExpressionConverter<container_type>::ConvertPow(const pow_exp& exp) {
 	pow_exp::const_reverse_iterator i = exp.rbegin();
 	PExpression p = ConvertTerm(*i);
@@ -653,6 +647,10 @@ template<class container_type> void ParamConverterTempl<container_type>::Convert
 	m_param = param;
 	InitalizeVars();
 	param->m_statement = ConvertChunk(chunk_);
+
+	ProgramCompiler compiler(&param->m_program, param->m_vars.size());
+	param->m_statement->Compile(compiler);
+	compiler.Finish();
 }
 
 template<class container_type> void ParamConverterTempl<container_type>::AddVariable(std::wstring name) {
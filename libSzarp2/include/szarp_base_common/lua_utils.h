@@ -31,6 +31,9 @@ bool prepare_param(lua_State *lua, TParam* param);
 
 int  compile_lua_param(lua_State *lua, TParam *p);
 
+/** Like compile_lua_param but does not store the reference in the param */
+int  compile_lua_function(lua_State *lua, TParam *p);
+
 bool compile_lua_formula(lua_State *lua, const char *formula, const char *formula_name = "param_fomula", bool ret_v_val = true);
 
 }
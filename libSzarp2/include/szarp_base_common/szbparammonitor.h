@@ -70,6 +70,15 @@ public:
 };
 
 #ifndef MINGW32
+/** Name of the change journal file kept in base directory by writers. Each
+ * line of the journal is a "<param dir>/<file name> <file size>" record,
+ * param dir being relative to directory holding the journal. If journal
+ * is present, dirs below it are monitored by tailing the journal instead
+ * of placing an inotify watch on every param dir. Writers rotate the journal
+ * by renaming a new file over it, a journal that disappears means it is no
+ * longer kept and its dirs get inotify watches again. */
+#define SZB_CHANGE_JOURNAL ".sz4changes"
+
 class SzbParamMonitorImpl : public SzbParamMonitorImplBase {
 
 	SzbParamMonitor* m_monitor;
@@ -77,6 +86,29 @@ class SzbParamMonitorImpl : public SzbParamMonitorImplBase {
 	int m_cmd_socket[2];
 	int m_inotify_socket;
 
+	struct change_journal {
+		std::string dir;
+		int fd = -1;
+		std::string pending;
+		std::tr1::unordered_map<std::string, SzbMonitorTokenType> dirs;
+	};
+
+	std::map<std::string, change_journal> m_journals;
+	std::tr1::unordered_map<int, change_journal*> m_journal_watches;
+	std::tr1::unordered_map<SzbMonitorTokenType, std::pair<change_journal*, std::string> > m_journal_tokens;
+	std::tr1::unordered_map<std::string, bool> m_journal_dirs;
+	SzbMonitorTokenType m_journal_token = -1;
+
+	change_journal* find_journal(const std::string& path, std::string& relative_path);
+	bool open_journal(change_journal* journal, bool from_end);
+	void read_journal(change_journal* journal, std::vector<std::pair<SzbMonitorTokenType, std::string> >& tokens_and_paths);
+	bool add_journal_dir(const std::string& path, TParam* param, SzbParamObserver* observer, unsigned order);
+	void del_journal_dir(SzbMonitorTokenType token);
+	/** Replaces journal that was removed with watches on its dirs */
+	void drop_journal(int journal_wd);
+
+	int add_dir_watch(const std::string& path);
+
 	void process_notification();
 	void process_cmds();
 	void loop();
@@ -33,5 +33,12 @@ szb_move_time(time_t t, int count, SZARP_PROBE_TYPE probe_type,
 time_t
 szb_round_time(time_t t, SZARP_PROBE_TYPE probe_type, int custom_length = 0);
 
+/**
+ * Local time offsets used by szb_move_time and szb_round_time are found
+ * once per process, this finds them again. To be called after time zone
+ * of the process is changed with tzset().
+ */
+void szb_time_zone_changed();
+
 #endif
 
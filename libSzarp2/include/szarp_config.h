@@ -497,6 +497,8 @@ enum class ParamType {
 };
 
 
+class definable_program;
+
 // TODO: add visitors for LUA/RPN/DEFINABLE formulas and make then separate classes with normal interfaces
 class ParamFormulaInfo: public IPCParamInfo {
 public:
@@ -538,6 +540,12 @@ public:
 				; }
 	void CheckForNullFormula();
 
+	/** @return compiled draw formula, NULL if not set */
+	definable_program* GetDefinableProgram() { return _definable_program; }
+
+	/** Takes ownership of program, it is deleted when formula is prepared again */
+	void SetDefinableProgram(definable_program* program);
+
 #ifndef NO_LUA
 	const unsigned char* GetLuaScript() const;
 
@@ -573,6 +581,7 @@ protected:
 
 	std::wstring	_parsed_formula;    /**< parsed formula for definable calculating */
 	std::vector<TParam *> _f_cache;	    /**< formula cache */
+	definable_program* _definable_program{ nullptr }; /**< compiled draw formula */
 
 	double _f_const_value; /**< const value if formula is const */
 
@@ -23,6 +23,7 @@
 #include <zmq.hpp>
 
 #include "protobuf/paramsvalues.pb.h"
+#include "params_values_arena.h"
 
 #include "szarp_config.h"
 #include "dmncfg.h"
@@ -37,6 +38,8 @@ class zmqhandler {
 	std::vector<szarp::ParamValue> m_send;
 	std::unordered_map<size_t, size_t> m_send_map;
 
+	params_values_arena m_arena;
+
 	void process_msg(szarp::ParamsValues& values);
 
 public:
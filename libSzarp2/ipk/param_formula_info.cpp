@@ -23,6 +23,7 @@
 #include "szdefines.h"
 #include "szbase/szbdefines.h"
 #include "szbase/szbname.h"
+#include "szarp_base_common/definable_calculate.h"
 
 unsigned int
 ParamFormulaInfo::GetIpcInd() const
@@ -74,6 +75,12 @@ ParamFormulaInfo::CheckForNullFormula()
 
 ParamFormulaInfo::~ParamFormulaInfo() {
 	xmlFree(_script);
+	delete _definable_program;
+}
+
+void ParamFormulaInfo::SetDefinableProgram(definable_program* program) {
+	delete _definable_program;
+	_definable_program = program;
 }
 
 const std::wstring&
@@ -326,6 +333,8 @@ ParamFormulaInfo::PrepareDefinable()
     
     _f_cache.clear();
 
+    SetDefinableProgram(nullptr);
+
     size_t sch = 0, ech;
     
     TParam * tp = NULL;
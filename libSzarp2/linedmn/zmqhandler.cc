@@ -170,9 +170,8 @@ void zmqhandler::receive() {
 		if (!m_sub_sock.recv(&msg, ZMQ_NOBLOCK))
 			return;
 
-		szarp::ParamsValues values;
-		if (values.ParseFromArray(msg.data(), msg.size()))
-			process_msg(values);
+		if (auto values = m_arena.parse(msg.data(), msg.size()))
+			process_msg(*values);
 		else	
 			/* XXX: */;
 
@@ -19,6 +19,8 @@
 
 #include "config.h"
 
+#include <algorithm>
+
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 
@@ -38,6 +40,36 @@
 
 namespace sz4 {
 
+namespace {
+
+class thread_exit_notifier {
+	boost::thread::id m_id;
+	std::vector<std::weak_ptr<thread_exit_observer>> m_observers;
+public:
+	thread_exit_notifier() : m_id(boost::this_thread::get_id()) {}
+
+	void add(std::weak_ptr<thread_exit_observer> observer) {
+		m_observers.erase(std::remove_if(m_observers.begin(), m_observers.end(),
+				[] (const std::weak_ptr<thread_exit_observer>& o) { return o.expired(); }),
+			m_observers.end());
+		m_observers.push_back(observer);
+	}
+
+	~thread_exit_notifier() {
+		for (auto& o : m_observers)
+			if (auto observer = o.lock())
+				observer->thread_exited(m_id);
+	}
+};
+
+thread_local thread_exit_notifier exit_notifier;
+
+}
+
+void notify_on_thread_exit(std::weak_ptr<thread_exit_observer> observer) {
+	exit_notifier.add(observer);
+}
+
 template class base_templ<base_types>;
 
 }
@@ -17,6 +17,7 @@
   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
 */
 #include <algorithm>
+#include <cmath>
 #include "sz4/defs.h"
 #include "sz4/block.h"
 #include "sz4/block_cache.h"
@@ -24,7 +25,9 @@
 namespace sz4 {
 
 generic_block::generic_block(block_cache* cache) :
-		m_cache(cache) {
+		m_cache(cache),
+		m_cache_protected(false),
+		m_cache_stamp(0) {
 	m_cache->add_new_block(*this);
 }
 
@@ -43,4 +46,204 @@ void generic_block::remove_from_cache(size_t block_size) {
 generic_block::~generic_block() { 
 }
 
+namespace {
+
+template<class V> class native_weighted_sum : public summary_weighted_sum<V, second_time_t> {
+public:
+	void set(const typename value_sum<V>::type& wsum, long weight, long no_data_weight, long negative_weight) {
+		this->m_wsum = wsum;
+		this->m_weight = weight;
+		this->m_no_data_weight = no_data_weight;
+		this->m_negative_weight = negative_weight;
+	}
+};
+
+/* Floating point values have to be added in the same order as the
+ * generic loop adds them, so the loop is not vectorized; it only avoids
+ * a virtual call per entry. The result is exact only if nothing was
+ * added to r before, other sums are left to the generic loop */
+template<class V> void native_get_float_weighted_sum(const std::vector<value_time_pair<V, second_time_t> >& data,
+		const second_time_t& start_time, const second_time_t &end_time,
+		weighted_sum<V, second_time_t>& r) {
+	if (r.weight() || r.no_data_weight() || r._sum() != 0) {
+		get_weighted_sum(data.begin(), data.end(), start_time, end_time, r);
+		return;
+	}
+
+	auto i = search_entry_for_time(data.begin(), data.end(), start_time);
+	if (i == data.end())
+		return;
+
+	double wsum = 0;
+	long weight = 0;
+	long no_data_weight = 0;
+	long negative_weight = 0;
+	second_time_t prev_time = start_time;
+
+	for (; i != data.end(); i++) {
+		bool last = !(i->time < end_time);
+		long dt = last ? long(end_time - prev_time) : long(i->time - prev_time);
+		prev_time = i->time;
+
+		//no data values are NaNs, value_is_no_data is not inlined
+		if (!std::isnan(i->value)) {
+			wsum += double(i->value) * double(dt);
+			weight += dt;
+			if (i->value < 0)
+				negative_weight += dt;
+		} else {
+			no_data_weight += dt;
+		}
+
+		if (last)
+			break;
+	}
+
+	native_weighted_sum<V> sum;
+	sum.set(wsum, weight, no_data_weight, negative_weight);
+
+	if (!r.add_sum(sum))
+		get_weighted_sum(data.begin(), data.end(), start_time, end_time, r);
+}
+
+}
+
+void get_weighted_sum(const std::vector<value_time_pair<float, second_time_t> >& data,
+		const second_time_t& start_time, const second_time_t &end_time,
+		weighted_sum<float, second_time_t>& r) {
+	native_get_float_weighted_sum(data, start_time, end_time, r);
+}
+
+void get_weighted_sum(const std::vector<value_time_pair<double, second_time_t> >& data,
+		const second_time_t& start_time, const second_time_t &end_time,
+		weighted_sum<double, second_time_t>& r) {
+	native_get_float_weighted_sum(data, start_time, end_time, r);
+}
+
+#ifdef __SIZEOF_INT128__
+
+/* Runs of entries are summed in chunks small enough for products of
+ * short values to be kept in 64 bit registers; on x86_64 the loops
+ * are compiled for avx2 too and the variant is chosen at load time */
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && !defined(__clang__)
+#define SZ4_SUM_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define SZ4_SUM_CLONES
+#endif
+
+namespace {
+
+const size_t sum_chunk_size = 1024;
+
+template<class V> struct chunk_accumulator {
+	typedef __int128 type;
+};
+
+template<> struct chunk_accumulator<short> {
+	typedef long long type;
+};
+
+/** Sums entries [e, e + n), first entry's weight is counted from prev */
+template<class V> SZ4_SUM_CLONES
+__int128 sum_entries(const value_time_pair<V, second_time_t>* e, size_t n,
+		second_time_t prev, long& weight, long& no_data_weight, long& negative_weight) {
+	__int128 wsum = 0;
+
+	for (size_t c = 0; c < n; c += sum_chunk_size) {
+		size_t m = std::min(n - c, sum_chunk_size);
+		typename chunk_accumulator<V>::type chunk_wsum = 0;
+		long chunk_weight = 0;
+		long chunk_no_data_weight = 0;
+		long chunk_negative_weight = 0;
+
+		for (size_t k = 0; k < m; k++) {
+			second_time_t t = e[c + k].time;
+			second_time_t p = (c + k) ? e[c + k - 1].time : prev;
+			long dt = second_time_t(t - p);
+			V v = e[c + k].value;
+			bool nd = v == no_data<V>();
+
+			chunk_wsum += nd ? 0 : typename chunk_accumulator<V>::type(v) * dt;
+			chunk_weight += nd ? 0 : dt;
+			chunk_no_data_weight += nd ? dt : 0;
+			chunk_negative_weight += !nd && v < 0 ? dt : 0;
+		}
+
+		wsum += chunk_wsum;
+		weight += chunk_weight;
+		no_data_weight += chunk_no_data_weight;
+		negative_weight += chunk_negative_weight;
+	}
+
+	return wsum;
+}
+
+int_sum_type to_sum_type(__int128 v) {
+	unsigned __int128 u = v < 0 ? -(unsigned __int128)(v) : v;
+
+	int_sum_type r = (unsigned long long)(u >> 64);
+	r <<= 64;
+	r += (unsigned long long)(u);
+
+	return v < 0 ? int_sum_type(-r) : r;
+}
+
+template<class V> void native_get_weighted_sum(const std::vector<value_time_pair<V, second_time_t> >& data,
+		const second_time_t& start_time, const second_time_t &end_time,
+		weighted_sum<V, second_time_t>& r) {
+	typedef value_time_pair<V, second_time_t> pair_type;
+
+	auto i = search_entry_for_time(data.begin(), data.end(), start_time);
+	if (i == data.end())
+		return;
+
+	auto j = std::lower_bound(i, data.end(), end_time,
+		[] (const pair_type& p, const second_time_t& t) { return p.time < t; });
+
+	long weight = 0;
+	long no_data_weight = 0;
+	long negative_weight = 0;
+	__int128 wsum = 0;
+	second_time_t prev_time = start_time;
+
+	if (i != j) {
+		wsum = sum_entries(&*i, j - i, prev_time, weight, no_data_weight, negative_weight);
+		prev_time = (j - 1)->time;
+	}
+
+	if (j != data.end()) {
+		long dt = end_time - prev_time;
+		if (!value_is_no_data(j->value)) {
+			wsum += __int128(j->value) * dt;
+			weight += dt;
+			if (j->value < 0)
+				negative_weight += dt;
+		} else {
+			no_data_weight += dt;
+		}
+	}
+
+	native_weighted_sum<V> sum;
+	sum.set(to_sum_type(wsum), weight, no_data_weight, negative_weight);
+
+	if (!r.add_sum(sum))
+		get_weighted_sum(data.begin(), data.end(), start_time, end_time, r);
+}
+
+}
+
+void get_weighted_sum(const std::vector<value_time_pair<short, second_time_t> >& data,
+		const second_time_t& start_time, const second_time_t &end_time,
+		weighted_sum<short, second_time_t>& r) {
+	native_get_weighted_sum(data, start_time, end_time, r);
+}
+
+void get_weighted_sum(const std::vector<value_time_pair<int, second_time_t> >& data,
+		const second_time_t& start_time, const second_time_t &end_time,
+		weighted_sum<int, second_time_t>& r) {
+	native_get_weighted_sum(data, start_time, end_time, r);
+}
+
+#endif
+
 }
@@ -17,6 +17,8 @@
   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
 */
 
+#include <limits>
+
 #include "sz4/types.h"
 #include "sz4/block.h"
 #include "sz4/block_cache.h"
@@ -24,42 +26,181 @@
 
 namespace sz4 {
 
-block_cache::block_cache() : m_cache_size(0) {
+block_cache::shard::shard() :
+	m_probation_size(0), m_protected_size(0), m_loads(0),
+	m_hits(0), m_misses(0), m_evictions(0) {
+}
+
+generic_block_list& block_cache::shard::queue(generic_block& block) {
+	return block.m_cache_protected ? m_protected : m_probation;
+}
+
+size_t& block_cache::shard::queue_size(generic_block& block) {
+	return block.m_cache_protected ? m_protected_size : m_probation_size;
+}
+
+generic_block* block_cache::shard::unlink_victim() {
+	generic_block* block;
+	/*keep at most a quarter of the shard for blocks used only once*/
+	if (m_probation.size()
+			&& (m_protected.empty() || m_probation_size * 4 >= m_probation_size + m_protected_size))
+		block = &m_probation.front();
+	else if (m_protected.size())
+		block = &m_protected.front();
+	else
+		return nullptr;
+
+	queue(*block).erase(generic_block_list::s_iterator_to(*block));
+	queue_size(*block) -= block->block_size();
+	m_evictions += 1;
+
+	return block;
+}
+
+block_cache::block_cache(size_t shards_count) :
+	m_cache_size(0),
+	m_high_water_mark(std::numeric_limits<size_t>::max()),
+	m_low_water_mark(std::numeric_limits<size_t>::max()),
+	m_next_shard(0) {
+	for (size_t i = 0; i < std::max(shards_count, size_t(1)); i++)
+		m_shards.emplace_back(new shard());
+}
+
+block_cache::shard& block_cache::shard_for_block(generic_block& block) {
+	uintptr_t address = reinterpret_cast<uintptr_t>(&block);
+	return *m_shards[(address / sizeof(void*)) % m_shards.size()];
 }
 
 void block_cache::cache_size(size_t& size_in_bytes, size_t& blocks_count) const {
 	size_in_bytes = m_cache_size;
-	blocks_count = m_blocks.size() - 1;
+	blocks_count = 0;
+	for (auto& s : m_shards) {
+		std::lock_guard<std::mutex> guard(s->m_lock);
+		blocks_count += s->m_probation.size() + s->m_protected.size();
+	}
+	blocks_count -= 1;
+}
+
+void block_cache::shards_stats(std::vector<block_cache_stats>& stats) const {
+	stats.clear();
+	for (auto& s : m_shards) {
+		std::lock_guard<std::mutex> guard(s->m_lock);
+
+		block_cache_stats st;
+		st.size_in_bytes = s->m_probation_size + s->m_protected_size;
+		st.blocks_count = s->m_probation.size() + s->m_protected.size();
+		st.hits = s->m_hits;
+		st.misses = s->m_misses;
+		st.evictions = s->m_evictions;
+		stats.push_back(st);
+	}
+}
+
+void block_cache::set_water_marks(size_t low_water_mark, size_t high_water_mark) {
+	m_low_water_mark = std::min(low_water_mark, high_water_mark);
+	m_high_water_mark = high_water_mark;
 }
 
 void block_cache::add_new_block(generic_block& block) {
-	m_blocks.push_back(block);
+	shard& s = shard_for_block(block);
+	std::lock_guard<std::mutex> guard(s.m_lock);
+
+	block.m_cache_protected = false;
+	block.m_cache_stamp = ++s.m_loads;
+	s.m_misses += 1;
+	s.m_probation.push_back(block);
 }
 
 void block_cache::remove_block(generic_block& block, size_t block_size) {
+	shard& s = shard_for_block(block);
+	std::lock_guard<std::mutex> guard(s.m_lock);
+
+	/*already unlinked by eviction*/
+	if (!block.m_list_entry.is_linked())
+		return;
+
 	m_cache_size -= block_size;
-	m_blocks.erase(generic_block_list::s_iterator_to(block));
+	s.queue_size(block) -= block_size;
+	s.queue(block).erase(generic_block_list::s_iterator_to(block));
 }
 
 void block_cache::block_size_changed(generic_block& block, size_t previous_size) {
+	shard& s = shard_for_block(block);
+	std::lock_guard<std::mutex> guard(s.m_lock);
+
+	if (!block.m_list_entry.is_linked())
+		return;
+
+	size_t size = block.block_size();
+	s.queue_size(block) = s.queue_size(block) - previous_size + size;
 	m_cache_size -= previous_size;
-	m_cache_size += block.block_size();
+	m_cache_size += size;
 }
 
 void block_cache::block_touched(generic_block& block) {
-	m_blocks.erase(generic_block_list::s_iterator_to(block));
-	m_blocks.push_back(block);
+	shard& s = shard_for_block(block);
+	std::lock_guard<std::mutex> guard(s.m_lock);
+
+	if (!block.m_list_entry.is_linked())
+		return;
+
+	s.m_hits += 1;
+
+	if (!block.m_cache_protected) {
+		/*still used by the query that loaded it*/
+		if (block.m_cache_stamp == s.m_loads)
+			return;
+
+		size_t size = block.block_size();
+		s.m_probation.erase(generic_block_list::s_iterator_to(block));
+		s.m_probation_size -= size;
+
+		block.m_cache_protected = true;
+		s.m_protected.push_back(block);
+		s.m_protected_size += size;
+	} else {
+		s.m_protected.erase(generic_block_list::s_iterator_to(block));
+		s.m_protected.push_back(block);
+	}
 }
 
 void block_cache::remove(size_t size) {
-	while (size > 0 && m_blocks.size()) {
-		size -= std::min(size, m_blocks.front().block_size());
+	size_t empty_shards = 0;
+	while (size > 0 && empty_shards < m_shards.size()) {
+		shard& s = *m_shards[m_next_shard++ % m_shards.size()];
+
+		generic_block* block;
+		size_t block_size = 0;
+		{
+			std::lock_guard<std::mutex> guard(s.m_lock);
+			block = s.unlink_victim();
+			if (block)
+				block_size = block->block_size();
+		}
+
+		if (block == nullptr) {
+			empty_shards += 1;
+			continue;
+		}
+		empty_shards = 0;
+
+		m_cache_size -= block_size;
+		size -= std::min(size, block_size);
 
-		auto block = &m_blocks.front();
 		delete block;
 	}
 }
 
+bool block_cache::over_high_water_mark() const {
+	return m_cache_size > m_high_water_mark;
+}
+
+void block_cache::purge() {
+	size_t size = m_cache_size;
+	if (size > m_high_water_mark)
+		remove(size - m_low_water_mark);
+}
+
 cache_block_size_updater::cache_block_size_updater(
 				generic_block* block)
 				:
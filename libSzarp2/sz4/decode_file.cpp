@@ -54,6 +54,9 @@ size_t decode_delta(long long& delta, const unsigned char* buffer, size_t size)
 	size_t count;
 
 	decode_first_byte(*buffer, count, delta);
+	if (count + 1 > size)
+		return 0;
+
 	decode_remaining_bytes(buffer, size, count, delta);
 	
 	return count + 1;
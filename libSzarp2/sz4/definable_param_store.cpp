@@ -0,0 +1,359 @@
+/*
+  SZARP: SCADA software
+
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+*/
+#include "config.h"
+
+#include <cstring>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "conversion.h"
+#include "liblog.h"
+#include "sz4/filelock.h"
+#include "sz4/definable_param_store.h"
+#include "sz4/file_summary_store.h"
+
+namespace sz4 {
+
+namespace {
+
+const char STORE_MAGIC[8] = { 'S', 'Z', '4', 'D', 'E', 'F', 'S', 1 };
+
+struct __attribute__ ((packed)) store_header {
+	char magic[8];
+	uint64_t formula_hash;
+	uint32_t value_size;
+	uint32_t time_size;
+	uint32_t dirs_count;
+};
+
+struct __attribute__ ((packed)) store_dir_header {
+	uint64_t files_count;
+	uint64_t files_hash;
+};
+
+std::string path_string(const boost::filesystem::wpath& path) {
+#if BOOST_FILESYSTEM_VERSION == 3
+	return path.string();
+#else
+	return path.external_file_string();
+#endif
+}
+
+}
+
+definable_store_writer::definable_store_writer(const boost::filesystem::wpath& dir) : m_dir(dir), m_stop(false) {
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(m_dir, ec);
+	if (ec)
+		sz_log(1, "Failed to create definable params store directory %s: %s", path_string(m_dir).c_str(), ec.message().c_str());
+
+	m_thread = boost::thread(&definable_store_writer::run, this);
+}
+
+void definable_store_writer::run() {
+	boost::unique_lock<boost::mutex> lock(m_lock);
+	while (true) {
+		while (!m_stop && m_jobs.empty())
+			m_cond.wait(lock);
+
+		if (m_jobs.empty())
+			return;
+
+		std::function<void()> job(m_jobs.front());
+		m_jobs.pop_front();
+
+		lock.unlock();
+		try {
+			job();
+		} catch (std::exception& e) {
+			sz_log(1, "Failed to write definable params store: %s", e.what());
+		}
+		lock.lock();
+	}
+}
+
+void definable_store_writer::post(const std::function<void()>& job) {
+	boost::lock_guard<boost::mutex> lock(m_lock);
+	m_jobs.push_back(job);
+	m_cond.notify_one();
+}
+
+definable_store_writer::~definable_store_writer() {
+	{
+		boost::lock_guard<boost::mutex> lock(m_lock);
+		m_stop = true;
+		m_cond.notify_one();
+	}
+	m_thread.join();
+}
+
+uint64_t store_hash(const void* data, size_t size, uint64_t hash) {
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+bool stat_data_file(const boost::filesystem::wpath& path, data_file_stamp& stamp) {
+	namespace fs = boost::filesystem;
+
+	boost::system::error_code ec;
+#if BOOST_FILESYSTEM_VERSION == 3
+	stamp.name = path.filename().wstring();
+#else
+	stamp.name = path.filename();
+#endif
+	stamp.size = fs::file_size(path, ec);
+	if (ec)
+		return false;
+	stamp.mtime = fs::last_write_time(path, ec);
+	return !ec;
+}
+
+void list_data_dir(const boost::filesystem::wpath& dir, data_dir_listing& listing) {
+	namespace fs = boost::filesystem;
+
+	listing.clear();
+
+	boost::system::error_code ec;
+	fs::directory_iterator i(dir, ec);
+	if (ec)
+		return;
+
+	for (; i != fs::directory_iterator(); i.increment(ec)) {
+		if (ec)
+			break;
+
+		if (!fs::is_regular_file(i->status()))
+			continue;
+
+		data_file_stamp stamp;
+		if (stat_data_file(i->path(), stamp))
+			listing.push_back(stamp);
+	}
+
+	std::sort(listing.begin(), listing.end(),
+		[] (const data_file_stamp& s1, const data_file_stamp& s2) { return s1.name < s2.name; });
+}
+
+uint64_t data_dir_hash(const data_dir_listing& listing, size_t count) {
+	uint64_t hash = store_hash(nullptr, 0);
+	for (size_t i = 0; i < count && i < listing.size(); i++) {
+		const data_file_stamp& stamp = listing[i];
+		hash = store_hash(stamp.name.data(), stamp.name.size() * sizeof(wchar_t), hash);
+		hash = store_hash(&stamp.size, sizeof(stamp.size), hash);
+		hash = store_hash(&stamp.mtime, sizeof(stamp.mtime), hash);
+	}
+	return hash;
+}
+
+namespace {
+
+uint64_t definition_hash(TParam* param, uint64_t hash) {
+	const std::wstring& name = param->GetName();
+	hash = store_hash(name.data(), name.size() * sizeof(wchar_t), hash);
+
+	const std::wstring& formula = param->GetFormula();
+	hash = store_hash(formula.data(), formula.size() * sizeof(wchar_t), hash);
+
+	const unsigned char* script = param->GetLuaScript();
+	if (script)
+		hash = store_hash(script, strlen((const char*) script), hash);
+
+	int prec = param->GetPrec();
+	hash = store_hash(&prec, sizeof(prec), hash);
+
+	int type = int(param->GetType());
+	return store_hash(&type, sizeof(type), hash);
+}
+
+}
+
+definable_store_source::definable_store_source(TParam* param, const std::vector<boost::filesystem::wpath>& dirs,
+		const std::vector<TParam*>& referred) : m_dirs(dirs), m_listings(dirs.size()), m_listings_valid(dirs.size(), false) {
+	uint64_t hash = definition_hash(param, store_hash(nullptr, 0));
+
+	std::vector<TParam*> params;
+	for (auto p : referred)
+		if (p != param)
+			params.push_back(p);
+	std::sort(params.begin(), params.end(),
+		[] (TParam* p1, TParam* p2) { return p1->GetName() < p2->GetName(); });
+
+	for (auto p : params)
+		hash = definition_hash(p, hash);
+
+	for (auto& dir : m_dirs) {
+		std::string s = path_string(dir);
+		hash = store_hash(s.data(), s.size(), hash);
+	}
+
+	m_formula_hash = hash;
+}
+
+void definable_store_source::file_changed(const boost::filesystem::wpath& dir, const std::string& path) {
+#if BOOST_FILESYSTEM_VERSION == 3
+	std::wstring name = boost::filesystem::path(path).filename().wstring();
+#else
+	std::wstring name = SC::A2S(boost::filesystem::path(path).filename());
+#endif
+
+	boost::lock_guard<boost::mutex> lock(m_listings_lock);
+
+	for (size_t i = 0; i < m_dirs.size(); i++) {
+		if (m_dirs[i] != dir || !m_listings_valid[i])
+			continue;
+
+		data_dir_listing& listing = m_listings[i];
+		if (listing.size() && listing.back().name == name
+				&& stat_data_file(dir / name, listing.back()))
+			continue;
+
+		m_listings_valid[i] = false;
+	}
+}
+
+void definable_store_source::refresh_listings() const {
+	for (size_t i = 0; i < m_dirs.size(); i++) {
+		if (m_listings_valid[i])
+			continue;
+
+		list_data_dir(m_dirs[i], m_listings[i]);
+		m_listings_valid[i] = true;
+	}
+}
+
+std::string definable_store_source::make_header(size_t value_size, size_t time_size) const {
+	store_header header;
+	memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+	header.formula_hash = m_formula_hash;
+	header.value_size = value_size;
+	header.time_size = time_size;
+	header.dirs_count = m_dirs.size();
+
+	std::string r(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	boost::lock_guard<boost::mutex> lock(m_listings_lock);
+	refresh_listings();
+
+	for (auto& listing : m_listings) {
+		store_dir_header dir_header;
+		dir_header.files_count = listing.size() ? listing.size() - 1 : 0;
+		dir_header.files_hash = data_dir_hash(listing, dir_header.files_count);
+
+		r.append(reinterpret_cast<const char*>(&dir_header), sizeof(dir_header));
+	}
+
+	return r;
+}
+
+size_t definable_store_source::check_header(const unsigned char* data, size_t size, size_t value_size, size_t time_size) const {
+	size_t header_size = sizeof(store_header) + m_dirs.size() * sizeof(store_dir_header);
+	if (size < header_size)
+		return 0;
+
+	store_header header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, STORE_MAGIC, sizeof(header.magic))
+			|| header.formula_hash != m_formula_hash
+			|| header.value_size != value_size
+			|| header.time_size != time_size
+			|| header.dirs_count != m_dirs.size())
+		return 0;
+
+	boost::lock_guard<boost::mutex> lock(m_listings_lock);
+	refresh_listings();
+
+	for (size_t i = 0; i < m_dirs.size(); i++) {
+		store_dir_header dir_header;
+		memcpy(&dir_header, data + sizeof(header) + i * sizeof(dir_header), sizeof(dir_header));
+
+		const data_dir_listing& listing = m_listings[i];
+		if (listing.size() < dir_header.files_count)
+			return 0;
+
+		if (data_dir_hash(listing, dir_header.files_count) != dir_header.files_hash)
+			return 0;
+	}
+
+	return header_size;
+}
+
+std::wstring definable_store_source::file_name(SZARP_PROBE_TYPE probe_type, size_t value_size, size_t time_size) const {
+	std::wstringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill(L'0') << m_formula_hash
+		<< std::dec << L"_" << int(probe_type) << L"_" << value_size << L"_" << time_size << L".sz4d";
+	return ss.str();
+}
+
+std::wstring file_summary_store_name(const boost::filesystem::wpath& param_dir,
+		size_t value_size, bool value_integer, bool value_signed, size_t time_size) {
+	std::string dir = path_string(param_dir);
+	uint64_t hash = store_hash(dir.data(), dir.size());
+
+	std::wstringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill(L'0') << hash
+		<< std::dec << L"_" << value_size << (value_integer ? (value_signed ? L"i" : L"u") : L"f")
+		<< L"_" << time_size << L".sz4s";
+	return ss.str();
+}
+
+bool write_store_file(const boost::filesystem::wpath& path, const std::string& content) {
+	std::string file_path = path_string(path);
+	std::string temp_path = file_path + ".tmp";
+
+	int fd;
+	try {
+		fd = open_writelock(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC);
+	} catch (std::runtime_error& e) {
+		sz_log(1, "Failed to open definable params store file %s: %s", temp_path.c_str(), e.what());
+		return false;
+	}
+
+	bool ok = true;
+	size_t written = 0;
+	while (ok && written < content.size()) {
+		ssize_t r = write(fd, content.data() + written, content.size() - written);
+		if (r < 0)
+			ok = errno == EINTR;
+		else
+			written += r;
+	}
+
+	try {
+		close_unlock(fd);
+	} catch (file_lock_error&) {
+		close(fd);
+	}
+
+	if (!ok || rename(temp_path.c_str(), file_path.c_str())) {
+		sz_log(1, "Failed to write definable params store file %s: %s", file_path.c_str(), strerror(errno));
+		unlink(temp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+}
@@ -53,6 +53,10 @@ template<> double no_data<double>() {
 	return nan("");
 }
 
+bool no_data_search_condition::may_match(const values_summary& summary) const {
+	return summary.has_data;
+}
+
 bool no_data_search_condition::operator()(const short& v) const {
 	return v != std::numeric_limits<short>::min();
 }
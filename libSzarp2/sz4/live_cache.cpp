@@ -26,6 +26,7 @@
 #ifndef MINGW32
 #include <zmq.hpp>
 #include "protobuf/paramsvalues.pb.h"
+#include "params_values_arena.h"
 #endif
 
 #include "sz4/block.h"
@@ -52,16 +53,15 @@ void live_cache::process_msg(szarp::ParamsValues* values, size_t sock_no) {
 #endif
 }
 
-void live_cache::process_socket(size_t sock_no) {
+void live_cache::process_socket(size_t sock_no, params_values_arena& arena) {
 #ifndef MINGW32
 	do {
 		zmq::message_t msg;
 		if (!m_socks[sock_no]->recv(&msg, ZMQ_NOBLOCK))
 			return;
 
-		szarp::ParamsValues values;
-		if (values.ParseFromArray(msg.data(), msg.size()))
-			process_msg(&values, sock_no);
+		if (auto values = arena.parse(msg.data(), msg.size()))
+			process_msg(values, sock_no);
 		else	
 			/* XXX: */;
 
@@ -92,6 +92,7 @@ void live_cache::run(std::promise<void> promise) {
 		m_socks.push_back(std::move(sock));
 	}
 
+	params_values_arena arena;
 	std::vector<zmq::pollitem_t> polls;
 
 	for (auto& sock : m_socks) {
@@ -103,7 +104,7 @@ void live_cache::run(std::promise<void> promise) {
 	}
 
 	for (size_t i = 0; i < polls.size(); i++) 
-		process_socket(i);
+		process_socket(i, arena);
 
 	promise.set_value();
 
@@ -120,7 +121,7 @@ void live_cache::run(std::promise<void> promise) {
 
 		for (size_t i = 0; i < polls.size() - 1; i++) 
 			if (polls[i].revents & ZMQ_POLLIN)
-				process_socket(i);
+				process_socket(i, arena);
 
 		if (polls.back().revents & ZMQ_POLLIN)
 			return;
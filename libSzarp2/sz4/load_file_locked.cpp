@@ -5,9 +5,14 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <sys/file.h>
+#include <sys/stat.h>
+#ifndef MINGW32
+#include <sys/mman.h>
+#endif
 
 #include "conversion.h"
 #include "sz4/filelock.h"
+#include "sz4/load_file_locked.h"
 
 namespace sz4 {
 
@@ -46,4 +51,66 @@ bool load_file_locked(const boost::filesystem::wpath& path, void *data, size_t s
 	}
 }
 
+mapped_file_locked::mapped_file_locked(const boost::filesystem::wpath& path) : m_fd(-1), m_data(nullptr), m_size(0), m_id(0, 0) {
+#ifndef MINGW32
+	try {
+#if BOOST_FILESYSTEM_VERSION == 3
+		m_fd = open_readlock(path.string().c_str(), O_RDONLY);
+#else
+		m_fd = open_readlock(path.external_file_string().c_str(), O_RDONLY);
+#endif
+	} catch (std::runtime_error&) {
+		m_fd = -1;
+		return;
+	}
+
+	struct stat st;
+	if (fstat(m_fd, &st)) {
+		close_unlock(m_fd);
+		m_fd = -1;
+		return;
+	}
+
+	m_size = st.st_size;
+	m_id = std::make_pair(st.st_dev, st.st_ino);
+	if (m_size == 0)
+		return;
+
+	m_data = mmap(NULL, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+	if (m_data == MAP_FAILED) {
+		m_data = nullptr;
+		m_size = 0;
+		close_unlock(m_fd);
+		m_fd = -1;
+		return;
+	}
+	madvise(m_data, m_size, MADV_SEQUENTIAL);
+#else
+	boost::system::error_code ec;
+	size_t size = boost::filesystem::file_size(path, ec);
+	if (ec)
+		return;
+
+	m_buffer.resize(size);
+	if (size && !load_file_locked(path, &m_buffer[0], size))
+		return;
+
+	m_fd = 0;
+	m_size = size;
+	m_data = size ? &m_buffer[0] : nullptr;
+#endif
+}
+
+mapped_file_locked::~mapped_file_locked() {
+#ifndef MINGW32
+	if (m_data)
+		munmap(m_data, m_size);
+	if (m_fd != -1) try {
+		close_unlock(m_fd);
+	} catch (file_lock_error&) {
+		close(m_fd);
+	}
+#endif
+}
+
 }
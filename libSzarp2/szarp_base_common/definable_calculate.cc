@@ -505,3 +505,307 @@ szb_definable_calculate(double * stack, int stack_size, const double** cache, TP
 	return stack[0];
 }
 
+
+definable_program::definable_program(TParam* param) : m_param(param) {
+	const std::wstring& formula = param->GetDrawFormula();
+	TParam** params = param->GetFormulaCache();
+	int param_cnt = param->GetNumParsInFormula();
+
+	if (formula.empty()) {
+		sz_log(1, "Invalid, NULL formula");
+		emit(FAIL);
+		return;
+	}
+
+	/* tokens are recognized exactly the way szb_definable_calculate does it */
+	const wchar_t *chptr = formula.c_str();
+	int it = 0;
+	wchar_t* end_ptr;
+
+	do {
+		if (iswdigit(*chptr)) {
+			chptr = wcschr(chptr, L' ');
+
+			if (it >= param_cnt) {
+				sz_log(1, "FATAL: in definable_program: it > param_cnt");
+				sz_log(1, " param: %ls", param->GetName().c_str());
+				sz_log(1, " formula: %ls", formula.c_str());
+				emit(FAIL);
+				return;
+			}
+
+			emit(PUSH_PARAM, it, pow(10, params[it]->GetPrec()));
+			it++;
+			continue;
+		}
+
+		switch (*chptr) {
+			case L'&':
+				emit(SWAP);
+				break;
+			case L'!':
+				emit(DUP);
+				break;
+			case L'$':
+				emit(CALL);
+				break;
+			case L'#':
+				emit(PUSH_CONST, 0, wcstod(++chptr, &end_ptr));
+				chptr = wcschr(chptr, L' ');
+				break;
+			case L'?':
+				if (*(++chptr) == L'f')
+					emit(IF);
+				else if (*chptr == 0)
+					return;
+				break;
+			case L'+':
+				emit(ADD);
+				break;
+			case L'-':
+				emit(SUB);
+				break;
+			case L'*':
+				emit(MUL);
+				break;
+			case L'/':
+				emit(DIV);
+				break;
+			case L'>':
+				emit(GREATER);
+				break;
+			case L'<':
+				emit(LESS);
+				break;
+			case L'~':
+				emit(EQUAL);
+				break;
+			case L':':
+				emit(WORD);
+				break;
+			case L'^':
+				emit(POWER);
+				break;
+			case L'N':
+				emit(NODATA_OR);
+				break;
+			case L'X':
+				emit(PUSH_NODATA);
+				break;
+			case L'S':
+				emit(SUMMER);
+				break;
+			default:
+				break;
+		}
+	} while (chptr && *(++chptr) != 0);
+}
+
+void definable_program::emit(opcode op, int index, double value) {
+	instruction i;
+	i.op = op;
+	i.index = index;
+	i.value = value;
+	m_code.push_back(i);
+}
+
+double definable_program::execute(double* stack, int stack_size, const double** cache,
+		value_fetch_functor& value_fetch, is_summer_functor& is_summer) const {
+	using std::isnan;
+
+	short sp = 0;
+	short par_cnt;
+	int i1, i2;
+	double tmp;
+
+	szb_definable_error = 0;
+
+	for (std::vector<instruction>::const_iterator i = m_code.begin(); i != m_code.end(); i++) {
+		switch (i->op) {
+			case PUSH_PARAM:
+				if (sp >= stack_size) {
+					sz_log(1, "Nastapilo przepelnienie stosu przy liczeniu formuly %ls",
+						m_param->GetDrawFormula().c_str());
+					return nan("");
+				}
+
+				if (cache[i->index] != NULL) {
+					const double * data = cache[i->index];
+					if (!isnan(*data))
+						stack[sp++] = *data * i->value;
+					else
+						stack[sp++] = nan("");
+				} else {
+					TParam* fp = m_param->GetFormulaCache()[i->index];
+					/* as in szb_definable_calculate fetched value is not multiplied */
+					if (fp->GetType() == ParamType::LUA
+							&& fp->GetFormulaType() == FormulaType::LUA_AV)
+						stack[sp++] = value_fetch(fp);
+					else
+						stack[sp++] = nan("");
+				}
+				break;
+			case PUSH_CONST:
+				if (stack_size <= sp) {
+					sz_log(1, "Przepelnienie stosu dla formuly %ls, przy odkladaniu stalej: %lf",
+						m_param->GetDrawFormula().c_str(), i->value);
+					return nan("");
+				}
+				stack[sp++] = i->value;
+				break;
+			case PUSH_NODATA:
+				if (stack_size <= sp) {
+					sz_log(1, "Przepelnienie stosu dla formuly %ls, w funkcji X",
+						m_param->GetDrawFormula().c_str());
+					return nan("");
+				}
+				stack[sp++] = nan("");
+				break;
+			case SWAP:
+				if (sp < 2)
+					return nan("");
+				if (isnan(stack[sp - 1]) || isnan(stack[sp - 2]))
+					return nan("");
+				tmp = stack[sp - 1];
+				stack[sp - 1] = stack[sp - 2];
+				stack[sp - 2] = tmp;
+				break;
+			case DUP:
+				if (sp < 1 || isnan(stack[sp - 1]))
+					return nan("");
+				if (stack_size <= sp) {
+					sz_log(1, "Przepelnienie stosu dla formuly %ls, w funkcji '!'",
+						m_param->GetDrawFormula().c_str());
+					return nan("");
+				}
+				stack[sp] = stack[sp - 1];
+				sp++;
+				break;
+			case CALL:
+				if (sp-- < 2)
+					return nan("");
+				par_cnt = (short) rint(stack[sp - 1]);
+				if (sp < par_cnt + 1)
+					return nan("");
+				for (int j = sp - 2; j >= sp - par_cnt - 1; j--)
+					if (isnan(stack[j]))
+						return nan("");
+
+				stack[sp - par_cnt - 1] =
+					szb_definable_choose_function(stack[sp], &stack[sp - par_cnt - 1]);
+
+				sp -= par_cnt;
+				break;
+			case IF:
+				if (sp-- < 3)
+					return nan("");
+				if (0 == stack[sp])
+					stack[sp - 2] = stack[sp - 1];
+				sp--;
+				break;
+			case ADD:
+				if (sp-- < 2)
+					return nan("");
+				if (isnan(stack[sp]) || isnan(stack[sp - 1]))
+					return nan("");
+				stack[sp - 1] += stack[sp];
+				break;
+			case SUB:
+				if (sp-- < 2)
+					return nan("");
+				if (isnan(stack[sp]) || isnan(stack[sp - 1]))
+					return nan("");
+				stack[sp - 1] -= stack[sp];
+				break;
+			case MUL:
+				if (sp-- < 2)
+					return nan("");
+				if (isnan(stack[sp]) || isnan(stack[sp - 1]))
+					return nan("");
+				stack[sp - 1] *= stack[sp];
+				break;
+			case DIV:
+				if (sp-- < 2)
+					return nan("");
+				if (isnan(stack[sp]) || isnan(stack[sp - 1]))
+					return nan("");
+				if (stack[sp] == 0.0) {
+					sz_log(4, "WARRNING: definable_program: dzielenie przez zero ");
+					return nan("");
+				}
+				stack[sp - 1] /= stack[sp];
+				break;
+			case GREATER:
+				if (sp-- < 2)
+					return nan("");
+				if (isnan(stack[sp]) || isnan(stack[sp - 1]))
+					return nan("");
+				stack[sp - 1] = stack[sp - 1] > stack[sp] ? 1 : 0;
+				break;
+			case LESS:
+				if (sp-- < 2)
+					return nan("");
+				if (isnan(stack[sp]) || isnan(stack[sp - 1]))
+					return nan("");
+				stack[sp - 1] = stack[sp - 1] < stack[sp] ? 1 : 0;
+				break;
+			case EQUAL:
+				if (sp-- < 2)
+					return nan("");
+				if (isnan(stack[sp]) || isnan(stack[sp - 1]))
+					return nan("");
+				stack[sp - 1] = stack[sp - 1] == stack[sp] ? 1 : 0;
+				break;
+			case WORD:
+				if (sp-- < 2)
+					return nan("");
+				if (isnan(stack[sp]) || isnan(stack[sp - 1]))
+					return nan("");
+				i1 = (short) rint(stack[sp - 1]);
+				i2 = (short) rint(stack[sp]);
+				stack[sp - 1] = (double) ((i1 << 16) | i2);
+				break;
+			case POWER:
+				if (sp-- < 2)
+					return nan("");
+				if (isnan(stack[sp]) || isnan(stack[sp - 1]))
+					return nan("");
+				if (stack[sp] == 0.0) {
+					stack[sp - 1] = 1;
+				} else if (stack[sp - 1] >= 0.0) {
+					stack[sp - 1] = pow(stack[sp - 1], stack[sp]);
+				} else {
+					sz_log(4, "WARRNING: definable_program: podstawa potegi < 0");
+					return nan("");
+				}
+				break;
+			case NODATA_OR:
+				if (sp-- < 2)
+					return nan("");
+				if (isnan(stack[sp - 1]))
+					stack[sp - 1] = stack[sp];
+				break;
+			case SUMMER:
+				if (stack_size <= sp) {
+					sz_log(1, "Przepelnienie stosu dla formuly %ls, w funkcji S",
+						m_param->GetDrawFormula().c_str());
+					return nan("");
+				}
+				{
+					bool is_in_summer;
+					if (is_summer(is_in_summer))
+						stack[sp++] = is_in_summer ? 1 : 0;
+				}
+				break;
+			case FAIL:
+				return nan("");
+		}
+	}
+
+	if (isnan(stack[0])) {
+		sz_log(10, "WARRNING: definable_program: stack[0] == nan("")");
+		return nan("");
+	}
+
+	return stack[0];
+}
@@ -22,6 +22,9 @@
 #include "conversion.h"
 #include "liblog.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
 
@@ -138,6 +141,399 @@ template<> Val BinExpression<std::modulus<Val> >::Value() {
 	return int(m_e1->Value()) % int(m_e2->Value());
 }
 
+namespace {
+
+Program::Reg CompileLogical(ProgramCompiler& c, Program::Reg dst, PExpression e1, PExpression e2, bool or_) {
+	size_t mark = c.Temps();
+	Program::Reg r1 = e1->Compile(c, c.Temp());
+	c.ReleaseTemps(mark);
+	if (c.IsConstant(r1)) {
+		if (bool(c.ConstantValue(r1)) == or_)
+			return c.Constant(or_);
+
+		Program::Reg r2 = e2->Compile(c, c.Temp());
+		c.ReleaseTemps(mark);
+		if (c.IsConstant(r2))
+			return c.Constant(bool(c.ConstantValue(r2)));
+
+		c.Emit(Program::BOOL, dst, r2);
+		return dst;
+	}
+
+	size_t short_circuit = c.Emit(or_ ? Program::JMP_IF : Program::JMP_IF_NOT, 0, r1);
+
+	Program::Reg r2 = e2->Compile(c, c.Temp());
+	c.ReleaseTemps(mark);
+	c.Emit(Program::BOOL, dst, r2);
+	size_t end = c.Emit(Program::JMP, 0);
+
+	c.SetTarget(short_circuit, c.Here());
+	c.Emit(Program::MOVE, dst, c.Constant(or_));
+	c.SetTarget(end, c.Here());
+
+	return dst;
+}
+
+/** Number of register operands (a, b, c) an instruction reads */
+int ReadsCount(Program::Opcode op) {
+	switch (op) {
+		case Program::MOVE:
+		case Program::BOOL:
+		case Program::NOT:
+		case Program::NEG:
+		case Program::ISNAN:
+		case Program::IN_SEASON:
+		case Program::JMP_IF:
+		case Program::JMP_IF_NOT:
+			return 1;
+		case Program::MOVE_TIME:
+		case Program::FOR_TEST:
+			return 3;
+		case Program::JMP:
+		case Program::END:
+			return 0;
+		default:
+			return 2;
+	}
+}
+
+bool WritesDst(Program::Opcode op) {
+	return op < Program::JMP;
+}
+
+bool IsJump(Program::Opcode op) {
+	return op >= Program::JMP && op <= Program::FOR_TEST;
+}
+
+}
+
+template<> Program::Reg BinExpression<std::logical_or<Val> >::Compile(ProgramCompiler& c, Program::Reg dst) {
+	return CompileLogical(c, dst, m_e1, m_e2, true);
+}
+
+template<> Program::Reg BinExpression<std::logical_and<Val> >::Compile(ProgramCompiler& c, Program::Reg dst) {
+	return CompileLogical(c, dst, m_e1, m_e2, false);
+}
+
+template<> Program::Reg BinExpression<std::modulus<Val> >::Compile(ProgramCompiler& c, Program::Reg dst) {
+	size_t mark = c.Temps();
+	Program::Reg r1 = m_e1->Compile(c, c.Temp());
+	Program::Reg r2 = m_e2->Compile(c, c.Temp());
+	c.ReleaseTemps(mark);
+	/* integer division by zero is left for run time */
+	if (c.IsConstant(r1) && c.IsConstant(r2) && int(c.ConstantValue(r2)))
+		return c.Constant(Value());
+	c.Emit(Program::MOD, dst, r1, r2);
+	return dst;
+}
+
+Program::Reg CompileToTemp(ProgramCompiler& c, PExpression e) {
+	Program::Reg t = c.Temp();
+	Program::Reg r = e->Compile(c, t);
+	if (c.IsVar(r)) {
+		c.Emit(Program::MOVE, t, r);
+		r = t;
+	}
+	return r;
+}
+
+void StatementList::Compile(ProgramCompiler& c) {
+	for (size_t i = 0; i < m_statements.size(); i++)
+		m_statements[i]->Compile(c);
+}
+
+void IfStatement::Compile(ProgramCompiler& c) {
+	std::vector<std::pair<PExpression, PStatement> > branches;
+	branches.push_back(std::make_pair(m_cond, m_consequent));
+	branches.insert(branches.end(), m_elseif.begin(), m_elseif.end());
+
+	std::vector<size_t> exits;
+	bool alternative = true;
+	for (size_t i = 0; i < branches.size() && alternative; i++) {
+		size_t mark = c.Temps();
+		Program::Reg r = branches[i].first->Compile(c, c.Temp());
+		c.ReleaseTemps(mark);
+
+		if (c.IsConstant(r)) {
+			if (c.ConstantValue(r)) {
+				branches[i].second->Compile(c);
+				alternative = false;
+			}
+			continue;
+		}
+
+		size_t next = c.Emit(Program::JMP_IF_NOT, 0, r);
+		branches[i].second->Compile(c);
+		exits.push_back(c.Emit(Program::JMP, 0));
+		c.SetTarget(next, c.Here());
+	}
+
+	if (alternative)
+		m_alternative->Compile(c);
+
+	for (size_t i = 0; i < exits.size(); i++)
+		c.SetTarget(exits[i], c.Here());
+}
+
+void ForLoopStatement::Compile(ProgramCompiler& c) {
+	Program::Reg var = m_var.var_no();
+	Program::Reg start = m_start->Compile(c, var);
+	if (start != var)
+		c.Emit(Program::MOVE, var, start);
+
+	size_t mark = c.Temps();
+	Program::Reg limit = CompileToTemp(c, m_limit);
+	Program::Reg step = CompileToTemp(c, m_step);
+
+	size_t test = c.Emit(Program::FOR_TEST, 0, var, limit, step);
+	m_stat->Compile(c);
+	c.Emit(Program::ADD, var, var, step);
+	c.Emit(Program::JMP, 0, 0, 0, 0, test);
+	c.SetTarget(test, c.Here());
+
+	c.ReleaseTemps(mark);
+}
+
+void WhileStatement::Compile(ProgramCompiler& c) {
+	size_t start = c.Here();
+
+	size_t mark = c.Temps();
+	Program::Reg r = m_cond->Compile(c, c.Temp());
+	c.ReleaseTemps(mark);
+
+	if (c.IsConstant(r) && !c.ConstantValue(r))
+		return;
+
+	size_t exit = c.IsConstant(r) ? 0 : c.Emit(Program::JMP_IF_NOT, 0, r);
+	m_stat->Compile(c);
+	c.Emit(Program::JMP, 0, 0, 0, 0, start);
+	if (!c.IsConstant(r))
+		c.SetTarget(exit, c.Here());
+}
+
+void RepeatStatement::Compile(ProgramCompiler& c) {
+	size_t start = c.Here();
+	m_stat->Compile(c);
+
+	size_t mark = c.Temps();
+	Program::Reg r = m_cond->Compile(c, c.Temp());
+	c.ReleaseTemps(mark);
+
+	if (!c.IsConstant(r))
+		c.Emit(Program::JMP_IF, 0, r, 0, 0, start);
+	else if (c.ConstantValue(r))
+		c.Emit(Program::JMP, 0, 0, 0, 0, start);
+}
+
+ProgramCompiler::ProgramCompiler(Program* program, size_t vars_count) : m_program(program), m_temps(0), m_max_temps(0) {
+	m_program->m_code.clear();
+	m_program->m_constants.clear();
+	m_program->m_configs.clear();
+	m_program->m_vars_count = vars_count;
+	m_program->m_registers_count = vars_count;
+}
+
+ProgramCompiler::Reg ProgramCompiler::Constant(Val val) {
+	std::vector<Val>& constants = m_program->m_constants;
+	for (size_t i = 0; i < constants.size(); i++)
+		if (!memcmp(&constants[i], &val, sizeof(val)))
+			return CONST_REG | i;
+
+	constants.push_back(val);
+	return CONST_REG | (constants.size() - 1);
+}
+
+ProgramCompiler::Reg ProgramCompiler::Temp() {
+	m_max_temps = std::max(m_max_temps, m_temps + 1);
+	return TEMP_REG | m_temps++;
+}
+
+uint32_t ProgramCompiler::Config(TSzarpConfig* sc) {
+	std::vector<TSzarpConfig*>& configs = m_program->m_configs;
+	std::vector<TSzarpConfig*>::iterator i = std::find(configs.begin(), configs.end(), sc);
+	if (i != configs.end())
+		return i - configs.begin();
+
+	configs.push_back(sc);
+	return configs.size() - 1;
+}
+
+size_t ProgramCompiler::Emit(Program::Opcode op, Reg dst, Reg a, Reg b, Reg c, uint32_t x) {
+	Program::Instruction i = { op, dst, a, b, c, x };
+	m_program->m_code.push_back(i);
+	return m_program->m_code.size() - 1;
+}
+
+void ProgramCompiler::Finish() {
+	Emit(Program::END, 0);
+
+	size_t vars_count = m_program->m_vars_count;
+	size_t constants_count = m_program->m_constants.size();
+	m_program->m_registers_count = vars_count + constants_count + m_max_temps;
+
+	for (size_t i = 0; i < m_program->m_code.size(); i++) {
+		Program::Instruction& ins = m_program->m_code[i];
+		Reg* regs[] = { &ins.dst, &ins.a, &ins.b, &ins.c };
+		for (size_t j = 0; j < sizeof(regs) / sizeof(regs[0]); j++) {
+			if (*regs[j] & CONST_REG)
+				*regs[j] = vars_count + (*regs[j] & ~CONST_REG);
+			else if (*regs[j] & TEMP_REG)
+				*regs[j] = vars_count + constants_count + (*regs[j] & ~TEMP_REG);
+		}
+	}
+
+	EliminateDeadStores();
+}
+
+void ProgramCompiler::EliminateDeadStores() {
+	std::vector<Program::Instruction>& code = m_program->m_code;
+
+	while (true) {
+		std::vector<bool> read(m_program->m_registers_count, false);
+		/* v is the param value */
+		read[0] = true;
+		for (size_t i = 0; i < code.size(); i++) {
+			const Program::Instruction& ins = code[i];
+			int n = ReadsCount(ins.op);
+			if (n > 0)
+				read[ins.a] = true;
+			if (n > 1)
+				read[ins.b] = true;
+			if (n > 2)
+				read[ins.c] = true;
+		}
+
+		/* param values are never dropped, fetching them affects fixed flag */
+		std::vector<size_t> index(code.size() + 1);
+		size_t kept = 0;
+		for (size_t i = 0; i < code.size(); i++) {
+			const Program::Instruction& ins = code[i];
+			index[i] = kept;
+			if (WritesDst(ins.op) && ins.op != Program::PARAM && !read[ins.dst])
+				continue;
+			if (ins.op == Program::JMP && ins.x == i + 1)
+				continue;
+			code[kept++] = ins;
+		}
+		index[code.size()] = kept;
+
+		if (kept == code.size())
+			break;
+
+		code.resize(kept);
+		for (size_t i = 0; i < code.size(); i++)
+			if (IsJump(code[i].op))
+				code[i].x = index[code[i].x];
+	}
+}
+
+void Program::InitRegisters(std::vector<Val>& regs) const {
+	regs.resize(m_registers_count);
+	std::copy(m_constants.begin(), m_constants.end(), regs.begin() + m_vars_count);
+}
+
+void Program::Execute(Val* r, ExecutionEngine* ee) const {
+	const Instruction* code = &m_code[0];
+	const Instruction* i = code;
+	while (true) {
+		switch (i->op) {
+			case MOVE:
+				r[i->dst] = r[i->a];
+				break;
+			case BOOL:
+				r[i->dst] = bool(r[i->a]);
+				break;
+			case NOT:
+				r[i->dst] = !r[i->a];
+				break;
+			case NEG:
+				r[i->dst] = -r[i->a];
+				break;
+			case ISNAN:
+				r[i->dst] = std::isnan(r[i->a]);
+				break;
+			case ADD:
+				r[i->dst] = r[i->a] + r[i->b];
+				break;
+			case SUB:
+				r[i->dst] = r[i->a] - r[i->b];
+				break;
+			case MUL:
+				r[i->dst] = r[i->a] * r[i->b];
+				break;
+			case DIV:
+				r[i->dst] = r[i->a] / r[i->b];
+				break;
+			case MOD:
+				r[i->dst] = int(r[i->a]) % int(r[i->b]);
+				break;
+			case POW:
+				r[i->dst] = pow(r[i->a], r[i->b]);
+				break;
+			case LT:
+				r[i->dst] = r[i->a] < r[i->b];
+				break;
+			case LE:
+				r[i->dst] = r[i->a] <= r[i->b];
+				break;
+			case EQ:
+				r[i->dst] = r[i->a] == r[i->b];
+				break;
+			case GE:
+				r[i->dst] = r[i->a] >= r[i->b];
+				break;
+			case GT:
+				r[i->dst] = r[i->a] > r[i->b];
+				break;
+			case NE:
+				r[i->dst] = r[i->a] != r[i->b];
+				break;
+			case IN_SEASON: {
+				time_t t = r[i->a];
+				r[i->dst] = m_configs[i->x]->GetSeasons()->IsSummerSeason(t);
+				break;
+			}
+			case PARAM:
+				r[i->dst] = ee->Value(i->x, r[i->a], r[i->b]);
+				break;
+			case MOVE_TIME:
+				r[i->dst] = szb_move_time(r[i->a], r[i->b], SZARP_PROBE_TYPE(r[i->c]), 0);
+				break;
+			case ROUND_TIME:
+				r[i->dst] = szb_round_time(r[i->a], SZARP_PROBE_TYPE(r[i->b]));
+				break;
+			case JMP:
+				i = code + i->x;
+				continue;
+			case JMP_IF:
+				if (r[i->a]) {
+					i = code + i->x;
+					continue;
+				}
+				break;
+			case JMP_IF_NOT:
+				if (!r[i->a]) {
+					i = code + i->x;
+					continue;
+				}
+				break;
+			case FOR_TEST: {
+				const Val& var = r[i->a];
+				const Val& limit = r[i->b];
+				const Val& step = r[i->c];
+				if (!((step > 0 && var <= limit) || (step <= 0 && var >= limit))) {
+					i = code + i->x;
+					continue;
+				}
+				break;
+			}
+			case END:
+				return;
+		}
+		i++;
+	}
+}
+
 }
 
 #include "szarp_base_common/lua_param_optimizer_templ.h"
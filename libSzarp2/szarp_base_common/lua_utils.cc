@@ -65,6 +65,13 @@ bool prepare_param(lua_State *lua, TParam* param) {
 }
 
 int compile_lua_param(lua_State *lua, TParam *p) {
+	int lua_function_reference = compile_lua_function(lua, p);
+	p->SetLuaParamRef(lua_function_reference);
+	return lua_function_reference;
+
+}
+
+int compile_lua_function(lua_State *lua, TParam *p) {
 	int lua_function_reference = LUA_NOREF;
 	if (compile_lua_formula(lua, (const char*) p->GetLuaScript(), (const char*)SC::S2U(p->GetName()).c_str(), true))
 		lua_function_reference = luaL_ref(lua, LUA_REGISTRYINDEX);
@@ -72,9 +79,7 @@ int compile_lua_param(lua_State *lua, TParam *p) {
 		sz_log(1, "Error compiling param %ls: %s\n", p->GetName().c_str(), lua_tostring(lua, -1));
 		lua_function_reference = LUA_REFNIL;
 	}
-	p->SetLuaParamRef(lua_function_reference);
 	return lua_function_reference;
-
 }
 
 bool compile_lua_formula(lua_State *lua, const char *formula, const char *formula_name, bool ret_v_val) {
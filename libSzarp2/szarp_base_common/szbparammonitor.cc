@@ -26,9 +26,12 @@
 #include <sys/socket.h>
 #include <sys/inotify.h>
 #include <sys/poll.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include <vector>
+#include <algorithm>
 #include <stdexcept>
 
 #include <boost/bind.hpp>
@@ -98,6 +101,172 @@ SzbParamMonitorImpl::SzbParamMonitorImpl(SzbParamMonitor* monitor, const std::st
 }
 
 
+namespace {
+
+bool is_data_file(const char* name, size_t l) {
+	return l > 4 && name[l - 4] == '.' && name[l - 3] == 's' && name[l - 2] == 'z'
+		&& (name[l - 1] == '4' || name[l - 1] == 'b');
+}
+
+}
+
+SzbParamMonitorImpl::change_journal* SzbParamMonitorImpl::find_journal(const std::string& path, std::string& relative_path) {
+	std::string dir_string = boost::filesystem::absolute(path).string();
+	while (dir_string.size() > 1 && dir_string[dir_string.size() - 1] == '/')
+		dir_string.erase(dir_string.size() - 1);
+
+	for (boost::filesystem::path p = boost::filesystem::path(dir_string).parent_path(); !p.empty(); p = p.parent_path()) {
+		std::string p_string = p.string();
+
+		auto i = m_journal_dirs.find(p_string);
+		if (i == m_journal_dirs.end())
+			i = m_journal_dirs.insert(std::make_pair(p_string,
+					boost::filesystem::exists(p / SZB_CHANGE_JOURNAL))).first;
+
+		if (i->second && dir_string.size() > p_string.size() + 1) {
+			relative_path = dir_string.substr(p_string.size() + (p_string[p_string.size() - 1] == '/' ? 0 : 1));
+
+			auto j = m_journals.find(p_string);
+			if (j != m_journals.end())
+				return &j->second;
+
+			change_journal* journal = &m_journals[p_string];
+			journal->dir = p_string;
+			if (open_journal(journal, true)) {
+				int wd = inotify_add_watch(m_inotify_socket, p_string.c_str(),
+						IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM);
+				if (wd >= 0) {
+					m_journal_watches[wd] = journal;
+					return journal;
+				}
+				sz_log(3, "Failed to add watch for change journal in:%s, errno: %d", p_string.c_str(), errno);
+				close(journal->fd);
+			}
+
+			m_journals.erase(p_string);
+			i->second = false;
+			return NULL;
+		}
+
+		if (p == p.root_path())
+			break;
+	}
+
+	return NULL;
+}
+
+bool SzbParamMonitorImpl::open_journal(change_journal* journal, bool from_end) {
+	std::string path = journal->dir + "/" SZB_CHANGE_JOURNAL;
+
+	journal->fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (journal->fd == -1) {
+		sz_log(3, "Failed to open change journal:%s, errno: %d", path.c_str(), errno);
+		return false;
+	}
+
+	if (from_end)
+		lseek(journal->fd, 0, SEEK_END);
+	journal->pending.clear();
+
+	return true;
+}
+
+void SzbParamMonitorImpl::read_journal(change_journal* journal, std::vector<std::pair<SzbMonitorTokenType, std::string> >& tokens_and_paths) {
+	char buf[8192];
+
+	while (true) {
+		ssize_t r = read(journal->fd, buf, sizeof(buf));
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			break;
+
+		journal->pending.append(buf, r);
+	}
+
+	size_t start = 0;
+	size_t end;
+	while ((end = journal->pending.find('\n', start)) != std::string::npos) {
+		size_t space = journal->pending.rfind(' ', end);
+		size_t slash = journal->pending.rfind('/', end);
+		if (space != std::string::npos && space >= start
+				&& slash != std::string::npos && slash > start && slash < space
+				&& is_data_file(journal->pending.data() + slash + 1, space - slash - 1)) {
+			auto i = journal->dirs.find(journal->pending.substr(start, slash - start));
+			if (i != journal->dirs.end()) {
+				std::pair<SzbMonitorTokenType, std::string> tp(i->second, journal->pending.substr(slash + 1, space - slash - 1));
+				if (std::find(tokens_and_paths.begin(), tokens_and_paths.end(), tp) == tokens_and_paths.end())
+					tokens_and_paths.push_back(tp);
+			}
+		}
+		start = end + 1;
+	}
+	journal->pending.erase(0, start);
+}
+
+bool SzbParamMonitorImpl::add_journal_dir(const std::string& path, TParam* param, SzbParamObserver* observer, unsigned order) {
+	std::string relative_path;
+	change_journal* journal = find_journal(path, relative_path);
+	if (!journal)
+		return false;
+
+	SzbMonitorTokenType token = m_journal_token--;
+	journal->dirs[relative_path] = token;
+	m_journal_tokens[token] = std::make_pair(journal, relative_path);
+
+	m_monitor->dir_registered(token, param, observer, path, order);
+	return true;
+}
+
+void SzbParamMonitorImpl::del_journal_dir(SzbMonitorTokenType token) {
+	auto i = m_journal_tokens.find(token);
+	if (i == m_journal_tokens.end())
+		return;
+
+	i->second.first->dirs.erase(i->second.second);
+	m_journal_tokens.erase(i);
+}
+
+int SzbParamMonitorImpl::add_dir_watch(const std::string& path) {
+	if (boost::filesystem::exists(path))
+		return inotify_add_watch(m_inotify_socket, path.c_str(), IN_MOVED_TO | IN_MODIFY);
+
+	boost::filesystem::path dest_dir = boost::filesystem::absolute(path);
+	boost::filesystem::path current_watch = dest_dir;
+
+	while (!boost::filesystem::exists(current_watch)) {
+		current_watch = current_watch.parent_path();
+	}
+
+	if (dest_dir == current_watch)
+		return inotify_add_watch(m_inotify_socket, path.c_str(), IN_MOVED_TO | IN_MODIFY);
+	else
+		return inotify_add_watch(m_inotify_socket, current_watch.native().c_str(), IN_CREATE);
+}
+
+void SzbParamMonitorImpl::drop_journal(int journal_wd) {
+	change_journal* journal = m_journal_watches[journal_wd];
+	sz_log(3, "Change journal in %s removed, watching its dirs directly", journal->dir.c_str());
+
+	for (auto& dir : journal->dirs) {
+		std::string path = m_monitor->m_token_path[dir.second];
+		int wd = add_dir_watch(path);
+		if (wd < 0)
+			sz_log(3, "Failed to add watch for path:%s, errno: %d", path.c_str(), errno);
+		else
+			m_monitor->modify_dir_token(dir.second, wd);
+		m_journal_tokens.erase(dir.second);
+	}
+
+	close(journal->fd);
+	if (inotify_rm_watch(m_inotify_socket, journal_wd))
+		sz_log(3, "Failed to remove watch, errno: %d", errno);
+	m_journal_watches.erase(journal_wd);
+
+	m_journal_dirs[journal->dir] = false;
+	m_journals.erase(journal->dir);
+}
+
 void SzbParamMonitorImpl::process_notification() {
 	char buf[sizeof(inotify_event) + PATH_MAX + 1];
 	std::vector<std::pair<SzbMonitorTokenType, std::string> > tokens_and_paths;
@@ -116,10 +285,28 @@ void SzbParamMonitorImpl::process_notification() {
 		ssize_t p = 0;
 		while (r > 0) {
 			struct inotify_event* e = (struct inotify_event*) (buf + p);
-			if ((e->mask & (IN_MODIFY | IN_MOVED_TO)) && e->len) {
-				size_t l = strlen(e->name);
-				if (l > 4 && e->name[l - 4] == '.' && e->name[l - 3] == 's' && e->name[l - 2] == 'z'
-						&& (e->name[l - 1] == '4' || e->name[l - 1] == 'b'))
+			auto journal = m_journal_watches.find(e->wd);
+			if (journal != m_journal_watches.end()) {
+				if (e->len && !strcmp(e->name, SZB_CHANGE_JOURNAL)) {
+					read_journal(journal->second, tokens_and_paths);
+					/* writer stopped keeping the journal, it is replaced by watches
+					 * on its dirs, changes read so far are passed on before their
+					 * tokens change */
+					if ((e->mask & (IN_DELETE | IN_MOVED_FROM))
+							&& !boost::filesystem::exists(journal->second->dir + "/" SZB_CHANGE_JOURNAL)) {
+						if (tokens_and_paths.size())
+							m_monitor->files_changed(tokens_and_paths);
+						tokens_and_paths.clear();
+						drop_journal(e->wd);
+					/* journal was rotated, old one is drained, new one is read from the start */
+					} else if (e->mask & (IN_CREATE | IN_MOVED_TO)) {
+						close(journal->second->fd);
+						if (open_journal(journal->second, false))
+							read_journal(journal->second, tokens_and_paths);
+					}
+				}
+			} else if ((e->mask & (IN_MODIFY | IN_MOVED_TO)) && e->len) {
+				if (is_data_file(e->name, strlen(e->name)))
 					tokens_and_paths.push_back(std::make_pair(SzbMonitorTokenType(e->wd), std::string(e->name)));
 			} else if ((e->mask & IN_CREATE) && e->len) {
 				auto it = m_monitor->m_token_path.find(e->wd);
@@ -146,7 +333,7 @@ void SzbParamMonitorImpl::process_notification() {
 						m_monitor->modify_dir_token(e->wd, new_wd);
 					}
 				} else {
-					sz_log(3, "No entries for given token (path: %s), something is wrong!", it->second.c_str());
+					sz_log(3, "No entries for given token (file: %s), something is wrong!", e->name);
 				}
 			}
 			r -= sizeof(*e) + e->len;
@@ -181,22 +368,10 @@ void SzbParamMonitorImpl::process_cmds() {
 
 			switch (cmd.cmd) {
 				case ADD_CMD:
-					if (boost::filesystem::exists(cmd.path)) {
-						wd = inotify_add_watch(m_inotify_socket, cmd.path.c_str(), IN_MOVED_TO | IN_MODIFY);
-					} else {
-						boost::filesystem::path dest_dir = boost::filesystem::absolute(cmd.path);;
-						boost::filesystem::path current_watch = dest_dir;
-
-						while (!boost::filesystem::exists(current_watch)) {
-							current_watch = current_watch.parent_path();
-						}
-
-						if (dest_dir == current_watch) {
-							wd = inotify_add_watch(m_inotify_socket, cmd.path.c_str(), IN_MOVED_TO | IN_MODIFY);
-						} else {
-							wd = inotify_add_watch(m_inotify_socket, current_watch.native().c_str(), IN_CREATE);
-						}
-					}
+					if (add_journal_dir(cmd.path, cmd.param, cmd.observer, cmd.order))
+						break;
+
+					wd = add_dir_watch(cmd.path);
 					if (wd < 0) {
 						sz_log(3, "Failed to add watch for path:%s, errno: %d", cmd.path.c_str(), errno);
 						m_monitor->failed_to_register_dir(cmd.param, cmd.observer, cmd.path);
@@ -204,11 +379,15 @@ void SzbParamMonitorImpl::process_cmds() {
 						m_monitor->dir_registered(wd, cmd.param, cmd.observer, cmd.path, cmd.order);
 					break;
 				case DEL_CMD:
-					if (inotify_rm_watch(m_inotify_socket, cmd.token))
+					if (cmd.token < 0)
+						del_journal_dir(cmd.token);
+					else if (inotify_rm_watch(m_inotify_socket, cmd.token))
 						sz_log(3, "Failed to remove watch, errno: %d", errno);
 					break;
 				case END_CMD:
 					m_terminate = true;
+					for (auto& journal : m_journals)
+						close(journal.second.fd);
 					close(m_inotify_socket);
 					close(m_cmd_socket[0]);
 					close(m_cmd_socket[1]);
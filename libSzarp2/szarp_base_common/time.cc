@@ -1,15 +1,225 @@
 #include "config.h" 
 
 #include <string.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include "szarp_base_common/time.h" 
 
+namespace {
+
+const time_t DAY_SECONDS = 24 * 3600;
+
+/* days since 1970-01-01 for given proleptic gregorian date, month in 1..12 */
+long long days_from_civil(long long y, unsigned m, unsigned d)
+{
+	y -= m <= 2;
+	long long era = (y >= 0 ? y : y - 399) / 400;
+	unsigned yoe = unsigned(y - era * 400);
+	unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + (long long)doe - 719468;
+}
+
+void civil_from_days(long long z, long long& y, unsigned& m, unsigned& d)
+{
+	z += 719468;
+	long long era = (z >= 0 ? z : z - 146096) / 146097;
+	unsigned doe = unsigned(z - era * 146097);
+	unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	unsigned mp = (5 * doy + 2) / 153;
+	d = doy - (153 * mp + 2) / 5 + 1;
+	m = mp < 10 ? mp + 3 : mp - 9;
+	y = (long long)yoe + era * 400 + (m <= 2);
+}
+
+long long floor_div(long long a, long long b)
+{
+	return a / b - (a % b < 0);
+}
+
+void libc_local_time(time_t t, struct tm& tm)
+{
+#ifndef HAVE_LOCALTIME_R
+	struct tm *ptm = localtime(&t);
+	memcpy(&tm, ptm, sizeof(struct tm));
+#else
+	localtime_r(&t, &tm);
+#endif
+}
+
+/** Local time offsets of the process time zone, with their transitions
+ * (DST changes) found once by probing libc. Lets local calendar arithmetic
+ * be done without localtime/mktime calls, which serialize on the libc
+ * time zone lock. Times outside of covered range are left for libc. */
+class local_calendar {
+	/** m_offsets[i] is in effect from m_transitions[i - 1] up to m_transitions[i] */
+	std::vector<time_t> m_transitions;
+	std::vector<long> m_offsets;
+	time_t m_begin;
+	time_t m_end;
+
+	long libc_offset(time_t t) const {
+		struct tm tm;
+		libc_local_time(t, tm);
+		long long local = days_from_civil(tm.tm_year + 1900LL, tm.tm_mon + 1, tm.tm_mday) * DAY_SECONDS
+			+ tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+		return long(local - t);
+	}
+
+	long offset(time_t t) const {
+		size_t i = std::upper_bound(m_transitions.begin(), m_transitions.end(), t) - m_transitions.begin();
+		return m_offsets[i];
+	}
+
+	bool covers(long long t) const {
+		return t >= m_begin + 2 * DAY_SECONDS && t < m_end - 2 * DAY_SECONDS;
+	}
+public:
+	local_calendar() {
+		/* 2100-01-01, or end of 32-bit time_t range */
+		m_begin = 0;
+		m_end = sizeof(time_t) > 4 ? time_t(4102444800LL) : time_t(2145916800LL);
+
+		long current = libc_offset(m_begin);
+		m_offsets.push_back(current);
+		for (time_t t = m_begin + DAY_SECONDS; t < m_end; t += DAY_SECONDS) {
+			long o = libc_offset(t);
+			if (o == current)
+				continue;
+
+			time_t l = t - DAY_SECONDS, r = t;
+			while (r - l > 1) {
+				time_t m = l + (r - l) / 2;
+				if (libc_offset(m) == current)
+					l = m;
+				else
+					r = m;
+			}
+
+			m_transitions.push_back(r);
+			m_offsets.push_back(o);
+			current = o;
+		}
+	}
+
+	/** Breaks time down to local calendar fields (without tm_yday and tm_isdst),
+	 * @return false if time is not covered by the table */
+	bool local_time(time_t t, struct tm& tm) const {
+		if (!covers(t))
+			return false;
+
+		long long local = (long long)t + offset(t);
+		long long days = floor_div(local, DAY_SECONDS);
+		long long secs = local - days * DAY_SECONDS;
+
+		long long y;
+		unsigned m, d;
+		civil_from_days(days, y, m, d);
+
+		memset(&tm, 0, sizeof(tm));
+		tm.tm_year = int(y - 1900);
+		tm.tm_mon = m - 1;
+		tm.tm_mday = d;
+		tm.tm_hour = int(secs / 3600);
+		tm.tm_min = int(secs / 60 % 60);
+		tm.tm_sec = int(secs % 60);
+		/* 1970-01-01 was Thursday */
+		tm.tm_wday = int(((days + 4) % 7 + 7) % 7);
+		tm.tm_isdst = -1;
+		return true;
+	}
+
+	/** Converts (possibly denormalized) local time fields to time, same as
+	 * mktime with tm_isdst set to -1. Fields of tm are not modified.
+	 * @return false if local time falls into a DST gap or overlap or is not
+	 * covered by the table, those are left for mktime */
+	bool make_time(const struct tm& tm, time_t& t) const {
+		long long months = tm.tm_year * 12LL + tm.tm_mon;
+		long long year = floor_div(months, 12) + 1900;
+		unsigned month = unsigned(months - floor_div(months, 12) * 12) + 1;
+
+		long long local = (days_from_civil(year, month, 1) + tm.tm_mday - 1) * DAY_SECONDS
+			+ tm.tm_hour * 3600LL + tm.tm_min * 60LL + tm.tm_sec;
+		if (!covers(local))
+			return false;
+
+		long candidates[3] = { offset(local - 2 * DAY_SECONDS), offset(local), offset(local + 2 * DAY_SECONDS) };
+		bool found = false;
+		for (size_t i = 0; i < 3; i++) {
+			long long r = local - candidates[i];
+			if (offset(r) != candidates[i])
+				continue;
+			if (found && r != t)
+				return false;
+			t = time_t(r);
+			found = true;
+		}
+
+		return found;
+	}
+
+};
+
+boost::mutex calendars_lock;
+/* tables are never freed, callers may still use the previous one */
+std::vector<std::unique_ptr<local_calendar> > calendars;
+std::atomic<const local_calendar*> current_calendar(nullptr);
+
+const local_calendar* build_calendar(bool rebuild)
+{
+	boost::lock_guard<boost::mutex> lock(calendars_lock);
+	const local_calendar* c = current_calendar.load(std::memory_order_acquire);
+	if (c && !rebuild)
+		return c;
+
+	calendars.emplace_back(new local_calendar());
+	c = calendars.back().get();
+	current_calendar.store(c, std::memory_order_release);
+	return c;
+}
+
+const local_calendar& calendar()
+{
+	const local_calendar* c = current_calendar.load(std::memory_order_acquire);
+	if (!c)
+		c = build_calendar(false);
+	return *c;
+}
+
+void local_time(time_t t, struct tm& tm)
+{
+	if (!calendar().local_time(t, tm))
+		libc_local_time(t, tm);
+}
+
+time_t make_time(struct tm& tm)
+{
+	time_t t;
+	if (calendar().make_time(tm, t))
+		return t;
+
+	tm.tm_isdst = -1;
+	return mktime(&tm);
+}
+
+}
+
+void szb_time_zone_changed()
+{
+	build_calendar(true);
+}
+
 time_t
 szb_move_time(time_t t, int count, SZARP_PROBE_TYPE probe_type, int custom_length)
 {
 	struct tm tm;
-#ifndef HAVE_LOCALTIME_R
-	struct tm *ptm;
-#endif
 	if (t == -1)
 		return -1;
 	if ( (probe_type == PT_CUSTOM) && (custom_length <= 0) )
@@ -30,55 +240,25 @@ szb_move_time(time_t t, int count, SZARP_PROBE_TYPE probe_type, int custom_lengt
 		case PT_HOUR :
 			return (t + (count * 3600));
 		case PT_HOUR8 :
-#ifndef HAVE_LOCALTIME_R
-			ptm = localtime(&t);
-			memcpy(&tm, ptm, sizeof(struct tm));
-#else
-			localtime_r(&t, &tm);
-#endif
+			local_time(t, tm);
 			tm.tm_hour += count * 8;
-			tm.tm_isdst = -1;
-			return mktime(&tm);
+			return make_time(tm);
 		case PT_DAY :
-#ifndef HAVE_LOCALTIME_R
-			ptm = localtime(&t);
-			memcpy(&tm, ptm, sizeof(struct tm));
-#else
-			localtime_r(&t, &tm);
-#endif
+			local_time(t, tm);
 			tm.tm_mday += count;
-			tm.tm_isdst = -1;
-			return mktime(&tm);
+			return make_time(tm);
 		case PT_WEEK :
-#ifndef HAVE_LOCALTIME_R
-			ptm = localtime(&t);
-			memcpy(&tm, ptm, sizeof(struct tm));
-#else
-			localtime_r(&t, &tm);
-#endif
+			local_time(t, tm);
 			tm.tm_mday += count * 7;
-			tm.tm_isdst = -1;
-			return mktime(&tm);
+			return make_time(tm);
 		case PT_MONTH :
-#ifndef HAVE_LOCALTIME_R
-			ptm = localtime(&t);
-			memcpy(&tm, ptm, sizeof(struct tm));
-#else
-			localtime_r(&t, &tm);
-#endif
+			local_time(t, tm);
 			tm.tm_mon += count;
-			tm.tm_isdst = -1;
-			return mktime(&tm);
+			return make_time(tm);
 		case PT_YEAR :
-#ifndef HAVE_LOCALTIME_R
-			ptm = localtime(&t);
-			memcpy(&tm, ptm, sizeof(struct tm));
-#else
-			localtime_r(&t, &tm);
-#endif
+			local_time(t, tm);
 			tm.tm_year += count;
-			tm.tm_isdst = -1;
-			return mktime(&tm);
+			return make_time(tm);
 		default:
 			break;
 	}
@@ -88,9 +268,6 @@ szb_move_time(time_t t, int count, SZARP_PROBE_TYPE probe_type, int custom_lengt
 time_t szb_round_time(time_t t, SZARP_PROBE_TYPE probe_type, int custom_length)
 {
 	struct tm tm;
-#ifndef HAVE_LOCALTIME_R
-	struct tm *ptm;
-#endif
 	
 	if (t == -1)
 		return -1;
@@ -111,61 +288,30 @@ time_t szb_round_time(time_t t, SZARP_PROBE_TYPE probe_type, int custom_length)
 		case PT_HOUR :
 			return (t - (t % 3600));
 		case PT_HOUR8 :
-#ifndef HAVE_LOCALTIME_R
-			ptm = localtime(&t);
-			memcpy(&tm, ptm, sizeof(struct tm));
-#else
-			localtime_r(&t, &tm);
-#endif
+			local_time(t, tm);
 			tm.tm_sec = tm.tm_min = 0;
 			tm.tm_hour -= tm.tm_hour % 8;
-			tm.tm_isdst = -1;
-			return mktime(&tm);
+			return make_time(tm);
 		case PT_DAY :
-#ifndef HAVE_LOCALTIME_R
-			ptm = localtime(&t);
-			memcpy(&tm, ptm, sizeof(struct tm));
-#else
-			localtime_r(&t, &tm);
-#endif
+			local_time(t, tm);
 			tm.tm_sec = tm.tm_min = tm.tm_hour = 0;
-			tm.tm_isdst = -1;
-			return mktime(&tm);
+			return make_time(tm);
 		case PT_WEEK :
-#ifndef HAVE_LOCALTIME_R
-			ptm = localtime(&t);
-			memcpy(&tm, ptm, sizeof(struct tm));
-#else
-			localtime_r(&t, &tm);
-#endif
+			local_time(t, tm);
 			tm.tm_sec = tm.tm_min = tm.tm_hour = 0;
 			tm.tm_mday += tm.tm_wday - 1;
-			tm.tm_isdst = -1;
-			return mktime(&tm);
+			return make_time(tm);
 		case PT_MONTH :
-#ifndef HAVE_LOCALTIME_R
-			ptm = localtime(&t);
-			memcpy(&tm, ptm, sizeof(struct tm));
-#else
-			localtime_r(&t, &tm);
-#endif
+			local_time(t, tm);
 			tm.tm_sec = tm.tm_min = tm.tm_hour = 0;
 			tm.tm_mday = 1;
-			tm.tm_isdst = -1;
-			return mktime(&tm);
+			return make_time(tm);
 		case PT_YEAR :
-#ifndef HAVE_LOCALTIME_R
-			ptm = localtime(&t);
-			memcpy(&tm, ptm, sizeof(struct tm));
-#else
-			localtime_r(&t, &tm);
-#endif
+			local_time(t, tm);
 			tm.tm_sec = tm.tm_min = tm.tm_hour = 0;
 			tm.tm_mday = 1;
 			tm.tm_mon = 1;
-			tm.tm_isdst = -1;
-			return mktime(&tm);
+			return make_time(tm);
 	}
 	return -1;
 }
-
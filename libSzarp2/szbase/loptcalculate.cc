@@ -47,7 +47,6 @@ SzbaseExecutionEngine::SzbaseExecutionEngine(szb_buffer_t *buffer, Param *param)
 	m_param = param;
 	Szbase* szbase = Szbase::GetObject();
 	for (size_t i = 0; i < m_param->m_par_refs.size(); i++) {
-		m_param->m_par_refs[i].PushExecutionEngine(this);
 		m_buffers.push_back(szbase->GetBufferForParam(m_param->m_par_refs[i].m_param));
 	}
 	m_blocks.resize(UNUSED_BLOCK_TYPE);
@@ -56,9 +55,7 @@ SzbaseExecutionEngine::SzbaseExecutionEngine(szb_buffer_t *buffer, Param *param)
 		m_blocks[i].resize(m_param->m_par_refs.size());
 		m_blocks_iterators[i].resize(m_param->m_par_refs.size());
 	}
-	m_vals.resize(m_param->m_vars.size());
-	for (size_t i = 0; i < m_vals.size(); i++)
-		m_param->m_vars[i].PushExecutionEngine(this);
+	m_param->m_program.InitRegisters(m_vals);
 	m_vals[3] = PT_MIN10;
 	m_vals[4] = PT_HOUR;
 	m_vals[5] = PT_HOUR8;
@@ -73,7 +70,7 @@ void SzbaseExecutionEngine::CalculateValue(time_t t, SZARP_PROBE_TYPE probe_type
 	m_vals[0] = nan("");
 	m_vals[1] = t;
 	m_vals[2] = probe_type;
-	m_param->m_statement->Execute();
+	m_param->m_program.Execute(&m_vals[0], this);
 	fixed = m_fixed;
 	val = m_vals[0];
 }
@@ -233,10 +230,6 @@ std::vector<double>& SzbaseExecutionEngine::Vars() {
 
 SzbaseExecutionEngine::~SzbaseExecutionEngine() {
 	szb_unlock_buffer(m_buffer);
-	for (size_t i = 0; i < m_param->m_par_refs.size(); i++)
-		m_param->m_par_refs[i].PopExecutionEngine();
-	for (size_t i = 0; i < m_vals.size(); i++)
-		m_param->m_vars[i].PopExecutionEngine();
 }
 
 Param* optimize_lua_param(TParam* p) {
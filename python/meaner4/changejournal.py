@@ -0,0 +1,126 @@
+"""
+  SZARP: SCADA software 
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+"""
+
+import os
+
+# must match SZB_CHANGE_JOURNAL in szbparammonitor.h
+JOURNAL_NAME = ".sz4changes"
+MAX_JOURNAL_SIZE = 16 * 1024 * 1024
+
+class ChangeJournal:
+	"""
+	Append-only journal of data files modifications, tailed by readers
+	(SzbParamMonitor) instead of watching every param directory. Changes are
+	collected and appended as "<param dir>/<file name> <file size>" lines on
+	flush, once the journal grows too large a new one is renamed over it, so
+	that readers never find it missing. With create set to False the journal
+	is only appended to if it exists, this is how tools other than meaner4
+	write to the base.
+	"""
+	def __init__(self, szbase_dir, create=True):
+		self.szbase_dir = szbase_dir
+		self.path = os.path.join(szbase_dir, JOURNAL_NAME)
+		self.changes = {}
+		self.create = create
+		self.fd = self.open()
+
+	def open(self):
+		flags = os.O_WRONLY | os.O_APPEND
+		if self.create:
+			flags |= os.O_CREAT
+		return os.open(self.path, flags, 0644)
+
+	def reopen_if_replaced(self):
+		"""
+		Journal might have been rotated or removed by other writer of the base,
+		returns False if there is no journal to write to
+		"""
+		try:
+			if os.path.samestat(os.stat(self.path), os.fstat(self.fd)):
+				return True
+		except OSError:
+			pass
+
+		try:
+			fd = self.open()
+		except OSError:
+			return False
+
+		os.close(self.fd)
+		self.fd = fd
+		return True
+
+	def record(self, path, size):
+		self.changes[os.path.relpath(path, self.szbase_dir)] = size
+
+	def flush(self):
+		if not self.changes:
+			return
+
+		data = "".join([ "%s %d\n" % (path, size) for path, size in self.changes.iteritems() ]).encode("utf-8")
+		self.changes = {}
+
+		if not self.reopen_if_replaced():
+			return
+
+		while data:
+			written = os.write(self.fd, data)
+			data = data[written:]
+
+		if os.fstat(self.fd).st_size > MAX_JOURNAL_SIZE:
+			self.rotate()
+
+	def rotate(self):
+		old_path = self.path + ".1"
+		new_path = "%s.%d" % (self.path, os.getpid())
+
+		try:
+			os.unlink(old_path)
+		except OSError:
+			pass
+		os.link(self.path, old_path)
+
+		fd = os.open(new_path, os.O_WRONLY | os.O_APPEND | os.O_CREAT | os.O_TRUNC, 0644)
+		os.rename(new_path, self.path)
+
+		os.close(self.fd)
+		self.fd = fd
+
+	def close(self):
+		self.flush()
+		os.close(self.fd)
+
+def existing_journal(szbase_dir):
+	"""
+	Returns journal of the base if its writer keeps one, None otherwise
+	"""
+	try:
+		return ChangeJournal(szbase_dir, create=False)
+	except OSError:
+		return None
+
+def remove_journal(szbase_dir):
+	"""
+	Removes journal left by previous run, so that readers do not rely on it
+	when journal is disabled
+	"""
+	try:
+		os.unlink(os.path.join(szbase_dir, JOURNAL_NAME))
+	except OSError:
+		pass
@@ -34,6 +34,7 @@ import os
 
 from heartbeat import heartbeat_param_name, create_hearbeat_param
 import saveparam
+import changejournal
 import parampath
 import lastentry
 import timedelta
@@ -126,11 +127,13 @@ class Converter:
 		del lastentry.LastEntry.get_time_delta
 		lastentry.LastEntry.get_time_delta = get_time_delta_cached
 
+		self.journal = changejournal.existing_journal(self.szbase_dir)
+
 		for p in self.ipk.params:
-			sp = saveparam.SaveParam(p, self.szbase_dir, FileFactory(), False)
+			sp = saveparam.SaveParam(p, self.szbase_dir, FileFactory(), False, journal=self.journal)
 			self.s_params[p.param_name] = sp
 	
-		self.s_params[heartbeat_param_name] = saveparam.SaveParam(create_hearbeat_param(), self.szbase_dir, FileFactory())
+		self.s_params[heartbeat_param_name] = saveparam.SaveParam(create_hearbeat_param(), self.szbase_dir, FileFactory(), journal=self.journal)
 
 		self.queue = queue
 
@@ -260,6 +263,9 @@ class Converter:
 			sp = self.s_params[pname]
 			try:
 				self.convert_param(sp, pname, pno)
+				# files are written out on close, so changes are flushed after
+				if self.journal is not None:
+					self.journal.flush()
 			except OSError, e:
 				syslog.syslog(syslog.LOG_ERR | syslog.LOG_USER, str(e))	
 
@@ -267,6 +273,8 @@ class Converter:
 				pno = self.current.value
 				self.current.value += 1
 
+		if self.journal is not None:
+			self.journal.close()
 		self.queue.put((self.offset, None))
 
 def help():
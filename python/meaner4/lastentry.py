@@ -21,6 +21,7 @@
 import os
 import struct
 import timedelta
+import valuecodec
 
 class TimeError(Exception):
 	def __init__(self, current_time, msg_time):
@@ -32,6 +33,7 @@ class LastEntry:
 	def __init__(self, param):
 		self.param = param
 		self.delta_cache = {}
+		self.codec = None
 
 	def time_to_int(self, time, nanotime):
 		if self.param.time_prec == 8:
@@ -40,11 +42,12 @@ class LastEntry:
 
 		return time
 
-	def reset(self, time, nanotime, value = None):
+	def reset(self, time, nanotime, value = None, value_size = 0):
 		self.time_size = 0
 		self.time = self.time_to_int(time, nanotime)
 		self.value_start_time = self.time
 		self.value = value 
+		self.value_size = value_size
 
 	def get_time_delta(self, time_from, time_to):
 		diff = time_to - time_from
@@ -69,8 +72,8 @@ class LastEntry:
 		delta, self.time_size = timedelta.decode(file)
 		self.time += delta
 
-	def new_value(self, time, nanotime, value):
-		self.reset(time, nanotime, value)
+	def new_value(self, time, nanotime, value, value_size):
+		self.reset(time, nanotime, value, value_size)
 
 	def from_file(self, file, time, nanotime):
 		self.reset(time, nanotime)
@@ -79,11 +82,14 @@ class LastEntry:
 		file_size = file.tell()
 		file.seek(0, 0)
 
-		pos = 0
+		self.codec = valuecodec.from_file(file, self.param)
+		if self.codec is None:
+			return
+
+		pos = file.tell()
 		while file.tell() < file_size:
-			binary = file.read(self.param.value_lenght)
 			try:
-				self.value = self.param.value_from_binary(binary)
+				self.value, self.value_size = self.codec.decode(file)
 			except:
 				file.truncate(pos)	
 				break
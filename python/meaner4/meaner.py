@@ -25,6 +25,7 @@ import lxml.etree
 import paramsvalues_pb2
 import param
 import saveparam
+import changejournal
 import logging
 from logging.handlers import SysLogHandler
 import sys
@@ -37,8 +38,12 @@ NON_FIRST_HEART_BEAT = 1
 force_interrupt = False
 
 class Meaner(MeanerBase):
-	def __init__(self, path, uri, heartbeat, interval):
-		MeanerBase.__init__(self, path)
+	def __init__(self, path, uri, heartbeat, interval, journal=False, compress=False):
+		if journal:
+			MeanerBase.__init__(self, path, changejournal.ChangeJournal(path), compress)
+		else:
+			changejournal.remove_journal(path)
+			MeanerBase.__init__(self, path, compress=compress)
 
 		self.hub_uri = uri
 
@@ -53,8 +58,8 @@ class Meaner(MeanerBase):
 		self.saving_interval = interval
 		self.saving_time = 0
 
-		self.heartbeat_param = saveparam.SaveParam(create_hearbeat_param(), self.szbase_path)
-		self.meaner4_heartbeat_param = saveparam.SaveParam(create_meaner4_heartbeat_param(), self.szbase_path)
+		self.heartbeat_param = saveparam.SaveParam(create_hearbeat_param(), self.szbase_path, journal=self.journal)
+		self.meaner4_heartbeat_param = saveparam.SaveParam(create_meaner4_heartbeat_param(), self.szbase_path, journal=self.journal)
 
 		self.msgs = {}
 
@@ -70,6 +75,10 @@ class Meaner(MeanerBase):
 		self.msgs = {}
 		return latest_time
 
+	def flush_journal(self):
+		if self.journal is not None:
+			self.journal.flush()
+
 	def read_socket(self):
 		try:
 			while True:
@@ -93,6 +102,7 @@ class Meaner(MeanerBase):
 			saving_time = self.save_msgs()
 			if saving_time is not None:
 				self.heartbeat(saving_time)
+			self.flush_journal()
 			self.saving_time = current_time
 
 	def save_msgs(self):
@@ -114,6 +124,7 @@ class Meaner(MeanerBase):
 		value = 0 if self.last_heartbeat is None else 1
 		self.last_meaner4_heartbeat = int(time.time())
 		self.meaner4_heartbeat_param.process_value(value, self.last_meaner4_heartbeat)
+		self.flush_journal()
 
 	def loop(self):
 		while not force_interrupt:
@@ -137,6 +148,8 @@ class Meaner(MeanerBase):
 
 	def on_exit(self):
 		self.save_msgs()
+		if self.journal is not None:
+			self.journal.close()
 		self.socket.close()
 		self.context.term()
 		self.logger.info("cleanup finished, exiting")
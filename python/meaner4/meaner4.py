@@ -34,8 +34,10 @@ def go():
 	uri = lpr.get("parhub", "pub_conn_addr")
 	heartbeat = int(lpr.get("sz4", "heartbeat_frequency"))
 	interval = int(lpr.get("sz4", "saving_interval"))
+	journal = lpr.get("sz4", "change_journal") == "yes"
+	compress = lpr.get("sz4", "compress_values") == "yes"
 
-	m = meaner.Meaner(path, uri, heartbeat, interval)
+	m = meaner.Meaner(path, uri, heartbeat, interval, journal, compress)
 	m.configure(ipk)
 
 	m.run()
@@ -25,14 +25,16 @@ import saveparam
 from ipk import IPK
 
 class MeanerBase:
-	def __init__(self, path):
+	def __init__(self, path, journal=None, compress=False):
 		self.save_params = []
 
 		self.szbase_path = path
+		self.journal = journal
+		self.compress = compress
 
 	def configure(self, ipk_path):
 		self.ipk = IPK(ipk_path)
 
 		for p in self.ipk.params:
-			self.save_params.append(saveparam.SaveParam(p, self.szbase_path))
+			self.save_params.append(saveparam.SaveParam(p, self.szbase_path, journal=self.journal, compress=self.compress))
 
@@ -25,6 +25,7 @@ import config
 import param
 import parampath
 import lastentry
+import valuecodec
 import math
 from contextlib import contextmanager
 
@@ -62,7 +63,7 @@ class FileFactory:
 		return self.File(path, mode)
 
 class SaveParam:
-	def __init__(self, param, szbase_dir, file_factory=FileFactory(), lock=True):
+	def __init__(self, param, szbase_dir, file_factory=FileFactory(), lock=True, journal=None, compress=False):
 		self.param = param
 		self.param_path = parampath.ParamPath(self.param, szbase_dir)
 		self.file = None
@@ -70,6 +71,13 @@ class SaveParam:
 		self.file_factory = file_factory
 		self.last = lastentry.LastEntry(param)
 		self.lock = lock
+		self.journal = journal
+		self.file_path = None
+		self.codec_type = valuecodec.CompressedCodec if compress else valuecodec.RawCodec
+
+	def record_change(self):
+		if self.journal is not None and self.file is not None:
+			self.journal.record(self.file_path, self.file_size)
 
 	def update_last_time_unlocked(self, time, nanotime):
 		last_time_size = self.last.time_size
@@ -91,14 +99,25 @@ class SaveParam:
 			if self.lock:
 				self.file.unlock()
 			
+	def write_header(self):
+		self.last.codec = self.codec_type(self.param)
+		self.file.write(self.last.codec.header)
+		self.file_size = len(self.last.codec.header)
+
+	def open_new_file(self, time, nanotime):
+		path = self.param_path.create_file_path(time, nanotime)
+		self.file = self.file_factory.open(path, mode="w+b")
+		self.file_path = path
+		self.last.reset(time, nanotime)
+		self.write_header()
+
 	def ensure_room_for_new_value(self, time, nanotime):
-		if self.file_size + self.param.max_file_item_size > config.DATA_FILE_SIZE:
+		max_item_size = self.last.codec.max_value_size + self.param.time_prec + 1
+		if self.file_size + max_item_size > config.DATA_FILE_SIZE:
+			self.record_change()
 			self.file.close()
 
-			path = self.param_path.create_file_path(time, nanotime)
-			self.file = self.file_factory.open(path, mode="w+b")
-			self.last.reset(time, nanotime)
-			self.file_size = 0
+			self.open_new_file(time, nanotime)
 
 	def write_value(self, value, time, nanotime):
 		self.ensure_room_for_new_value(time, nanotime)
@@ -107,10 +126,11 @@ class SaveParam:
 			if self.lock:
 				self.file.lock()
 
-			self.file.write(self.param.value_to_binary(value))
-			self.file_size += self.param.value_lenght
+			blob = self.last.codec.encode(value)
+			self.file.write(blob)
+			self.file_size += len(blob)
 
-			self.last.new_value(time, nanotime, value)
+			self.last.new_value(time, nanotime, value, len(blob))
 		finally:
 			if self.lock:
 				self.file.unlock()
@@ -119,22 +139,21 @@ class SaveParam:
 		path = self.param_path.find_latest_path()	
 
 		if path is not None:
-			self.file_size = os.path.getsize(path)
 			self.file = self.file_factory.open(path, "r+b")
+			self.file_path = path
 
 			file_time, file_nanotime = self.param_path.time_from_path(path)
 			self.last.from_file(self.file, file_time, file_nanotime)
+			if self.last.codec is None:
+				self.write_header()
+			else:
+				self.file_size = os.path.getsize(path)
 		else:
-			self.file_size = 0
-
 			param_dir = self.param_path.param_dir()
 			if not os.path.exists(param_dir):
 				os.makedirs(param_dir)
 
-			path = self.param_path.create_file_path(time, nanotime)
-			self.file = self.file_factory.open(path, "w+b")
-
-			self.last.reset(time, nanotime)
+			self.open_new_file(time, nanotime)
 
 
 	def fill_no_data(self, time, nanotime):
@@ -145,13 +164,18 @@ class SaveParam:
 			if not self.param.isnan(self.last.value):
 				self.ensure_room_for_new_value(time, nanotime)
 
-				if self.file_size > 0 and self.last.time_size == 0:
+				if self.file_size > len(self.last.codec.header) and self.last.time_size == 0:
 					#overwrite value at the end that didn't have the duration	
-					#specified
-					self.file.seek(-self.param.value_lenght, os.SEEK_END)
+					#specified, encoded values differ in size so the file
+					#is truncated first
+					self.file.seek(-self.last.value_size, os.SEEK_END)
+					self.file.truncate(self.file.tell())
+					self.file_size -= self.last.value_size
+					self.last.codec.rewind()
 
-				self.file.write(self.param.value_to_binary(self.param.nan()))
-				self.file_size += self.param.value_lenght
+				blob = self.last.codec.encode(self.param.nan())
+				self.file.write(blob)
+				self.file_size += len(blob)
 
 				time_blob = self.last.get_time_delta_since_latest_time(time, nanotime)
 				self.file.write(time_blob)
@@ -186,6 +210,8 @@ class SaveParam:
 				if value != self.last.value:
 					self.write_value(value, time, nanotime)
 
+			self.record_change()
+
 		except lastentry.TimeError, e:
 			print "Ignoring value for param %s (with time:%s) as more recent value is present (time:%s)" \
 				% (self.param_path.param_path, e.msg_time, e.current_time)
@@ -215,6 +241,7 @@ class SaveParam:
 
 	def close(self):
 		if self.file:
+			self.record_change()
 			self.file.close()
 			self.file = None
 				
@@ -44,6 +44,7 @@ import time
 from datetime import datetime
 
 from meanerbase import MeanerBase
+import changejournal
 from ipk import IPK
 import unicodedata
 import argparse
@@ -52,7 +53,13 @@ import shlex
 
 class Sz4Writer(MeanerBase):
 	def __init__(self, path):
-		MeanerBase.__init__(self, path)
+		MeanerBase.__init__(self, path, changejournal.existing_journal(path))
+
+	def close(self):
+		for sp in self.save_params:
+			sp.close()
+		if self.journal is not None:
+			self.journal.close()
 
 	def configure(self, ipk_path):
 		MeanerBase.configure(self, ipk_path)
@@ -147,3 +154,5 @@ if __name__ == "__main__":
 		writer.process_file(args.input_file, "%Y-%m-%d %H:%M:%S" if args.time_format == None else args.time_format)
 	else:
 		print("Wrong input file format! Aborting !", file=sys.stderr)
+
+	writer.close()
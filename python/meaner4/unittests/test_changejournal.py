@@ -0,0 +1,122 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+"""
+  SZARP: SCADA software
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+"""
+
+import lxml
+import lxml.etree
+import os
+import tempfile
+import unittest
+import shutil
+
+import param
+import paramsvalues_pb2
+import saveparam
+import changejournal
+
+class ChangeJournalTest(unittest.TestCase):
+	def setUp(self):
+		self.node = lxml.etree.fromstring("""
+      <param name="Kocioł 3:Sterownik:Aktualne wysterowanie falownika podmuchu" short_name="imp_p" draw_name="Wyst. fal. podm." unit="%" prec="1" base_ind="auto" time_type="second" data_type="integer">
+      </param>
+""")
+		self.temp_dir = tempfile.mkdtemp(suffix="meaner4_unit_test")
+		self.journal_path = os.path.join(self.temp_dir, changejournal.JOURNAL_NAME)
+
+	def tearDown(self):
+		shutil.rmtree(self.temp_dir)
+
+	def _msg(self, time, value):
+		msg = paramsvalues_pb2.ParamValue()
+		msg.param_no = 1
+		msg.time = time
+		msg.int_value = value
+
+		return msg
+
+	def _journal(self, path):
+		with open(path) as f:
+			return f.read()
+
+	def test_record(self):
+		journal = changejournal.ChangeJournal(self.temp_dir)
+		sp = saveparam.SaveParam(param.from_node(self.node), self.temp_dir, journal=journal)
+
+		sp.process_msg(self._msg(123456, 4))
+		sp.process_msg(self._msg(123457, 5))
+		self.assertEqual(self._journal(self.journal_path), "")
+
+		journal.flush()
+		self.assertEqual(self._journal(self.journal_path), "Kociol_3/Sterownik/Aktualne_wysterowanie_falownika_podmuchu/0000123456.sz4 9\n")
+
+		journal.flush()
+		sp.process_msg(self._msg(123458, 5))
+		journal.close()
+		self.assertEqual(self._journal(self.journal_path),
+			"Kociol_3/Sterownik/Aktualne_wysterowanie_falownika_podmuchu/0000123456.sz4 9\n"
+			"Kociol_3/Sterownik/Aktualne_wysterowanie_falownika_podmuchu/0000123456.sz4 10\n")
+
+	def test_rotate(self):
+		journal = changejournal.ChangeJournal(self.temp_dir)
+		journal.record(os.path.join(self.temp_dir, "a/b/0000000001.sz4"), 4)
+		journal.flush()
+		journal.rotate()
+		journal.record(os.path.join(self.temp_dir, "a/b/0000000001.sz4"), 8)
+		journal.close()
+
+		self.assertEqual(self._journal(self.journal_path + ".1"), "a/b/0000000001.sz4 4\n")
+		self.assertEqual(self._journal(self.journal_path), "a/b/0000000001.sz4 8\n")
+
+		changejournal.remove_journal(self.temp_dir)
+		self.assertFalse(os.path.exists(self.journal_path))
+
+	def test_existing_journal(self):
+		self.assertTrue(changejournal.existing_journal(self.temp_dir) is None)
+		self.assertFalse(os.path.exists(self.journal_path))
+
+		journal = changejournal.ChangeJournal(self.temp_dir)
+		other = changejournal.existing_journal(self.temp_dir)
+		self.assertFalse(other is None)
+
+		# journal rotated by the other writer is followed
+		other.record(os.path.join(self.temp_dir, "a/b/0000000001.sz4"), 4)
+		other.flush()
+		other.rotate()
+		journal.record(os.path.join(self.temp_dir, "a/c/0000000001.sz4"), 4)
+		journal.flush()
+		self.assertEqual(self._journal(self.journal_path), "a/c/0000000001.sz4 4\n")
+
+		# and the one removed is not created again
+		changejournal.remove_journal(self.temp_dir)
+		other.record(os.path.join(self.temp_dir, "a/b/0000000001.sz4"), 8)
+		other.close()
+		self.assertFalse(os.path.exists(self.journal_path))
+		journal.close()
+
+	def test_close(self):
+		journal = changejournal.ChangeJournal(self.temp_dir)
+		sp = saveparam.SaveParam(param.from_node(self.node), self.temp_dir, journal=journal)
+
+		sp.process_msg(self._msg(123456, 4))
+		journal.flush()
+		sp.close()
+		journal.close()
+		self.assertEqual(self._journal(self.journal_path),
+			"Kociol_3/Sterownik/Aktualne_wysterowanie_falownika_podmuchu/0000123456.sz4 4\n" * 2)
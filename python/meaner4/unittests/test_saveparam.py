@@ -34,6 +34,8 @@ import paramsvalues_pb2
 import parampath
 import saveparam
 import config
+import valuecodec
+import timedelta
 
 class SaveParamTest(unittest.TestCase):
 	def setUp(self):
@@ -108,6 +110,38 @@ class SaveParamTest(unittest.TestCase):
 
 		shutil.rmtree(temp_dir)
 
+	def test_compressed(self):
+		temp_dir = tempfile.mkdtemp(suffix="meaner4_unit_test")
+		path = os.path.join(temp_dir, "Kociol_3/Sterownik/Aktualne_wysterowanie_falownika_podmuchu/00001234560000000000.sz4")
+		header = valuecodec.CompressedCodec.header
+
+		sp = saveparam.SaveParam(param.from_node(self.node), temp_dir, compress=True)
+		sp.process_msg(self._msg(123456, 4))
+		self._check_size(path, len(header) + 1)
+
+		sp.process_msg(self._msg(123457, 4))
+		sp.process_msg(self._msg(123458, 5))
+		with open(path) as f:
+			self.assertEqual(header + "\x08\xf0\x77\x35\x94\x00\x02", f.read())
+
+		del sp
+		sp = saveparam.SaveParam(param.from_node(self.node), temp_dir, compress=True)
+		sp.process_msg(self._msg(123459, 3))
+
+		p = param.from_node(self.node)
+		with open(path) as f:
+			codec = valuecodec.from_file(f, p)
+			values = []
+			while True:
+				values.append(codec.decode(f)[0])
+				if f.tell() == os.path.getsize(path):
+					break
+				timedelta.decode(f)
+
+		self.assertEqual([4, p.nan(), 3], values)
+
+		shutil.rmtree(temp_dir)
+
 	def test_basictest3(self):
 		temp_dir = tempfile.mkdtemp(suffix="meaner4_unit_test")
 
@@ -0,0 +1,88 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+"""
+  SZARP: SCADA software 
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+"""
+
+import math
+import unittest
+import StringIO
+
+import param
+import valuecodec
+
+class ValueCodecTest(unittest.TestCase):
+	def _codec(self, data_type):
+		return valuecodec.CompressedCodec(param.Param("p", data_type, 0, 4, True))
+
+	def test_encode_short(self):
+		codec = self._codec("short")
+
+		self.assertEqual("\x02", codec.encode(1))
+		self.assertEqual("\x04", codec.encode(3))
+		self.assertEqual("\x07", codec.encode(-1))
+		self.assertEqual("\x92\x03", codec.encode(200))
+		self.assertEqual("\x00", codec.encode(200))
+
+	def test_encode_float(self):
+		codec = self._codec("float")
+
+		self.assertEqual("\x22\x80\x3f", codec.encode(1.0))
+		self.assertEqual("\x00", codec.encode(1.0))
+		self.assertEqual("\x31\x80", codec.encode(-1.0))
+
+	def test_rewind(self):
+		codec = self._codec("integer")
+
+		codec.encode(10)
+		self.assertEqual("\x0a", codec.encode(15))
+		codec.rewind()
+		self.assertEqual("\x14", codec.encode(20))
+
+	def test_decode_encoded(self):
+		for data_type, values in [ ("short", [ 0, 5, -2 ** 15, 2 ** 15 - 1, 7 ]),
+				("uinteger", [ 2 ** 32 - 1, 0, 12345 ]),
+				("double", [ 0.1, 0.2, 0.2, -1e300, float('nan'), 3.0 ]) ]:
+			encoder = self._codec(data_type)
+			encoded = "".join([ encoder.encode(v) for v in values ])
+
+			decoder = self._codec(data_type)
+			f = StringIO.StringIO(encoded)
+			for v in values:
+				decoded, size = decoder.decode(f)
+				if isinstance(v, float) and math.isnan(v):
+					self.assertTrue(math.isnan(decoded))
+				else:
+					self.assertEqual(v, decoded)
+			self.assertEqual(len(encoded), f.tell())
+
+	def test_from_file(self):
+		p = param.Param("p", "float", 0, 4, True)
+
+		f = StringIO.StringIO(valuecodec.CompressedCodec.header + "\x00\x01")
+		self.assertTrue(isinstance(valuecodec.from_file(f, p), valuecodec.CompressedCodec))
+		self.assertEqual(8, f.tell())
+
+		f = StringIO.StringIO("\x00\x00\x80\x3f\x01")
+		self.assertTrue(isinstance(valuecodec.from_file(f, p), valuecodec.RawCodec))
+		self.assertEqual(0, f.tell())
+
+		f = StringIO.StringIO(valuecodec.MAGIC[:3])
+		self.assertEqual(None, valuecodec.from_file(f, p))
+		self.assertEqual("", f.getvalue())
+
@@ -0,0 +1,177 @@
+"""
+  SZARP: SCADA software
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+"""
+
+import struct
+
+# must match file_header in sz4/value_codec.h
+MAGIC = "\x89SZ4\r\n\x1a"
+VERSION_RAW = 1
+VERSION_COMPRESSED = 2
+
+class RawCodec:
+	"""
+	Values of files without header, written as they are.
+	"""
+	header = ""
+
+	def __init__(self, param):
+		self.param = param
+		self.max_value_size = param.value_lenght
+
+	def rewind(self):
+		pass
+
+	def encode(self, value):
+		return self.param.value_to_binary(value)
+
+	def decode(self, file):
+		blob = file.read(self.param.value_lenght)
+		return self.param.value_from_binary(blob), len(blob)
+
+class CompressedCodec:
+	"""
+	Values stored relative to the previous value of the file. Integers
+	are written as zig-zag encoded difference, 7 bits per byte. Floating
+	point values are XORed with the previous value and stripped of zero
+	bytes on both ends, first byte holds number of stripped low bytes and
+	number of bytes that follow.
+	"""
+	header = MAGIC + chr(VERSION_COMPRESSED)
+
+	def __init__(self, param):
+		self.param = param
+		self.floating = param.data_type in ("float", "double")
+		if self.floating:
+			self.bits_format = "<I" if param.value_lenght == 4 else "<Q"
+			self.max_value_size = param.value_lenght + 1
+		else:
+			self.max_value_size = (param.value_lenght * 8 + 1 + 6) / 7
+
+		self.previous = 0
+		self.before_last = 0
+
+	def rewind(self):
+		"""Makes next encoded value replace the last one"""
+		self.previous = self.before_last
+
+	def to_state(self, value):
+		if self.floating:
+			return struct.unpack(self.bits_format, self.param.value_to_binary(value))[0]
+		else:
+			return value
+
+	def from_state(self, state):
+		if self.floating:
+			return self.param.value_from_binary(struct.pack(self.bits_format, state))
+		else:
+			return state
+
+	def advance(self, state):
+		self.before_last = self.previous
+		self.previous = state
+
+	def encode(self, value):
+		state = self.to_state(value)
+		if self.floating:
+			blob = encode_xor(state ^ self.previous)
+		else:
+			blob = encode_zigzag(state - self.previous)
+
+		self.advance(state)
+		return blob
+
+	def decode(self, file):
+		if self.floating:
+			xored, size = decode_xor(file)
+			state = self.previous ^ xored
+		else:
+			delta, size = decode_zigzag(file)
+			state = self.previous + delta
+
+		self.advance(state)
+		return self.from_state(state), size
+
+def encode_zigzag(delta):
+	value = delta << 1 if delta >= 0 else ((-delta) << 1) - 1
+
+	blob = ""
+	while value >= 0x80:
+		blob += chr(0x80 | (value & 0x7f))
+		value >>= 7
+	return blob + chr(value)
+
+def decode_zigzag(file):
+	value = 0
+	shift = 0
+	while True:
+		byte = byte_from_file(file)
+		value |= (byte & 0x7f) << shift
+		shift += 7
+		if not byte & 0x80:
+			break
+
+	delta = -((value + 1) >> 1) if value & 1 else value >> 1
+	return delta, shift / 7
+
+def encode_xor(xored):
+	if xored == 0:
+		return chr(0)
+
+	trailing = 0
+	while not xored & 0xff:
+		xored >>= 8
+		trailing += 1
+
+	blob = ""
+	while xored:
+		blob += chr(xored & 0xff)
+		xored >>= 8
+
+	return chr((trailing << 4) | len(blob)) + blob
+
+def decode_xor(file):
+	control = byte_from_file(file)
+	trailing, count = control >> 4, control & 0xf
+
+	xored = 0
+	for i in xrange(count):
+		xored |= byte_from_file(file) << (8 * (trailing + i))
+
+	return xored, count + 1
+
+def byte_from_file(file):
+	return struct.unpack("B", file.read(1))[0]
+
+def from_file(file, param):
+	"""
+	Returns codec for the file positioned at its beginning and leaves the
+	file positioned at the first entry, None is returned if the file has
+	no complete header nor any entries
+	"""
+	header = file.read(len(CompressedCodec.header))
+	if header == CompressedCodec.header:
+		return CompressedCodec(param)
+
+	if MAGIC.startswith(header[:len(MAGIC)]) and len(header) < len(CompressedCodec.header):
+		file.truncate(0)
+		file.seek(0, 0)
+		return None
+
+	file.seek(0, 0)
+	return RawCodec(param)
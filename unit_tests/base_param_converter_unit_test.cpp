@@ -13,10 +13,12 @@ class BaseParamConverterTestCase : public CPPUNIT_NS::TestFixture
 {
 	void test1();
 	void test2();
+	void programTest();
 
 	CPPUNIT_TEST_SUITE( BaseParamConverterTestCase );
 	CPPUNIT_TEST( test1 );
 	CPPUNIT_TEST( test2 );
+	CPPUNIT_TEST( programTest );
 	CPPUNIT_TEST_SUITE_END();
 };
 
@@ -35,6 +37,21 @@ public:
 	TParam* GetParam(const std::wstring&) { return &param; }
 };
 
+class ExecutionEngineMock : public LuaExec::ExecutionEngine {
+	std::vector<double> m_vars;
+public:
+	int m_calls;
+
+	ExecutionEngineMock() : m_calls(0) {}
+
+	double Value(size_t param_index, const double& time, const double& period_type) {
+		m_calls++;
+		return time / 10;
+	}
+
+	std::vector<double>& Vars() { return m_vars; }
+};
+
 }
 
 void BaseParamConverterTestCase::test1() {
@@ -107,3 +124,53 @@ void BaseParamConverterTestCase::test2() {
 		CPPUNIT_ASSERT(false);
 	}
 }
+
+void BaseParamConverterTestCase::programTest() {
+	IPKContainerMock mock;
+	LuaExec::Param param;
+
+	lua_grammar::chunk param_code;
+	std::string fu =
+"	local k = 2 * 3 + 1"
+"	local unused = k * 100"
+"	local s = 0"
+"	for i = 1, 4 do"
+"		if i % 2 == 0 or false then"
+"			s = s + p(\"a:b:c\", t + i, pt)"
+"		else"
+"			s = s + k"
+"		end"
+"	end"
+"	if 1 > 2 then"
+"		v = nan()"
+"	else"
+"		v = s"
+"	end";
+
+	std::wstring f = SC::U2S((const unsigned char*)fu.c_str());
+	std::wstring::const_iterator param_text_begin = f.begin();
+	std::wstring::const_iterator param_text_end = f.end();
+	CPPUNIT_ASSERT(lua_grammar::parse(param_text_begin, param_text_end, param_code) && param_text_begin == param_text_end);
+
+	LuaExec::ParamConverterTempl<IPKContainerMock> conv(&mock);
+	conv.ConvertParam(param_code, &param);
+
+	const LuaExec::Program& program = param.m_program;
+	for (size_t i = 0; i < program.m_code.size(); i++) {
+		/* 2 * 3 + 1 is folded, dead 'unused' store is gone */
+		CPPUNIT_ASSERT(program.m_code[i].op != LuaExec::Program::MUL);
+		/* if 1 > 2 has no branch left */
+		CPPUNIT_ASSERT(program.m_code[i].op != LuaExec::Program::GT);
+	}
+
+	ExecutionEngineMock engine;
+	std::vector<double> regs;
+	program.InitRegisters(regs);
+	regs[0] = nan("");
+	regs[1] = 100;
+	regs[2] = PT_MIN10;
+	program.Execute(&regs[0], &engine);
+
+	CPPUNIT_ASSERT_EQUAL(2, engine.m_calls);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL(7 + 10.2 + 7 + 10.4, regs[0], 1e-9);
+}
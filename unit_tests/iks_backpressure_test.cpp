@@ -0,0 +1,94 @@
+#include "config.h"
+
+#include <chrono>
+
+#include <boost/asio.hpp>
+
+#include "net/tcp_server.h"
+#include "locations/location.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace ba = boost::asio;
+using boost::asio::ip::tcp;
+
+class IksBackpressureTest : public CPPUNIT_NS::TestFixture
+{
+	void writableTest();
+
+	CPPUNIT_TEST_SUITE( IksBackpressureTest );
+	CPPUNIT_TEST( writableTest );
+	CPPUNIT_TEST_SUITE_END();
+};
+
+namespace {
+
+class TestLocation : public Location {
+public:
+	TestLocation( Connection* conn ) : Location( "test" , conn ) {}
+
+	using Location::when_writable;
+
+protected:
+	void parse_line( const std::string& ) {}
+};
+
+}
+
+void IksBackpressureTest::writableTest() {
+	ba::io_service io;
+
+	tcp::endpoint endpoint( ba::ip::address_v4::loopback() , 0 );
+	{
+		tcp::acceptor probe( io , endpoint );
+		endpoint.port( probe.local_endpoint().port() );
+	}
+
+	TcpServer server( io , endpoint );
+
+	Connection* conn = nullptr;
+	server.on_connected( [&conn] ( Connection* c ) { conn = c; } );
+
+	tcp::socket client( io );
+	client.open( tcp::v4() );
+	/* small window, so that unread data stays in server write queue */
+	client.set_option( ba::socket_base::receive_buffer_size( 4096 ) );
+	client.connect( endpoint );
+
+	while( !conn )
+		io.run_one();
+
+	TestLocation location( conn );
+
+	bool called = false;
+	location.when_writable( [&called] () { called = true; } );
+	CPPUNIT_ASSERT( called );
+
+	std::string line( 64 * 1024 , 'x' );
+	for( size_t i = 0 ; i < 1024 && conn->writable() ; i++ ) {
+		conn->write_line( line );
+		io.poll();
+	}
+	CPPUNIT_ASSERT( !conn->writable() );
+
+	called = false;
+	location.when_writable( [&called] () { called = true; } );
+	io.poll();
+	CPPUNIT_ASSERT( !called );
+
+	/* client reads, queue drains and waiting continuation is called once */
+	std::vector<char> buf( 64 * 1024 );
+	size_t read = 0;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 30 );
+	while( !called && std::chrono::steady_clock::now() < deadline ) {
+		if( client.available() )
+			read += client.read_some( ba::buffer( buf ) );
+		io.poll();
+	}
+
+	CPPUNIT_ASSERT( called );
+	CPPUNIT_ASSERT( conn->writable() );
+	CPPUNIT_ASSERT( read > 0 );
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IksBackpressureTest );
@@ -0,0 +1,66 @@
+#include "config.h"
+
+#include "data/results_cache.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ResultsCacheTest : public CPPUNIT_NS::TestFixture
+{
+	void lruTest();
+	void generationTest();
+
+	CPPUNIT_TEST_SUITE( ResultsCacheTest );
+	CPPUNIT_TEST( lruTest );
+	CPPUNIT_TEST( generationTest );
+	CPPUNIT_TEST_SUITE_END();
+};
+
+namespace {
+
+ResultsCache::result_ptr make_result(size_t size) {
+	return std::make_shared<const std::string>(size, 'x');
+}
+
+}
+
+void ResultsCacheTest::lruTest() {
+	ResultsCache cache(10);
+
+	auto a = make_result(4), b = make_result(4);
+	cache.put("a", a, cache.generation());
+	cache.put("b", b, cache.generation());
+	CPPUNIT_ASSERT(cache.get("a") == a);
+
+	/* b is least recently used */
+	cache.put("c", make_result(4), cache.generation());
+	CPPUNIT_ASSERT(cache.get("a") == a);
+	CPPUNIT_ASSERT(!cache.get("b"));
+	CPPUNIT_ASSERT(cache.get("c"));
+
+	/* larger than whole cache */
+	cache.put("d", make_result(11), cache.generation());
+	CPPUNIT_ASSERT(!cache.get("d"));
+	CPPUNIT_ASSERT(cache.get("a") == a);
+}
+
+void ResultsCacheTest::generationTest() {
+	ResultsCache cache(100);
+
+	auto generation = cache.generation();
+	cache.put("a", make_result(1), generation);
+
+	/* reply computed before clear comes back after it */
+	auto stale = cache.generation();
+	cache.clear();
+	CPPUNIT_ASSERT(!cache.get("a"));
+	CPPUNIT_ASSERT(stale != cache.generation());
+
+	cache.put("b", make_result(1), stale);
+	CPPUNIT_ASSERT(!cache.get("b"));
+
+	auto fresh = make_result(1);
+	cache.put("b", fresh, cache.generation());
+	CPPUNIT_ASSERT(cache.get("b") == fresh);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ResultsCacheTest );
@@ -0,0 +1,180 @@
+#include "config.h"
+
+#include <climits>
+#include <cmath>
+#include <sstream>
+#include <tuple>
+
+#include "sz4/defs.h"
+#include "data/wsum_codec.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class WsumCodecTest : public CPPUNIT_NS::TestFixture
+{
+	void intTest();
+	void nanosecondTest();
+	void doubleTest();
+	void malformedTest();
+
+	CPPUNIT_TEST_SUITE( WsumCodecTest );
+	CPPUNIT_TEST( intTest );
+	CPPUNIT_TEST( nanosecondTest );
+	CPPUNIT_TEST( doubleTest );
+	CPPUNIT_TEST( malformedTest );
+	CPPUNIT_TEST_SUITE_END();
+};
+
+namespace {
+
+template<class V, class T> struct decoded {
+	typedef sz4::weighted_sum<V, T> wsum_type;
+	typedef std::tuple<typename wsum_type::sum_type,
+			typename wsum_type::time_diff_type,
+			typename wsum_type::time_diff_type,
+			bool> type;
+};
+
+template<class V, class T> std::vector<typename decoded<V, T>::type>
+from_text(const std::vector<sz4::weighted_sum<V, T>>& sums) {
+	std::ostringstream os;
+	for (auto& sum : sums)
+		os << sum._sum() << " " << sum.weight() << " " << sum.no_data_weight() << " " << sum.fixed() << " ";
+
+	std::vector<typename decoded<V, T>::type> r;
+	typename decoded<V, T>::type t;
+	std::istringstream is(os.str());
+	while (is >> std::get<0>(t) >> std::get<1>(t) >> std::get<2>(t) >> std::get<3>(t))
+		r.push_back(t);
+	return r;
+}
+
+template<class V, class T> std::vector<typename decoded<V, T>::type>
+from_binary(const std::string& data, bool& ok) {
+	typedef sz4::weighted_sum<V, T> wsum_type;
+
+	std::vector<typename decoded<V, T>::type> r;
+	ok = wsum_codec::decode<V, T>(data, [&r] (
+				const typename wsum_type::sum_type& sum,
+				const typename wsum_type::time_diff_type& weight,
+				const typename wsum_type::time_diff_type& no_data_weight,
+				bool fixed) {
+		r.push_back(std::make_tuple(sum, weight, no_data_weight, fixed));
+	});
+	return r;
+}
+
+template<class V, class T> void check_round_trip(const std::vector<sz4::weighted_sum<V, T>>& sums) {
+	auto text = from_text(sums);
+	CPPUNIT_ASSERT_EQUAL(sums.size(), text.size());
+
+	bool ok;
+	CPPUNIT_ASSERT((text == from_binary<V, T>(wsum_codec::encode(sums, false), ok)));
+	CPPUNIT_ASSERT(ok);
+
+	CPPUNIT_ASSERT((text == from_binary<V, T>(wsum_codec::encode(sums, true), ok)));
+	CPPUNIT_ASSERT(ok);
+}
+
+std::string to_base64(std::string raw) {
+	raw.append((3 - raw.size() % 3) % 3, '\0');
+
+	std::string encoded;
+	std::copy(wsum_codec::base64_enc(raw.data()), wsum_codec::base64_enc(raw.data() + raw.size()),
+			std::back_inserter(encoded));
+	return encoded;
+}
+
+}
+
+void WsumCodecTest::intTest() {
+	typedef sz4::weighted_sum<int, sz4::second_time_t> wsum_t;
+	std::vector<wsum_t> sums(6);
+
+	sums[0].add(INT_MAX, LONG_MAX);
+	sums[0].add(INT_MAX, LONG_MAX);
+	sums[1].add(-5, LONG_MAX);
+	sums[1].set_fixed(false);
+	/* deltas of weights overflow long */
+	sums[2].add(INT_MIN, LONG_MIN);
+	sums[2].add_no_data_weight(LONG_MAX);
+	sums[3].add(1, 1);
+	sums[3].add_no_data_weight(LONG_MIN);
+	sums[5].add(-1, 100);
+
+	check_round_trip(sums);
+	check_round_trip(std::vector<wsum_t>());
+}
+
+void WsumCodecTest::nanosecondTest() {
+	typedef sz4::weighted_sum<short, sz4::nanosecond_time_t> wsum_t;
+	std::vector<wsum_t> sums(3);
+
+	wsum_t::time_diff_type big(1);
+	big <<= 100;
+
+	sums[0].add(SHRT_MIN, big);
+	sums[0].add_no_data_weight(big * 3);
+	sums[1].add(SHRT_MAX, 1);
+	sums[1].set_fixed(false);
+	sums[2].add(7, -big);
+
+	check_round_trip(sums);
+}
+
+void WsumCodecTest::doubleTest() {
+	typedef sz4::weighted_sum<double, sz4::second_time_t> wsum_t;
+	std::vector<wsum_t> sums(3);
+
+	sums[0].add(0.25, 4);
+	sums[1].add(-1e300, 1);
+	sums[1].add_no_data_weight(10);
+	sums[2].add(3.5, LONG_MAX);
+
+	auto text = from_text(sums);
+	for (bool delta : { false, true }) {
+		bool ok;
+		auto binary = from_binary<double, sz4::second_time_t>(wsum_codec::encode(sums, delta), ok);
+		CPPUNIT_ASSERT(ok);
+		CPPUNIT_ASSERT_EQUAL(text.size(), binary.size());
+		for (size_t i = 0; i < text.size(); i++) {
+			/* text reply rounds the sums, binary one is exact */
+			CPPUNIT_ASSERT_EQUAL(sums[i]._sum(), std::get<0>(binary[i]));
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(std::get<0>(text[i]), std::get<0>(binary[i]), 1e-5 * std::abs(std::get<0>(binary[i])));
+			CPPUNIT_ASSERT_EQUAL(std::get<1>(text[i]), std::get<1>(binary[i]));
+			CPPUNIT_ASSERT_EQUAL(std::get<2>(text[i]), std::get<2>(binary[i]));
+			CPPUNIT_ASSERT_EQUAL(std::get<3>(text[i]), std::get<3>(binary[i]));
+		}
+	}
+}
+
+void WsumCodecTest::malformedTest() {
+	typedef sz4::weighted_sum<int, sz4::second_time_t> wsum_t;
+	std::vector<wsum_t> sums(4);
+	for (size_t i = 0; i < sums.size(); i++)
+		sums[i].add(int(i) * 1000, long(i) * 100000);
+
+	bool ok;
+	for (bool delta : { false, true }) {
+		std::string data = wsum_codec::encode(sums, delta);
+		for (size_t len = 0; len < data.size(); len += 4) {
+			from_binary<int, sz4::second_time_t>(data.substr(0, len), ok);
+			CPPUNIT_ASSERT(!ok);
+		}
+
+		from_binary<int, sz4::second_time_t>(data.substr(0, data.size() - 1), ok);
+		CPPUNIT_ASSERT(!ok);
+
+		from_binary<int, sz4::second_time_t>(data.substr(0, data.size() - 4) + "!!!!", ok);
+		CPPUNIT_ASSERT(!ok);
+	}
+
+	/* weight with more continuation bytes than fit in long */
+	std::string raw("\0\1\0\0\0\0", 6);
+	raw.append(10, char(0xff));
+	raw.append("\1\0\0", 3);
+	from_binary<int, sz4::second_time_t>(to_base64(raw), ok);
+	CPPUNIT_ASSERT(!ok);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( WsumCodecTest );
@@ -101,6 +101,9 @@ public:
 
 	void get_weighted_sum_impl(time_type start, time_type end, SZARP_PROBE_TYPE probe_type, sz4::weighted_sum<value_type, time_type>& sum) {}
 
+	void get_weighted_sums_impl(const std::vector<std::pair<time_type, time_type> >& ranges, SZARP_PROBE_TYPE probe_type, std::vector<sz4::weighted_sum<value_type, time_type> >& sums) {
+		sums.resize(ranges.size());
+	}
 
 	time_type search_data_right_impl(time_type start, time_type end, SZARP_PROBE_TYPE probe_type, const sz4::search_condition& condition) {
 		return start;
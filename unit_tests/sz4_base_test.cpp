@@ -31,6 +31,7 @@ public:
 	void smokeTest1();
 	void cacheTest1();
 	void getLastTest();
+	void weightedSumsTest();
 	void setUp();
 	void tearDown();
 
@@ -38,6 +39,7 @@ public:
 	CPPUNIT_TEST( smokeTest1 );
 	CPPUNIT_TEST( cacheTest1 );
 	CPPUNIT_TEST( getLastTest );
+	CPPUNIT_TEST( weightedSumsTest );
 	CPPUNIT_TEST_SUITE_END();
 };
 
@@ -271,3 +273,34 @@ void Sz4BaseTestCase::getLastTest() {
 	base.get_weighted_sum(pl, sz4::time_just_before(tln), tln, PT_SEC, sum_1ln);
 	CPPUNIT_ASSERT_DOUBLES_EQUAL(0.2, sum_1ln.avg(), 0.05);
 }
+
+void Sz4BaseTestCase::weightedSumsTest() {
+	IPKContainer* ipk = IPKContainer::GetObject();
+
+	TParam* pr = ipk->GetParam(std::wstring(L"a:a:a:a"));
+	CPPUNIT_ASSERT(pr != NULL);
+
+	TParam* pl = ipk->GetParam(std::wstring(L"a:z:z:z"));
+	CPPUNIT_ASSERT(pl != NULL);
+
+	sz4::base base(m_base_dir_name, ipk);
+
+	for (TParam* p : { pr, pl }) {
+		std::vector<sz4::weighted_sum<double, sz4::second_time_t> > sums;
+		base.get_weighted_sums(p, sz4::second_time_t(990), sz4::second_time_t(2100), PT_SEC10, sums);
+		CPPUNIT_ASSERT_EQUAL(size_t(111), sums.size());
+
+		sz4::second_time_t t = 990;
+		for (auto& sum : sums) {
+			sz4::weighted_sum<double, sz4::second_time_t> expected;
+			base.get_weighted_sum(p, t, sz4::second_time_t(t + 10), PT_SEC10, expected);
+
+			CPPUNIT_ASSERT_EQUAL(expected.weight(), sum.weight());
+			CPPUNIT_ASSERT_EQUAL(expected.no_data_weight(), sum.no_data_weight());
+			CPPUNIT_ASSERT_EQUAL(expected.fixed(), sum.fixed());
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(double(expected._sum()), double(sum._sum()), 0.001);
+
+			t += 10;
+		}
+	}
+}
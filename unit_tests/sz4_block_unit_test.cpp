@@ -27,19 +27,27 @@ class Sz4BlockTestCase : public CPPUNIT_NS::TestFixture
 	void searchTest();
 	void weigthedSumTest();
 	void weigthedSumTest2();
+	void nativeWeightedSumTest();
+	void soaBlockTest();
 	void pathTest();
 	void blockLoadTest();
 	void searchDataTest();
 	void testBigNum();
+	void cacheEvictionTest();
+	void summaryTest();
 
 	CPPUNIT_TEST_SUITE( Sz4BlockTestCase );
 	CPPUNIT_TEST( searchTest );
 	CPPUNIT_TEST( weigthedSumTest );
 	CPPUNIT_TEST( weigthedSumTest2 );
+	CPPUNIT_TEST( nativeWeightedSumTest );
+	CPPUNIT_TEST( soaBlockTest );
 	CPPUNIT_TEST( pathTest );
 	CPPUNIT_TEST( blockLoadTest );
 	CPPUNIT_TEST( searchDataTest );
 	CPPUNIT_TEST( testBigNum );
+	CPPUNIT_TEST( cacheEvictionTest );
+	CPPUNIT_TEST( summaryTest );
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void setUp();
@@ -145,6 +153,94 @@ void Sz4BlockTestCase::weigthedSumTest2() {
 	CPPUNIT_ASSERT_EQUAL(2l, weight);
 }
 
+namespace {
+
+template<class V> void compare_with_generic_sum() {
+	typedef sz4::value_time_pair<V, sz4::second_time_t> pair_type;
+	std::vector<pair_type> v;
+
+	for (unsigned i = 0; i < 3000; i++) {
+		V value;
+		if (i % 7 == 0)
+			value = sz4::no_data<V>();
+		else if (i % 5 == 0)
+			value = std::numeric_limits<V>::max();
+		else if (i % 3 == 0)
+			value = -V(i);
+		else
+			value = V(i);
+		v.push_back(sz4::make_value_time_pair<pair_type>(value, 10 + i * 1000 + i % 3 * 300));
+	}
+
+	for (sz4::second_time_t start = 0; start < 3100000; start += 99991)
+		for (sz4::second_time_t end = start + 1; end < 3100000; end += 199999) {
+			sz4::weighted_sum<V, sz4::second_time_t> expected, actual;
+			sz4::get_weighted_sum(v.begin(), v.end(), start, end, expected);
+			sz4::get_weighted_sum(v, start, end, actual);
+
+			CPPUNIT_ASSERT(expected._sum() == actual._sum());
+			CPPUNIT_ASSERT_EQUAL(expected.weight(), actual.weight());
+			CPPUNIT_ASSERT_EQUAL(expected.no_data_weight(), actual.no_data_weight());
+
+			sz4::summary_weighted_sum<V, sz4::second_time_t> expected_summary, actual_summary;
+			sz4::get_weighted_sum(v.begin(), v.end(), start, end, expected_summary);
+			sz4::get_weighted_sum(v, start, end, actual_summary);
+
+			CPPUNIT_ASSERT(expected_summary._sum() == actual_summary._sum());
+			CPPUNIT_ASSERT_EQUAL(expected_summary.negative_weight(), actual_summary.negative_weight());
+		}
+}
+
+}
+
+void Sz4BlockTestCase::nativeWeightedSumTest() {
+	compare_with_generic_sum<short>();
+	compare_with_generic_sum<int>();
+	compare_with_generic_sum<float>();
+	compare_with_generic_sum<double>();
+}
+
+void Sz4BlockTestCase::soaBlockTest() {
+	typedef sz4::value_time_pair<short, sz4::nanosecond_time_t> pair_type;
+	CPPUNIT_ASSERT((sz4::block_storage<pair_type>::split));
+	CPPUNIT_ASSERT((sz4::block_storage<sz4::value_time_pair<double, sz4::second_time_t> >::split));
+	CPPUNIT_ASSERT((!sz4::block_storage<sz4::value_time_pair<double, sz4::nanosecond_time_t> >::split));
+	CPPUNIT_ASSERT((!sz4::block_storage<sz4::value_time_pair<int, sz4::second_time_t> >::split));
+
+	std::vector<pair_type> v, block_v;
+	for (unsigned i = 1; i < 100; i++)
+		v.push_back(sz4::make_value_time_pair<pair_type>(i % 9 ? short(i) : sz4::no_data<short>(), sz4::nanosecond_time_t(i * 10, i % 4)));
+	block_v = v;
+
+	sz4::concrete_block<short, sz4::nanosecond_time_t> block(sz4::nanosecond_time_t(0, 0), &m_cache);
+	block.set_data(block_v);
+	CPPUNIT_ASSERT_EQUAL(v.size(), block.data().size());
+
+	for (unsigned s = 0; s < 1000; s += 37)
+		for (unsigned e = s + 1; e < 1010; e += 53) {
+			sz4::nanosecond_time_t start(s, 2), end(e, 1);
+
+			sz4::weighted_sum<short, sz4::nanosecond_time_t> expected, actual;
+			sz4::get_weighted_sum(v.begin(), v.end(), start, end, expected);
+			block.get_weighted_sum(start, end, actual);
+			CPPUNIT_ASSERT(expected._sum() == actual._sum());
+			CPPUNIT_ASSERT(expected.weight() == actual.weight());
+			CPPUNIT_ASSERT(expected.no_data_weight() == actual.no_data_weight());
+
+			auto i = sz4::search_data_right_t(v.begin(), v.end(), start, end, sz4::no_data_search_condition());
+			auto j = block.search_data_right_t(start, end, sz4::no_data_search_condition());
+			CPPUNIT_ASSERT_EQUAL(i - v.begin(), j - block.data().begin());
+		}
+
+	auto& data = block.data();
+	block.erase_entries(data.end() - 1, data.end());
+	block.append_entry(short(5), sz4::nanosecond_time_t(2000, 0));
+	CPPUNIT_ASSERT_EQUAL(v.size(), data.size());
+	CPPUNIT_ASSERT_EQUAL(short(5), data[v.size() - 1].value);
+	CPPUNIT_ASSERT_EQUAL(sz4::nanosecond_time_t(2000, 0), block.end_time());
+	CPPUNIT_ASSERT_EQUAL(v[v.size() - 2].time, data[v.size() - 2].time);
+}
+
 void Sz4BlockTestCase::pathTest() {
 	bool sz4;
 	sz4::second_time_t st1[] = { 21, 1, sz4::time_trait<sz4::second_time_t>::invalid_value };
@@ -265,3 +361,81 @@ void Sz4BlockTestCase::searchDataTest() {
 
 }
 
+void Sz4BlockTestCase::cacheEvictionTest() {
+	typedef sz4::concrete_block<int, sz4::second_time_t> block_type;
+
+	sz4::block_cache cache(1);
+	auto create_block = [&] () {
+		std::vector<sz4::value_time_pair<int, sz4::second_time_t> > v = m_v;
+		block_type* block = new block_type(0u, &cache);
+		block->set_data(v);
+
+		sz4::weighted_sum<int, sz4::second_time_t> wsum;
+		block->get_weighted_sum(0u, 10u, wsum);
+		return block;
+	};
+
+	block_type* hot = create_block();
+	create_block();
+
+	sz4::weighted_sum<int, sz4::second_time_t> wsum;
+	hot->get_weighted_sum(0u, 10u, wsum);
+
+	for (int i = 0; i < 10; i++)
+		create_block();
+
+	size_t block_size = hot->block_size();
+	cache.set_water_marks(2 * block_size, 4 * block_size);
+	cache.purge();
+
+	std::vector<sz4::block_cache_stats> stats;
+	cache.shards_stats(stats);
+	CPPUNIT_ASSERT_EQUAL(size_t(1), stats.size());
+	CPPUNIT_ASSERT_EQUAL(size_t(2), stats[0].blocks_count);
+	CPPUNIT_ASSERT_EQUAL(2 * block_size, stats[0].size_in_bytes);
+	CPPUNIT_ASSERT_EQUAL(size_t(13), stats[0].hits);
+	CPPUNIT_ASSERT_EQUAL(size_t(12), stats[0].misses);
+	CPPUNIT_ASSERT_EQUAL(size_t(10), stats[0].evictions);
+
+	cache.remove(block_size);
+	cache.shards_stats(stats);
+	CPPUNIT_ASSERT_EQUAL(size_t(1), stats[0].blocks_count);
+
+	delete hot;
+	cache.shards_stats(stats);
+	CPPUNIT_ASSERT_EQUAL(size_t(0), stats[0].blocks_count);
+	CPPUNIT_ASSERT_EQUAL(size_t(0), stats[0].size_in_bytes);
+}
+
+void Sz4BlockTestCase::summaryTest() {
+	std::vector<sz4::value_time_pair<int, sz4::second_time_t> > v = m_v;
+
+	sz4::concrete_block<int, sz4::second_time_t> block(0u, &m_cache);
+	sz4::values_summary summary = block.summary();
+	CPPUNIT_ASSERT(!summary.has_data);
+	CPPUNIT_ASSERT(!summary.has_no_data);
+	CPPUNIT_ASSERT(!sz4::no_data_search_condition().may_match(summary));
+
+	block.set_data(v);
+	summary = block.summary();
+	CPPUNIT_ASSERT(summary.has_data);
+	CPPUNIT_ASSERT(!summary.has_no_data);
+	CPPUNIT_ASSERT_EQUAL(1., summary.min);
+	CPPUNIT_ASSERT_EQUAL(9., summary.max);
+	CPPUNIT_ASSERT(sz4::no_data_search_condition().may_match(summary));
+	CPPUNIT_ASSERT(test_search_condition(5).may_match(summary));
+	CPPUNIT_ASSERT(!test_search_condition(10).may_match(summary));
+
+	sz4::concrete_block<double, sz4::nanosecond_time_t> nblock(sz4::nanosecond_time_t(0, 0), &m_cache);
+	nblock.append_entry(sz4::no_data<double>(), sz4::nanosecond_time_t(1, 0));
+	summary = nblock.summary();
+	CPPUNIT_ASSERT(!summary.has_data);
+	CPPUNIT_ASSERT(summary.has_no_data);
+
+	nblock.append_entry(-2.5, sz4::nanosecond_time_t(2, 0));
+	summary = nblock.summary();
+	CPPUNIT_ASSERT(summary.has_data);
+	CPPUNIT_ASSERT(summary.has_no_data);
+	CPPUNIT_ASSERT_EQUAL(-2.5, summary.min);
+	CPPUNIT_ASSERT_EQUAL(-2.5, summary.max);
+}
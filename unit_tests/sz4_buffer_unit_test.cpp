@@ -5,11 +5,17 @@ class Sz4BufferTestCase : public CPPUNIT_NS::TestFixture
 	void test1();
 	void test2();
 	void searchTest();
+	void rewrittenLastTest();
+	void summaryTest();
+	void summaryStoreTest();
 
 	CPPUNIT_TEST_SUITE( Sz4BufferTestCase );
 	CPPUNIT_TEST( test1 );
 	CPPUNIT_TEST( test2 );
 	CPPUNIT_TEST( searchTest );
+	CPPUNIT_TEST( rewrittenLastTest );
+	CPPUNIT_TEST( summaryTest );
+	CPPUNIT_TEST( summaryStoreTest );
 	CPPUNIT_TEST_SUITE_END();
 
 	mocks::IPKContainerMock m_mock;
@@ -259,3 +265,191 @@ void Sz4BufferTestCase::searchTest() {
 	boost::filesystem::remove_all(boost::filesystem::wpath(base_dir_name.str()));
 
 }
+
+namespace {
+
+class fake_base {
+	sz4::block_cache m_cache;
+public:
+	sz4::block_cache* cache() { return &m_cache; }
+};
+
+}
+
+void Sz4BufferTestCase::rewrittenLastTest() {
+	std::wstringstream file_name;
+	file_name << L"/tmp/szb_bufer_unit_test_3" << getpid() << L"." << time(NULL) << L".sz4";
+	std::string path = SC::S2A(file_name.str());
+
+	{
+		std::ofstream ofs(path.c_str(), std::ios_base::binary);
+		unsigned data = 10;
+		ofs.write((const char*) &data, sizeof(data));
+		unsigned char delta = 50;
+		ofs.write((const char*) &delta, sizeof(delta));
+		data = 20;
+		ofs.write((const char*) &data, sizeof(data));
+		ofs.write((const char*) &delta, sizeof(delta));
+	}
+
+	typedef sz4::weighted_sum<int, sz4::second_time_t> sum_t;
+	sum_t sum;
+	sum_t::time_diff_type weight;
+
+	fake_base base;
+	sz4::sz4_file_block_entry<int, sz4::second_time_t, fake_base> entry(1000, file_name.str(), base.cache());
+
+	///decoding stops at the last entry of the file because of requested range
+	entry.get_weighted_sum(1000, 1100, sum);
+	CPPUNIT_ASSERT_EQUAL(sz4::value_sum<int>::type(1500), sum.sum(weight));
+
+	{
+		///writer moves time of the last entry to 1350, delta takes two bytes now
+		boost::filesystem::resize_file(path, 9);
+		std::ofstream ofs(path.c_str(), std::ios_base::binary | std::ios_base::app);
+		unsigned char delta[] = { 0x81u, 0x2cu };
+		ofs.write((const char*) delta, sizeof(delta));
+	}
+	entry.set_needs_refresh();
+
+	sum = sum_t();
+	CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(1350), entry.get_weighted_sum(1000, 1400, sum));
+	CPPUNIT_ASSERT_EQUAL(sz4::value_sum<int>::type(10 * 50 + 20 * 300), sum.sum(weight));
+	CPPUNIT_ASSERT_EQUAL(sz4::time_difference<sz4::second_time_t>::type(350), weight);
+
+	boost::filesystem::remove(path);
+}
+
+void Sz4BufferTestCase::summaryTest() {
+	std::wstringstream file_name;
+	file_name << L"/tmp/szb_bufer_unit_test_4" << getpid() << L"." << time(NULL);
+	std::wstring double_file = file_name.str() + L".double.sz4";
+	std::wstring short_file = file_name.str() + L".short.sz4";
+
+	///values are summed one by one from zero, the same way as a summary is
+	double expected_double = 0;
+	sz4::value_sum<short>::type expected_unsigned = 0;
+	unsigned expected_end = 1000;
+	{
+		std::ofstream dofs(SC::S2A(double_file).c_str(), std::ios_base::binary);
+		std::ofstream sofs(SC::S2A(short_file).c_str(), std::ios_base::binary);
+		for (int i = 0; i < 1000; i++) {
+			unsigned char delta = 1 + i % 7;
+			double dv = i / 3. + 0.1;
+			short sv = i * 97 - 30000;
+
+			dofs.write((const char*) &dv, sizeof(dv));
+			dofs.write((const char*) &delta, sizeof(delta));
+			sofs.write((const char*) &sv, sizeof(sv));
+			sofs.write((const char*) &delta, sizeof(delta));
+
+			expected_double += dv * double(delta);
+			expected_unsigned += sz4::value_sum<short>::type((unsigned short) sv) * delta;
+			expected_end += delta;
+		}
+	}
+
+	fake_base base;
+	{
+		typedef sz4::weighted_sum<double, sz4::second_time_t> sum_t;
+		sz4::sz4_file_block_entry<double, sz4::second_time_t, fake_base> entry(1000, double_file, base.cache());
+
+		///without summary, then with summary computed by the first query
+		for (int i = 0; i < 2; i++) {
+			sum_t sum;
+			CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(expected_end), entry.get_weighted_sum(1000, expected_end + 100, sum));
+			CPPUNIT_ASSERT_EQUAL(expected_double, sum._sum());
+		}
+
+		///summary outlives the block
+		entry.block_deleted();
+		sum_t sum;
+		CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(expected_end), entry.get_weighted_sum(1000, expected_end + 100, sum));
+		CPPUNIT_ASSERT_EQUAL(expected_double, sum._sum());
+	}
+
+	{
+		///low words of combined params are summed as unsigned
+		typedef sz4::unsigned_short_weighted_sum<sz4::second_time_t> sum_t;
+		sz4::sz4_file_block_entry<short, sz4::second_time_t, fake_base> entry(1000, short_file, base.cache());
+
+		for (int i = 0; i < 2; i++) {
+			sum_t sum;
+			CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(expected_end), entry.get_weighted_sum(1000, expected_end + 100, sum));
+			CPPUNIT_ASSERT_EQUAL(expected_unsigned, sum._sum());
+		}
+	}
+
+	boost::filesystem::remove(SC::S2A(double_file));
+	boost::filesystem::remove(SC::S2A(short_file));
+}
+
+void Sz4BufferTestCase::summaryStoreTest() {
+	std::wstringstream base_dir_name;
+	base_dir_name << L"/tmp/szb_bufer_unit_test_5" << getpid() << L"." << time(NULL) << L".tmp";
+	boost::filesystem::wpath base_path(base_dir_name.str());
+	boost::filesystem::wpath param_dir(base_path / L"A/A/A");
+	boost::filesystem::wpath store_dir(base_path / L"store");
+	boost::filesystem::create_directories(param_dir);
+
+	boost::filesystem::wpath file(param_dir / L"0000001000.sz4");
+	std::string path = SC::S2A(file.wstring());
+
+	auto write_file = [&path] (double value, int count) {
+		std::ofstream ofs(path.c_str(), std::ios_base::binary);
+		for (int i = 0; i < count; i++) {
+			unsigned char delta = 10;
+			ofs.write((const char*) &value, sizeof(value));
+			ofs.write((const char*) &delta, sizeof(delta));
+		}
+	};
+
+	typedef sz4::weighted_sum<double, sz4::second_time_t> sum_t;
+	typedef sz4::file_summary_store<double, sz4::second_time_t> store_t;
+	typedef sz4::sz4_file_block_entry<double, sz4::second_time_t, fake_base> entry_t;
+	fake_base base;
+
+	write_file(1, 10);
+	{
+		sz4::definable_store_writer writer(store_dir);
+		store_t store(&writer, param_dir);
+		entry_t entry(1000, file.wstring(), base.cache());
+		entry.set_summary_store(&store);
+
+		sum_t sum;
+		CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(1100), entry.get_weighted_sum(1000, 2000, sum));
+		CPPUNIT_ASSERT_EQUAL(100., sum._sum());
+	}
+
+	///the same size and modification time, so the file is not decoded
+	std::time_t mtime = boost::filesystem::last_write_time(file);
+	write_file(2, 10);
+	boost::filesystem::last_write_time(file, mtime);
+	{
+		sz4::definable_store_writer writer(store_dir);
+		store_t store(&writer, param_dir);
+		entry_t entry(1000, file.wstring(), base.cache());
+		entry.set_summary_store(&store);
+
+		CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(1100), entry.end_time());
+
+		sum_t sum;
+		CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(1100), entry.get_weighted_sum(1000, 2000, sum));
+		CPPUNIT_ASSERT_EQUAL(100., sum._sum());
+	}
+
+	///changed file is summed again
+	write_file(3, 12);
+	{
+		sz4::definable_store_writer writer(store_dir);
+		store_t store(&writer, param_dir);
+		entry_t entry(1000, file.wstring(), base.cache());
+		entry.set_summary_store(&store);
+
+		sum_t sum;
+		CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(1120), entry.get_weighted_sum(1000, 2000, sum));
+		CPPUNIT_ASSERT_EQUAL(360., sum._sum());
+	}
+
+	boost::filesystem::remove_all(base_path);
+}
@@ -1,16 +1,36 @@
 #include "config.h"
 
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include "conversion.h"
+
 #include "sz4/defs.h"
 #include "sz4/decode_file.h"
+#include "sz4/load_file_locked.h"
 
 class Sz4DecodeTEst : public CPPUNIT_NS::TestFixture
 {
 	void test();
+	void decodeEntriesTest();
+	void fileIndexTest();
+	void compressedTest();
+	void compressedIndexTest();
+	void mappedFileTest();
 
 	CPPUNIT_TEST_SUITE( Sz4DecodeTEst );
 	CPPUNIT_TEST( test );
+	CPPUNIT_TEST( decodeEntriesTest );
+	CPPUNIT_TEST( fileIndexTest );
+	CPPUNIT_TEST( compressedTest );
+	CPPUNIT_TEST( compressedIndexTest );
+	CPPUNIT_TEST( mappedFileTest );
 	CPPUNIT_TEST_SUITE_END();
 };
 
@@ -23,4 +43,171 @@ void Sz4DecodeTEst::test() {
 	CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(33958800), t);
 }
 
+void Sz4DecodeTEst::decodeEntriesTest() {
+	const unsigned char buf[] = { 0x01, 0x00, 0x01,
+				0x02, 0x00, 0x02,
+				0x03, 0x00, 0x03,
+				0x04, 0x00 };
+
+	typedef sz4::value_time_pair<short, sz4::second_time_t> pair_type;
+	std::vector<pair_type> v;
+	sz4::file_position<sz4::second_time_t> position(100u);
+
+	CPPUNIT_ASSERT(sz4::decode_entries<short>(buf, sizeof(buf), position, v, sz4::second_time_t(102)));
+	CPPUNIT_ASSERT_EQUAL(size_t(2), v.size());
+	CPPUNIT_ASSERT_EQUAL(size_t(6), position.offset);
+	CPPUNIT_ASSERT_EQUAL(size_t(2), position.entry);
+	CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(103), position.time);
+
+	CPPUNIT_ASSERT(!sz4::decode_entries<short>(buf, sizeof(buf), position, v, sz4::time_trait<sz4::second_time_t>::last_valid_time));
+	CPPUNIT_ASSERT_EQUAL(size_t(3), v.size());
+	CPPUNIT_ASSERT_EQUAL(short(3), v[2].value);
+	CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(106), v[2].time);
+	///last value has no time yet
+	CPPUNIT_ASSERT_EQUAL(size_t(9), position.offset);
+
+	const unsigned char truncated[] = { 0x01, 0x00, 0xE2, 0x06 };
+	position = sz4::file_position<sz4::second_time_t>(100u);
+	v.clear();
+	CPPUNIT_ASSERT(!sz4::decode_entries<short>(truncated, sizeof(truncated), position, v, sz4::time_trait<sz4::second_time_t>::last_valid_time));
+	CPPUNIT_ASSERT_EQUAL(size_t(0), v.size());
+	CPPUNIT_ASSERT_EQUAL(size_t(0), position.offset);
+}
+
+void Sz4DecodeTEst::fileIndexTest() {
+	std::vector<unsigned char> buf;
+	for (size_t i = 0; i < 200; i++) {
+		buf.push_back(i);
+		buf.push_back(0);
+		buf.push_back(0x02);
+	}
+
+	typedef sz4::value_time_pair<short, sz4::second_time_t> pair_type;
+	std::vector<pair_type> v;
+	sz4::file_index<sz4::second_time_t> index;
+	sz4::file_position<sz4::second_time_t> first(0u);
+	sz4::file_position<sz4::second_time_t> position(first);
+
+	sz4::decode_entries<short>(&buf[0], buf.size(), position, v, sz4::time_trait<sz4::second_time_t>::last_valid_time, &index);
+	CPPUNIT_ASSERT_EQUAL(size_t(200), v.size());
+	CPPUNIT_ASSERT_EQUAL(size_t(4), index.size());
+
+	CPPUNIT_ASSERT_EQUAL(size_t(0), index.find(127u, first).entry);
+	sz4::file_position<sz4::second_time_t> p = index.find(128u, first);
+	CPPUNIT_ASSERT_EQUAL(size_t(64), p.entry);
+	CPPUNIT_ASSERT_EQUAL(size_t(64 * 3), p.offset);
+	CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(128), p.time);
+
+	///decoding from indexed position gives the same entries
+	std::vector<pair_type> v2;
+	sz4::decode_entries<short>(&buf[0], buf.size(), p, v2, sz4::time_trait<sz4::second_time_t>::last_valid_time);
+	CPPUNIT_ASSERT_EQUAL(v.size() - 64, v2.size());
+	CPPUNIT_ASSERT_EQUAL(v[64].value, v2[0].value);
+	CPPUNIT_ASSERT_EQUAL(v[64].time, v2[0].time);
+}
+
+void Sz4DecodeTEst::compressedTest() {
+	const unsigned char shorts[] = { 0x89, 'S', 'Z', '4', '\r', '\n', 0x1a, 0x02,
+				0x02, 0x01,
+				0x04, 0x01,
+				0x07, 0x01,
+				0x92, 0x03, 0x01,
+				0x00 };
+
+	std::vector<sz4::value_time_pair<short, sz4::second_time_t> > v;
+	sz4::file_position<sz4::second_time_t> position(100u);
+	CPPUNIT_ASSERT(!sz4::decode_entries<short>(shorts, sizeof(shorts), position, v, sz4::time_trait<sz4::second_time_t>::last_valid_time));
+	CPPUNIT_ASSERT_EQUAL(size_t(4), v.size());
+	CPPUNIT_ASSERT_EQUAL(short(1), v[0].value);
+	CPPUNIT_ASSERT_EQUAL(short(3), v[1].value);
+	CPPUNIT_ASSERT_EQUAL(short(-1), v[2].value);
+	CPPUNIT_ASSERT_EQUAL(short(200), v[3].value);
+	CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(104), v[3].time);
+	///last value has no time yet
+	CPPUNIT_ASSERT_EQUAL(size_t(17), position.offset);
+
+	const unsigned char floats[] = { 0x89, 'S', 'Z', '4', '\r', '\n', 0x1a, 0x02,
+				0x22, 0x80, 0x3f, 0x01,
+				0x00, 0x01,
+				0x31, 0x80, 0x01 };
+
+	std::vector<sz4::value_time_pair<float, sz4::second_time_t> > f
+		= sz4::decode_file<float, sz4::second_time_t>(floats, sizeof(floats), 0u);
+	CPPUNIT_ASSERT_EQUAL(size_t(3), f.size());
+	CPPUNIT_ASSERT_EQUAL(1.f, f[0].value);
+	CPPUNIT_ASSERT_EQUAL(1.f, f[1].value);
+	CPPUNIT_ASSERT_EQUAL(-1.f, f[2].value);
+	CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(3), f[2].time);
+
+	///header that is not complete yet
+	position = sz4::file_position<sz4::second_time_t>(100u);
+	v.clear();
+	CPPUNIT_ASSERT(!sz4::decode_entries<short>(shorts, 5, position, v, sz4::time_trait<sz4::second_time_t>::last_valid_time));
+	CPPUNIT_ASSERT_EQUAL(size_t(0), v.size());
+	CPPUNIT_ASSERT_EQUAL(size_t(0), position.offset);
+	CPPUNIT_ASSERT_EQUAL((unsigned char)0, position.version);
+}
+
+void Sz4DecodeTEst::compressedIndexTest() {
+	std::vector<unsigned char> buf(sz4::file_header, sz4::file_header + sizeof(sz4::file_header));
+	unsigned long long previous = 0;
+	for (size_t i = 0; i < 200; i++) {
+		unsigned char output[sz4::value_codec<double>::max_size];
+		size_t size = sz4::value_codec<double>::encode(i / 3 * 0.1, previous, output);
+		buf.insert(buf.end(), output, output + size);
+		buf.push_back(0x02);
+	}
+
+	typedef sz4::value_time_pair<double, sz4::second_time_t> pair_type;
+	std::vector<pair_type> v;
+	sz4::file_index<sz4::second_time_t> index;
+	sz4::file_position<sz4::second_time_t> first(0u);
+	sz4::file_position<sz4::second_time_t> position(first);
+
+	sz4::decode_entries<double>(&buf[0], buf.size(), position, v, sz4::time_trait<sz4::second_time_t>::last_valid_time, &index);
+	CPPUNIT_ASSERT_EQUAL(size_t(200), v.size());
+	CPPUNIT_ASSERT_EQUAL(size_t(4), index.size());
+	for (size_t i = 0; i < 200; i++)
+		CPPUNIT_ASSERT_EQUAL(i / 3 * 0.1, v[i].value);
+
+	///decoding from indexed position restores previous value
+	sz4::file_position<sz4::second_time_t> p = index.find(300u, first);
+	CPPUNIT_ASSERT_EQUAL(size_t(128), p.entry);
+
+	std::vector<pair_type> v2;
+	sz4::decode_entries<double>(&buf[0], buf.size(), p, v2, sz4::time_trait<sz4::second_time_t>::last_valid_time);
+	CPPUNIT_ASSERT_EQUAL(v.size() - 128, v2.size());
+	for (size_t i = 0; i < v2.size(); i++)
+		CPPUNIT_ASSERT_EQUAL(v[i + 128].value, v2[i].value);
+}
+
+void Sz4DecodeTEst::mappedFileTest() {
+	const unsigned char file_content[] = { 0x01, 0x00, 0x01, 0x02, 0x00, 0x02 };
+
+	std::wstringstream file_name;
+	file_name << L"/tmp/sz4decode_unit_test." << getpid() << "." << time(NULL) << L".tmp";
+
+	{
+		std::ofstream ofs(SC::S2A(file_name.str()).c_str(), std::ios_base::binary);
+		ofs.write(reinterpret_cast<const char*>(file_content), sizeof(file_content));
+	}
+
+	{
+		sz4::mapped_file_locked file(file_name.str());
+		CPPUNIT_ASSERT(file.valid());
+		CPPUNIT_ASSERT_EQUAL(sizeof(file_content), file.size());
+		CPPUNIT_ASSERT(!memcmp(file_content, file.data(), file.size()));
+
+		std::vector<sz4::value_time_pair<short, sz4::second_time_t> > v
+			= sz4::decode_file<short, sz4::second_time_t>(file.data(), file.size(), 0u);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), v.size());
+		CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(3), v[1].time);
+	}
+
+	boost::filesystem::remove(file_name.str());
+
+	sz4::mapped_file_locked missing(file_name.str());
+	CPPUNIT_ASSERT(!missing.valid());
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION( Sz4DecodeTEst );
@@ -4,10 +4,16 @@ class Sz4RPNParam : public CPPUNIT_NS::TestFixture
 {
 	void test1();
 	void test2();
+	void lastTimeTest();
+	void programTest();
+	void batchTest();
 
 	CPPUNIT_TEST_SUITE( Sz4RPNParam );
 	CPPUNIT_TEST( test1 );
 	CPPUNIT_TEST( test2 );
+	CPPUNIT_TEST( lastTimeTest );
+	CPPUNIT_TEST( programTest );
+	CPPUNIT_TEST( batchTest );
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void setUp();
@@ -166,3 +172,259 @@ void Sz4RPNParam::test2() {
 	}
 }
 
+
+namespace rpn_unit_test {
+
+sz4::second_time_t counted_last_time;
+int last_time_calls;
+
+template<class value_type, class time_type, class base> class counting_entry_type : public mocks::fake_entry_type<value_type, time_type, base> {
+public:
+	counting_entry_type(base* _base, TParam* param, const boost::filesystem::wpath& path) : mocks::fake_entry_type<value_type, time_type, base>(_base, param, path) {}
+
+	void get_last_time(const std::list<sz4::generic_param_entry*>& referred_params, time_type &t) {
+		last_time_calls++;
+		t = time_type(counted_last_time);
+	}
+};
+
+struct counting_param_factory {
+	template<
+		template<typename DT, typename TT, class BT> class entry_type,
+		typename base
+	>
+	sz4::generic_param_entry* create(base* _base, TParam* param, const boost::filesystem::wpath &buffer_directory) {
+		if (param->GetName() == L"A:B:C")
+			return sz4::param_entry_factory().template create<counting_entry_type, base>(_base, param, buffer_directory);
+		else
+			return mocks::mock_param_factory().template create<entry_type, base>(_base, param, buffer_directory);
+	}
+};
+
+struct counting_test_types {
+	typedef IPKContainerMock2 ipk_container_type;
+	typedef counting_param_factory param_factory;
+};
+
+}
+
+void Sz4RPNParam::lastTimeTest() {
+	rpn_unit_test::IPKContainerMock2 mock;
+	sz4::base_templ<rpn_unit_test::counting_test_types> base(L"", &mock);
+	auto buff = base.buffer_for_param(mock.GetParam(L"BASE:A:B:D"));
+
+	rpn_unit_test::counted_last_time = 1000;
+	rpn_unit_test::last_time_calls = 0;
+
+	sz4::second_time_t t;
+	base.get_last_time(mock.GetParam(L"BASE:A:B:D"), t);
+	CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(1000), t);
+	base.get_last_time(mock.GetParam(L"BASE:A:B:D"), t);
+	CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(1000), t);
+	CPPUNIT_ASSERT_EQUAL(1, rpn_unit_test::last_time_calls);
+
+	rpn_unit_test::counted_last_time = 2000;
+	TParam* referred = mock.GetParam(L"BASE:A:B:C");
+	buff->get_param_entry(referred)->param_data_changed(referred, std::string());
+
+	base.get_last_time(mock.GetParam(L"BASE:A:B:D"), t);
+	CPPUNIT_ASSERT_EQUAL(sz4::second_time_t(2000), t);
+	CPPUNIT_ASSERT_EQUAL(2, rpn_unit_test::last_time_calls);
+
+	/* first time comes from the heartbeat, which does not notify */
+	sz4::second_time_t first;
+	base.get_first_time(mock.GetParam(L"BASE:A:B:D"), first);
+	base.get_last_time(mock.GetParam(L"BASE:A:B:D"), t);
+	CPPUNIT_ASSERT_EQUAL(2, rpn_unit_test::last_time_calls);
+}
+
+namespace rpn_unit_test {
+
+class sequence_fetch_functor : public value_fetch_functor {
+	const std::vector<double>& m_values;
+	size_t m_next;
+public:
+	sequence_fetch_functor(const std::vector<double>& values) : m_values(values), m_next(0) {}
+	virtual double operator()(TParam*) {
+		return m_values[m_next++ % m_values.size()];
+	}
+};
+
+class fixed_is_summer_functor : public is_summer_functor {
+	bool m_found;
+	bool m_summer;
+public:
+	fixed_is_summer_functor(bool found, bool summer) : m_found(found), m_summer(summer) {}
+	virtual bool operator()(bool& is_summer) {
+		is_summer = m_summer;
+		return m_found;
+	}
+};
+
+bool same_result(double v1, double v2) {
+	if (std::isnan(v1) || std::isnan(v2))
+		return std::isnan(v1) && std::isnan(v2);
+	return v1 == v2;
+}
+
+}
+
+void Sz4RPNParam::programTest() {
+	mocks::TSzarpConfigMock config;
+	config.SetName(L"BASE", L"BASE");
+
+	TParam* c = new TParam(NULL, &config);
+	c->SetName(L"A:B:C");
+	c->SetPrec(1);
+	config.AddDrawDefinable(c);
+
+	TParam* e = new TParam(NULL, &config);
+	e->SetName(L"A:B:E");
+	config.AddDrawDefinable(e);
+
+	TParam* l = new TParam(NULL, &config, L"", FormulaType::LUA_AV, ParamType::LUA);
+	l->SetName(L"A:B:L");
+	l->SetPrec(2);
+	config.AddDrawDefinable(l);
+
+	const wchar_t* formulas[] = {
+		L"(A:B:C) (A:B:L) +",
+		L"(A:B:C) (A:B:E) (A:B:C) 5 > ?f",
+		L"(A:B:L) (A:B:E) (A:B:L) ?f 2 *",
+		L"S 100 * (A:B:C) +",
+		L"(A:B:L) X N (A:B:E) /",
+		L"(A:B:C) (A:B:E) - 2 ^ (A:B:L) ! * -",
+	};
+
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	const double inputs[] = { 0., 1., -3., 7.5, 12., nan };
+	const size_t inputs_count = sizeof(inputs) / sizeof(inputs[0]);
+	const std::vector<double> fetched = { 2., 0., nan, -1.5, 10. };
+
+	for (size_t f = 0; f < sizeof(formulas) / sizeof(formulas[0]); f++) {
+		TParam* p = new TParam(NULL, &config);
+		p->SetName(L"A:B:D");
+		config.AddDrawDefinable(p);
+		p->SetFormula(formulas[f], FormulaType::DEFINABLE);
+
+		TParam** f_cache = p->GetFormulaCache();
+		int param_cnt = p->GetNumParsInFormula();
+		CPPUNIT_ASSERT(param_cnt > 0);
+
+		definable_program program(p);
+		size_t with_data = 0;
+
+		for (size_t i = 0; i < inputs_count; i++)
+		for (size_t j = 0; j < inputs_count; j++)
+		for (int summer = 0; summer < 3; summer++) {
+			double values[] = { inputs[i], inputs[j] };
+			std::vector<const double*> cache(param_cnt);
+			for (int k = 0, v = 0; k < param_cnt; k++)
+				cache[k] = f_cache[k] == l ? NULL : &values[v++ % 2];
+
+			double stack1[200] = { 0 }, stack2[200] = { 0 };
+			rpn_unit_test::sequence_fetch_functor fetch1(fetched), fetch2(fetched);
+			rpn_unit_test::fixed_is_summer_functor is_summer(summer > 0, summer > 1);
+
+			for (size_t n = 0; n < fetched.size(); n++) {
+				double expected = szb_definable_calculate(stack1, 200, cache.data(), f_cache,
+					p->GetDrawFormula(), param_cnt, fetch1, is_summer, p);
+				double result = program.execute(stack2, 200, cache.data(), fetch2, is_summer);
+				CPPUNIT_ASSERT(rpn_unit_test::same_result(expected, result));
+				if (!std::isnan(result))
+					with_data++;
+			}
+		}
+		CPPUNIT_ASSERT(with_data > 0);
+	}
+}
+
+namespace rpn_unit_test {
+
+int sums_calls;
+
+template<class value_type, class time_type, class base> class counting_real_entry : public sz4::real_param_entry_in_buffer<value_type, time_type, base> {
+public:
+	counting_real_entry(base* _base, TParam* param, const boost::filesystem::wpath& path) : sz4::real_param_entry_in_buffer<value_type, time_type, base>(_base, param, path) {}
+
+	void get_weighted_sums_impl(const std::vector<std::pair<time_type, time_type> >& ranges, SZARP_PROBE_TYPE probe_type, std::vector<sz4::weighted_sum<value_type, time_type> >& sums) {
+		sums_calls++;
+		sz4::real_param_entry_in_buffer<value_type, time_type, base>::get_weighted_sums_impl(ranges, probe_type, sums);
+	}
+};
+
+struct batch_param_factory {
+	template<
+		template<typename DT, typename TT, class BT> class entry_type,
+		typename base
+	>
+	sz4::generic_param_entry* create(base* _base, TParam* param, const boost::filesystem::wpath &buffer_directory) {
+		if (param->GetName() == L"A:B:C")
+			return sz4::param_entry_factory().template create<counting_real_entry, base>(_base, param, buffer_directory);
+		else
+			return mocks::mock_param_factory().template create<entry_type, base>(_base, param, buffer_directory);
+	}
+};
+
+struct batch_test_types {
+	typedef IPKContainerMock2 ipk_container_type;
+	typedef batch_param_factory param_factory;
+};
+
+}
+
+void Sz4RPNParam::batchTest() {
+	rpn_unit_test::IPKContainerMock2 mock;
+
+	std::wstringstream base_dir_name;
+	base_dir_name << L"/tmp/sz4_rpn_batch" << getpid() << L"." << time(NULL) << L".tmp";
+	boost::filesystem::wpath base_path(base_dir_name.str());
+	boost::filesystem::wpath param_dir(base_path / L"BASE/szbase/A/B/C");
+	boost::filesystem::create_directories(param_dir);
+
+	{
+		/* 10 for 50s, no data for 20s, 30 for 40s */
+		const short values[] = { 10, sz4::no_data<short>(), 30 };
+		const unsigned char deltas[] = { 50, 20, 40 };
+#if BOOST_FILESYSTEM_VERSION == 3
+		std::ofstream ofs((param_dir / L"0000000100.sz4").string().c_str(), std::ios::binary);
+#else
+		std::ofstream ofs((param_dir / L"0000000100.sz4").external_file_string().c_str(), std::ios::binary);
+#endif
+		for (size_t i = 0; i < 3; i++) {
+			ofs.write((const char*) &values[i], sizeof(values[i]));
+			ofs.write((const char*) &deltas[i], sizeof(deltas[i]));
+		}
+	}
+
+#if BOOST_FILESYSTEM_VERSION == 3
+	sz4::base_templ<rpn_unit_test::batch_test_types> batched(base_path.wstring(), &mock);
+	sz4::base_templ<rpn_unit_test::test_types> per_probe(base_path.wstring(), &mock);
+#else
+	sz4::base_templ<rpn_unit_test::batch_test_types> batched(base_path.file_string(), &mock);
+	sz4::base_templ<rpn_unit_test::test_types> per_probe(base_path.file_string(), &mock);
+#endif
+	TParam* param = mock.GetParam(L"BASE:A:B:D");
+
+	/* first probe is in cache, the rest is still fetched in one go */
+	sz4::weighted_sum<double, sz4::second_time_t> sum;
+	batched.get_weighted_sum(param, sz4::second_time_t(100), sz4::second_time_t(110), PT_SEC10, sum);
+	rpn_unit_test::sums_calls = 0;
+	batched.get_weighted_sum(param, sz4::second_time_t(100), sz4::second_time_t(300), PT_SEC10, sum);
+	CPPUNIT_ASSERT_EQUAL(1, rpn_unit_test::sums_calls);
+
+	for (sz4::second_time_t t = 100; t < 300; t += 10) {
+		sz4::weighted_sum<double, sz4::second_time_t> s1, s2;
+		sz4::weighted_sum<double, sz4::second_time_t>::time_diff_type w1, w2;
+		batched.get_weighted_sum(param, t, t + 10, PT_SEC10, s1);
+		per_probe.get_weighted_sum(param, t, t + 10, PT_SEC10, s2);
+
+		CPPUNIT_ASSERT_EQUAL(double(s2.sum(w2)), double(s1.sum(w1)));
+		CPPUNIT_ASSERT_EQUAL(w2, w1);
+		CPPUNIT_ASSERT_EQUAL(s2.no_data_weight(), s1.no_data_weight());
+		CPPUNIT_ASSERT_EQUAL(s2.fixed(), s1.fixed());
+	}
+	CPPUNIT_ASSERT_EQUAL(1, rpn_unit_test::sums_calls);
+
+	boost::filesystem::remove_all(base_path);
+}
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
 #include <cppunit/extensions/HelperMacros.h>
 #include <boost/filesystem.hpp>
 
@@ -19,6 +20,7 @@
 #include "sz4/time.h"
 #include "sz4/path.h"
 #include "sz4/definable_param_cache.h"
+#include "sz4/definable_param_store.h"
 
 #include "test_serach_condition.h"
 
@@ -26,10 +28,12 @@ class Sz4DefinableParamCache : public CPPUNIT_NS::TestFixture
 {
 	void test1();
 	void test2();
+	void storeTest();
 
 	CPPUNIT_TEST_SUITE( Sz4DefinableParamCache );
 	CPPUNIT_TEST( test1 );
 	CPPUNIT_TEST( test2 );
+	CPPUNIT_TEST( storeTest );
 	CPPUNIT_TEST_SUITE_END();
 
 	sz4::block_cache* m_cache;
@@ -189,3 +193,114 @@ void Sz4DefinableParamCache::test2() {
 
 }
 
+namespace {
+
+void append_to_file(const boost::filesystem::wpath& path, const char* data) {
+#if BOOST_FILESYSTEM_VERSION == 3
+	std::ofstream ofs(path.string().c_str(), std::ios::binary | std::ios::app);
+#else
+	std::ofstream ofs(path.external_file_string().c_str(), std::ios::binary | std::ios::app);
+#endif
+	ofs << data;
+}
+
+}
+
+void Sz4DefinableParamCache::storeTest() {
+	typedef sz4::definable_param_store<double, sz4::second_time_t> store_type;
+
+	std::wstringstream base_dir_name;
+	base_dir_name << L"/tmp/sz4_definable_store" << getpid() << L"." << time(NULL) << L".tmp";
+	boost::filesystem::wpath base_path(base_dir_name.str());
+	boost::filesystem::wpath data_dir(base_path / L"A/B/C");
+	boost::filesystem::wpath store_dir(base_path / L"store");
+	boost::filesystem::create_directories(data_dir);
+
+	append_to_file(data_dir / L"0000000100.sz4", "aaaa");
+	append_to_file(data_dir / L"0000000200.sz4", "bbbb");
+
+	TParam param(NULL, NULL, L"(A:B:C) 1 +", FormulaType::DEFINABLE, ParamType::DEFINABLE);
+	auto source = std::make_shared<sz4::definable_store_source>(&param, std::vector<boost::filesystem::wpath>(1, data_dir));
+
+	double v;
+	{
+		sz4::definable_store_writer writer(store_dir);
+		store_type store(&writer, source, PT_SEC10);
+		CPPUNIT_ASSERT(!store.get_value(100, v));
+
+		store.add_value(1.5, 100, 110);
+		store.add_value(1.5, 110, 120);
+		store.add_value(sz4::no_data<double>(), 120, 130);
+		store.add_value(2., 200, 210);
+	}
+
+	/* appending to the newest file does not invalidate the store */
+	append_to_file(data_dir / L"0000000200.sz4", "cccc");
+	source->file_changed(data_dir, "0000000200.sz4");
+
+	{
+		sz4::definable_store_writer writer(store_dir);
+		store_type store(&writer, source, PT_SEC10);
+
+		CPPUNIT_ASSERT(store.get_value(115, v));
+		CPPUNIT_ASSERT_EQUAL(1.5, v);
+		CPPUNIT_ASSERT(store.get_value(120, v));
+		CPPUNIT_ASSERT(sz4::value_is_no_data(v));
+		CPPUNIT_ASSERT(!store.get_value(130, v));
+		CPPUNIT_ASSERT(store.get_value(200, v));
+		CPPUNIT_ASSERT_EQUAL(2., v);
+
+		CPPUNIT_ASSERT(!store_type(&writer, source, PT_MIN10).get_value(115, v));
+
+		TParam other(NULL, NULL, L"(A:B:C) 2 +", FormulaType::DEFINABLE, ParamType::DEFINABLE);
+		auto other_source = std::make_shared<sz4::definable_store_source>(&other, std::vector<boost::filesystem::wpath>(1, data_dir));
+		CPPUNIT_ASSERT(!store_type(&writer, other_source, PT_SEC10).get_value(115, v));
+
+		/* definitions of referred params are part of the formula */
+		TParam referred(NULL, NULL, L"(A:B:C) 1 +", FormulaType::DEFINABLE, ParamType::DEFINABLE);
+		TParam changed(NULL, NULL, L"(A:B:C) 2 +", FormulaType::DEFINABLE, ParamType::DEFINABLE);
+		std::vector<boost::filesystem::wpath> dirs(1, data_dir);
+		CPPUNIT_ASSERT(sz4::definable_store_source(&param, dirs, std::vector<TParam*>(1, &referred)).formula_hash()
+				!= sz4::definable_store_source(&param, dirs, std::vector<TParam*>(1, &changed)).formula_hash());
+		CPPUNIT_ASSERT_EQUAL(source->formula_hash(),
+				sz4::definable_store_source(&param, dirs, std::vector<TParam*>(1, &param)).formula_hash());
+	}
+
+	/* older file changed, values might have been computed from old data */
+	append_to_file(data_dir / L"0000000100.sz4", "dddd");
+	source->file_changed(data_dir, "0000000100.sz4");
+
+	{
+		sz4::definable_store_writer writer(store_dir);
+		store_type store(&writer, source, PT_SEC10);
+		CPPUNIT_ASSERT(!store.get_value(115, v));
+	}
+
+	/* values computed before older data was rewritten are not kept */
+	{
+		sz4::definable_store_writer writer(store_dir);
+		store_type store(&writer, source, PT_SEC10);
+		store.add_value(3., 300, 310);
+
+		append_to_file(data_dir / L"0000000100.sz4", "eeee");
+		source->file_changed(data_dir, "0000000100.sz4");
+		store.data_changed();
+
+		store.add_value(4., 400, 410);
+	}
+
+	{
+		sz4::definable_store_writer writer(store_dir);
+		store_type store(&writer, source, PT_SEC10);
+		CPPUNIT_ASSERT(!store.get_value(300, v));
+		CPPUNIT_ASSERT(store.get_value(400, v));
+		CPPUNIT_ASSERT_EQUAL(4., v);
+
+		/* file is mapped again after release */
+		store.release();
+		CPPUNIT_ASSERT(store.get_value(400, v));
+		CPPUNIT_ASSERT_EQUAL(4., v);
+	}
+
+	boost::filesystem::remove_all(base_path);
+}
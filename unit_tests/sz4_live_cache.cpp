@@ -4,6 +4,8 @@
 #include "config.h"
 
 #include <condition_variable>
+#include <thread>
+#include <atomic>
 
 #include "protobuf/paramsvalues.pb.h"
 
@@ -30,6 +32,8 @@ class Sz4LiveCache : public CPPUNIT_NS::TestFixture
 	void zmqHandlingTest ();
 	void retentionTest ();
 	void blockTest ();
+	void ringTest ();
+	void rangeTest ();
 
 	mocks::TSzarpConfigMock config;
 	TParam* param;
@@ -40,6 +44,8 @@ class Sz4LiveCache : public CPPUNIT_NS::TestFixture
 	CPPUNIT_TEST( zmqHandlingTest );
 	CPPUNIT_TEST( retentionTest );
 	CPPUNIT_TEST( blockTest );
+	CPPUNIT_TEST( ringTest );
+	CPPUNIT_TEST( rangeTest );
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void setUp();
@@ -176,6 +182,7 @@ class fake_base {
 	sz4::block_cache m_cache;
 public:
 	sz4::block_cache* cache() { return &m_cache; }
+	sz4::definable_store_writer* definable_store() { return nullptr; }
 };
 
 class fake_block_entry : public sz4::file_block_entry<short, sz4::second_time_t, fake_base> {
@@ -285,4 +292,101 @@ void Sz4LiveCache::blockTest() {
 
 }
 
+void Sz4LiveCache::ringTest() {
+	typedef sz4::second_time_t sec_t;
+	typedef sz4::weighted_sum<int, sec_t> sum_t;
+	typedef sz4::time_difference<sec_t>::type dif_t;
+
+	sz4::live_block<int, sec_t> block(100000000);
+
+	const sec_t count = 100000;
+	std::atomic<bool> done(false);
+
+	std::thread writer([&] () {
+		for (sec_t t = 1; t <= count; t++)
+			block.process_live_value(t, int(t));
+		done = true;
+	});
+
+	bool consistent = true;
+	sec_t last = 0;
+	while (!done) {
+		sec_t t;
+		block.get_last_time(t);
+		if (t == sz4::time_trait<sec_t>::invalid_value || t <= 10)
+			continue;
+
+		if (t < last)
+			consistent = false;
+		last = t;
+
+		sum_t sum;
+		sec_t start = t - 10, end = t;
+		if (block.get_weighted_sum(start, end, sum) != sz4::cache_ret::complete)
+			continue;
+
+		dif_t weight;
+		sum_t::sum_type value = sum.sum(weight);
+		long long expected = (long long)t * (t + 1) / 2 - (long long)start * (start + 1) / 2;
+		if (weight != dif_t(10) || value != sum_t::sum_type(expected))
+			consistent = false;
+	}
+	writer.join();
+
+	CPPUNIT_ASSERT(consistent);
+
+	sec_t t;
+	block.get_last_time(t);
+	CPPUNIT_ASSERT_EQUAL(count, t);
+
+	/* oldest values were dropped once the buffer reached its limit */
+	block.get_first_time(t);
+	CPPUNIT_ASSERT(t > 1);
+
+	sum_t sum;
+	sec_t end = count;
+	CPPUNIT_ASSERT(sz4::cache_ret::partial == block.get_weighted_sum(1, end, sum));
+	CPPUNIT_ASSERT_EQUAL(t, end);
+}
+
+void Sz4LiveCache::rangeTest() {
+	typedef sz4::second_time_t sec_t;
+	typedef sz4::weighted_sum<int, sec_t> sum_t;
+	typedef sz4::time_difference<sec_t>::type dif_t;
+
+	sz4::live_block<int, sec_t> block(100000000);
+	std::vector<sz4::value_time_pair<int, sec_t>> values;
+
+	/* grows the buffer several times, queries copy only part of it */
+	for (int i = 1; i <= 1000; i++) {
+		int v = i % 7 ? i : sz4::no_data<int>();
+		block.process_live_value(sec_t(i * 10), v);
+		values.push_back(sz4::make_value_time_pair<sz4::value_time_pair<int, sec_t>>(v, sec_t(i * 10)));
+	}
+
+	auto cond = sz4::no_data_search_condition();
+	for (sec_t start = 10; start < 10000; start += 37)
+		for (sec_t end = start + 1; end <= 10000; end += 113) {
+			sum_t sum, expected;
+			sec_t e = end;
+			CPPUNIT_ASSERT(sz4::cache_ret::complete == block.get_weighted_sum(start, e, sum));
+			sz4::get_weighted_sum(values.begin(), values.end(), start, end, expected);
+
+			dif_t weight, expected_weight;
+			CPPUNIT_ASSERT_EQUAL(expected.sum(expected_weight), sum.sum(weight));
+			CPPUNIT_ASSERT_EQUAL(expected_weight, weight);
+			CPPUNIT_ASSERT_EQUAL(expected.no_data_weight(), sum.no_data_weight());
+
+			auto r = sz4::search_data_right_t(values.begin(), values.end(), start, end, cond);
+			sec_t right = r == values.end() ? sz4::time_trait<sec_t>::invalid_value
+				: std::max(start, r == values.begin() ? sec_t(10) : (r - 1)->time);
+			CPPUNIT_ASSERT_EQUAL(right, block.search_data_right(start, end, cond));
+
+			auto l = sz4::search_data_left_t(values.begin(), values.end(), end, start, cond);
+			std::pair<bool, sec_t> left = l == values.end() ? std::make_pair(false, sec_t(10))
+				: std::make_pair(true, std::min(sz4::time_just_before(l->time), end));
+			CPPUNIT_ASSERT(left == block.search_data_left(end, start, cond));
+		}
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION( Sz4LiveCache );
@@ -4,10 +4,12 @@ class Sz4LuaParam : public CPPUNIT_NS::TestFixture
 {
 	void test1();
 	void test2();
+	void threadsTest();
 
 	CPPUNIT_TEST_SUITE( Sz4LuaParam );
 	CPPUNIT_TEST( test1 );
 	CPPUNIT_TEST( test2 );
+	CPPUNIT_TEST( threadsTest );
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void setUp();
@@ -176,3 +178,27 @@ void Sz4LuaParam::test2() {
 	}
 }
 
+void Sz4LuaParam::threadsTest() {
+	IPKContainerMock1 mock;
+	sz4::base_templ<test_types> base(L"", &mock);
+	TParam* param = mock.GetParam(L"");
+
+	std::atomic<int> errors(0);
+	auto query = [&] (unsigned offset) {
+		for (unsigned t = offset; t < offset + 10000; t += 100) {
+			sz4::weighted_sum<double, sz4::second_time_t> sum;
+			sz4::weighted_sum<double, sz4::second_time_t>::time_diff_type weight;
+			base.get_weighted_sum(param, t, t + 100, PT_SEC10, sum);
+			if (sum.sum(weight) != 50. || weight != 100 || !sum.fixed())
+				errors++;
+		}
+	};
+
+	///each thread evaluates the param in its own lua state
+	boost::thread t1(query, 100000u);
+	boost::thread t2(query, 200000u);
+	t1.join();
+	t2.join();
+
+	CPPUNIT_ASSERT_EQUAL(0, int(errors));
+}
@@ -0,0 +1,77 @@
+#include "config.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "sz4/defs.h"
+#include "sz4/block.h"
+
+/* Compares the generic weighted sum loop with the native overloads
+ * used by blocks with second resolution:
+ * sz4_sum_bench [entries [repeats]] */
+
+namespace {
+
+template<class V> std::vector<sz4::value_time_pair<V, sz4::second_time_t> > make_data(size_t entries) {
+	typedef sz4::value_time_pair<V, sz4::second_time_t> pair_type;
+	std::vector<pair_type> data;
+
+	for (size_t i = 0; i < entries; i++) {
+		V value = i % 50 ? V(i % 1000) / V(3) : sz4::no_data<V>();
+		data.push_back(sz4::make_value_time_pair<pair_type>(value, sz4::second_time_t(10 * (i + 1))));
+	}
+
+	return data;
+}
+
+/* blocks sum into a weighted_sum of unknown type, so the call is
+ * kept out of line to keep add() virtual as it is there */
+template<class V> __attribute__((noinline)) void generic_sum(const std::vector<sz4::value_time_pair<V, sz4::second_time_t> >& data,
+		sz4::second_time_t end, sz4::weighted_sum<V, sz4::second_time_t>& sum) {
+	sz4::get_weighted_sum(data.begin(), data.end(), 0u, end, sum);
+}
+
+template<class F> double measure(F f, size_t repeats) {
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < repeats; i++)
+		f();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class V> void bench(const char* name, size_t entries, size_t repeats) {
+	auto data = make_data<V>(entries);
+	sz4::second_time_t end = data.back().time;
+
+	sz4::weighted_sum<V, sz4::second_time_t> generic_result, native_result;
+	double generic = measure([&] () {
+		sz4::weighted_sum<V, sz4::second_time_t> sum;
+		generic_sum<V>(data, end, sum);
+		generic_result = sum;
+	}, repeats);
+
+	double native = measure([&] () {
+		sz4::weighted_sum<V, sz4::second_time_t> sum;
+		sz4::get_weighted_sum(data, 0u, end, sum);
+		native_result = sum;
+	}, repeats);
+
+	std::cout << name << ": generic " << generic << " ms, native " << native << " ms"
+		<< (generic_result._sum() == native_result._sum() ? "" : ", SUMS DIFFER") << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	size_t entries = argc > 1 ? std::stoul(argv[1]) : 2000;
+	size_t repeats = argc > 2 ? std::stoul(argv[2]) : 2000;
+
+	std::cout << entries << " entries, " << repeats << " full block sums" << std::endl;
+
+	bench<short>("short", entries, repeats);
+	bench<int>("int", entries, repeats);
+	bench<float>("float", entries, repeats);
+	bench<double>("double", entries, repeats);
+
+	return 0;
+}
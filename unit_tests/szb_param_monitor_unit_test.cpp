@@ -27,10 +27,12 @@ class SzbParamMonitorTest : public CPPUNIT_NS::TestFixture
 {
 	void writeTest();
 	void renameTest();
+	void journalTest();
 
 	CPPUNIT_TEST_SUITE( SzbParamMonitorTest );
 	CPPUNIT_TEST( writeTest );
 	CPPUNIT_TEST( renameTest );
+	CPPUNIT_TEST( journalTest );
 	CPPUNIT_TEST_SUITE_END();
 
 	std::vector<std::string> createDirectories();
@@ -153,3 +155,47 @@ void SzbParamMonitorTest::renameTest() {
 	CPPUNIT_ASSERT_EQUAL(2, o1.map[(TParam*)1]);
 }
 
+
+void SzbParamMonitorTest::journalTest() {
+	SzbParamMonitor m(L"");
+	TestObserver o1;
+
+	std::vector<std::string> dir_paths = createDirectories();
+	std::string base_dir = boost::filesystem::path(dir_paths[0]).parent_path().string();
+	std::string journal_path = base_dir + "/" SZB_CHANGE_JOURNAL;
+
+	std::ofstream(journal_path.c_str()) << "a/old.sz4 4\n";
+
+	m.add_observer(&o1, std::vector<std::pair<TParam*, std::vector<std::string> > >(1, std::make_pair((TParam*)1, dir_paths)), 0);
+	m.add_observer(&o1, (TParam*)2, base_dir + "/d/e", 0);
+
+	{
+		std::ofstream journal(journal_path.c_str(), std::ios_base::app);
+		journal << "a/test.sz4 4\nb/test.sz4 4\nb/test.sz4 8\nc/test.tmp 4\nx/test.sz4 4\n" << std::flush;
+		journal << "c/te";
+		journal << "st.sz4 4\n" << std::flush;
+		journal << "d/e/test.sz4 4\n" << std::flush;
+	}
+
+	CPPUNIT_ASSERT(o1.wait_for(4));
+	CPPUNIT_ASSERT_EQUAL(size_t(2), o1.map.size());
+	CPPUNIT_ASSERT_EQUAL(3, o1.map[(TParam*)1]);
+	CPPUNIT_ASSERT_EQUAL(1, o1.map[(TParam*)2]);
+
+	/* rotation, new journal is renamed over the old one */
+	boost::filesystem::create_hard_link(journal_path, journal_path + ".1");
+	std::ofstream((journal_path + ".new").c_str()) << "a/test.sz4 8\n";
+	boost::filesystem::rename(journal_path + ".new", journal_path);
+
+	CPPUNIT_ASSERT(o1.wait_for(5));
+	CPPUNIT_ASSERT_EQUAL(4, o1.map[(TParam*)1]);
+
+	/* journal is no longer kept, dirs are watched directly */
+	boost::filesystem::remove(journal_path);
+
+	for (int i = 0; i < 10 && !o1.wait_for(6, 1); i++)
+		std::ofstream((dir_paths[1] + "/test.sz4").c_str(), std::ios_base::app) << "data";
+	CPPUNIT_ASSERT_EQUAL(5, o1.map[(TParam*)1]);
+
+	boost::filesystem::remove_all(base_dir);
+}
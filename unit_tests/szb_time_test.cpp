@@ -0,0 +1,137 @@
+#include "config.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <string>
+
+#include "szarp_base_common/time.h"
+#include <cppunit/extensions/HelperMacros.h>
+
+class SzbTimeTest : public CPPUNIT_NS::TestFixture
+{
+	void moveTest();
+	void roundTest();
+
+	CPPUNIT_TEST_SUITE( SzbTimeTest );
+	CPPUNIT_TEST( moveTest );
+	CPPUNIT_TEST( roundTest );
+	CPPUNIT_TEST_SUITE_END();
+
+	std::string m_tz;
+	bool m_had_tz;
+
+	void set_tz(const char* tz);
+public:
+	void setUp();
+	void tearDown();
+};
+
+void SzbTimeTest::set_tz(const char* tz) {
+	if (tz)
+		setenv("TZ", tz, 1);
+	else
+		unsetenv("TZ");
+	tzset();
+	szb_time_zone_changed();
+}
+
+/* Rules of Europe/Warsaw, given explicitly so that no zoneinfo files are needed */
+void SzbTimeTest::setUp() {
+	const char* tz = getenv("TZ");
+	m_had_tz = tz != NULL;
+	m_tz = tz ? tz : "";
+
+	set_tz("CET-1CEST,M3.5.0,M10.5.0/3");
+}
+
+void SzbTimeTest::tearDown() {
+	set_tz(m_had_tz ? m_tz.c_str() : NULL);
+}
+
+namespace {
+
+const SZARP_PROBE_TYPE calendar_probes[] = { PT_HOUR8, PT_DAY, PT_WEEK, PT_MONTH, PT_YEAR };
+
+/* 2014-01-01 - 2016-01-01, with two DST changes each year in most zones */
+const time_t range_start = 1388534400;
+const time_t range_end = 1451606400;
+
+time_t libc_move_time(time_t t, int count, SZARP_PROBE_TYPE probe_type) {
+	struct tm tm;
+	localtime_r(&t, &tm);
+	switch (probe_type) {
+		case PT_HOUR8:
+			tm.tm_hour += count * 8;
+			break;
+		case PT_DAY:
+			tm.tm_mday += count;
+			break;
+		case PT_WEEK:
+			tm.tm_mday += count * 7;
+			break;
+		case PT_MONTH:
+			tm.tm_mon += count;
+			break;
+		default:
+			tm.tm_year += count;
+			break;
+	}
+	tm.tm_isdst = -1;
+	return mktime(&tm);
+}
+
+time_t libc_round_time(time_t t, SZARP_PROBE_TYPE probe_type) {
+	struct tm tm;
+	localtime_r(&t, &tm);
+	tm.tm_sec = tm.tm_min = 0;
+	switch (probe_type) {
+		case PT_HOUR8:
+			tm.tm_hour -= tm.tm_hour % 8;
+			break;
+		case PT_DAY:
+			tm.tm_hour = 0;
+			break;
+		case PT_WEEK:
+			tm.tm_hour = 0;
+			tm.tm_mday += tm.tm_wday - 1;
+			break;
+		case PT_MONTH:
+			tm.tm_hour = 0;
+			tm.tm_mday = 1;
+			break;
+		default:
+			tm.tm_hour = 0;
+			tm.tm_mday = 1;
+			tm.tm_mon = 1;
+			break;
+	}
+	tm.tm_isdst = -1;
+	return mktime(&tm);
+}
+
+}
+
+void SzbTimeTest::moveTest() {
+	/* 2014-01-01 and 2014-07-01 */
+	time_t winter = range_start, summer = 1404172800;
+	struct tm winter_tm, summer_tm;
+	localtime_r(&winter, &winter_tm);
+	localtime_r(&summer, &summer_tm);
+	CPPUNIT_ASSERT(winter_tm.tm_gmtoff != summer_tm.tm_gmtoff);
+
+	for (time_t t = range_start; t < range_end; t += 1777)
+		for (auto pt : calendar_probes)
+			for (int count = -2; count <= 2; count++)
+				CPPUNIT_ASSERT_EQUAL(libc_move_time(t, count, pt), szb_move_time(t, count, pt));
+
+	CPPUNIT_ASSERT_EQUAL(time_t(-1), szb_move_time(-1, 1, PT_DAY));
+}
+
+void SzbTimeTest::roundTest() {
+	for (time_t t = range_start; t < range_end; t += 1777)
+		for (auto pt : calendar_probes)
+			CPPUNIT_ASSERT_EQUAL(libc_round_time(t, pt), szb_round_time(t, pt));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SzbTimeTest );
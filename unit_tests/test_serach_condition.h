@@ -6,6 +6,9 @@ class test_search_condition : public sz4::search_condition {
 	int value_to_search;
 public:
 	test_search_condition(int v) : value_to_search(v) {}
+	virtual bool may_match(const sz4::values_summary& summary) const {
+		return summary.has_data && summary.min <= value_to_search && value_to_search <= summary.max;
+	}
 	virtual bool operator()(const int &v) const { return value_to_search == v; }
 	virtual bool operator()(const short &v) const { return false; }
 	virtual bool operator()(const float &v) const { return false; }